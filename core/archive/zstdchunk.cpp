@@ -0,0 +1,260 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "zstdchunk.h"
+#include "stdclass.h"
+#include <zstd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+const u8 ZstdChunkHeader[8] = { '#', 'F', 'Z', 'S', 'T', 'D', 'C', '#' };
+constexpr u32 ZstdChunkVersion = 1;
+
+static WorkerPool chunkPool("Zstd", std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4u));
+static std::mutex chunkPoolMutex;
+constexpr u32 CompressBatchSize = 8;
+
+bool ZstdChunkFile::Open(FILE *file, bool write, int level)
+{
+	verify(this->file == nullptr);
+	verify(file != nullptr);
+	startOffset = std::ftell(file);
+	size = 0;
+	readPosition = 0;
+	chunks.clear();
+	chunkOffsets.clear();
+	fileOffsets.clear();
+	pendingData.clear();
+	Header header{};
+	if (!write)
+	{
+		if (std::fread(&header, sizeof(header), 1, file) != 1
+				|| memcmp(header.magic, ZstdChunkHeader, sizeof(header.magic)))
+		{
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+		if (header.version > ZstdChunkVersion)
+		{
+			WARN_LOG(SAVESTATE, "Unsupported zstd chunk file version %d", header.version);
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+		// Check the index size before allocating it
+		std::fseek(file, 0, SEEK_END);
+		const u64 fileSize = (u64)(std::ftell(file) - startOffset);
+		if (header.chunkCount > header.size / ChunkSize + 1 || header.indexOffset > fileSize
+				|| (u64)header.chunkCount * sizeof(Chunk) > fileSize - header.indexOffset)
+		{
+			WARN_LOG(SAVESTATE, "Invalid zstd chunk file index");
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+		chunks.resize(header.chunkCount);
+		if (std::fseek(file, startOffset + (long)header.indexOffset, SEEK_SET) != 0
+				|| (header.chunkCount != 0 && std::fread(chunks.data(), sizeof(Chunk), chunks.size(), file) != chunks.size()))
+		{
+			WARN_LOG(SAVESTATE, "Invalid zstd chunk file index");
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+		chunkOffsets.reserve(chunks.size() + 1);
+		fileOffsets.reserve(chunks.size() + 1);
+		chunkOffsets.push_back(0);
+		fileOffsets.push_back(sizeof(Header));
+		for (const Chunk& chunk : chunks)
+		{
+			if (chunk.size == 0 || chunk.size > ChunkSize)
+				break;
+			chunkOffsets.push_back(chunkOffsets.back() + chunk.size);
+			fileOffsets.push_back(fileOffsets.back() + chunk.compressedSize);
+		}
+		if (chunkOffsets.size() != chunks.size() + 1 || chunkOffsets.back() != header.size
+				|| fileOffsets.back() > header.indexOffset)
+		{
+			WARN_LOG(SAVESTATE, "Invalid zstd chunk file index");
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+		size = header.size;
+	}
+	else
+	{
+		// written again once closed
+		if (std::fwrite(&header, sizeof(header), 1, file) != 1)
+		{
+			std::fseek(file, startOffset, SEEK_SET);
+			return false;
+		}
+	}
+	this->write = write;
+	this->level = level;
+	this->file = file;
+	return true;
+}
+
+bool ZstdChunkFile::Close()
+{
+	if (file == nullptr)
+		return false;
+	bool success = true;
+	if (write)
+	{
+		// last chunk
+		if (!pendingData.empty())
+			success = writeChunks(pendingData.data(), pendingData.size()) == pendingData.size();
+		pendingData.clear();
+		Header header{};
+		memcpy(header.magic, ZstdChunkHeader, sizeof(header.magic));
+		header.version = ZstdChunkVersion;
+		header.size = size;
+		header.indexOffset = std::ftell(file) - startOffset;
+		header.chunkCount = (u32)chunks.size();
+		success = success && (chunks.empty() || std::fwrite(chunks.data(), sizeof(Chunk), chunks.size(), file) == chunks.size())
+				&& std::fseek(file, startOffset, SEEK_SET) == 0
+				&& std::fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+	success = std::fclose(file) == 0 && success;
+	file = nullptr;
+
+	return success;
+}
+
+size_t ZstdChunkFile::Read(void *data, size_t length)
+{
+	verify(file != nullptr);
+	verify(!write);
+
+	if (readPosition >= size)
+		return 0;
+	length = std::min<u64>(length, size - readPosition);
+	if (length == 0)
+		return 0;
+	const u64 end = readPosition + length;
+	// chunks overlapping the range
+	const u32 first = (u32)(std::upper_bound(chunkOffsets.begin(), chunkOffsets.end(), readPosition) - chunkOffsets.begin() - 1);
+	const u32 last = (u32)(std::lower_bound(chunkOffsets.begin(), chunkOffsets.end(), end) - chunkOffsets.begin());
+
+	std::vector<u8> compressed(fileOffsets[last] - fileOffsets[first]);
+	if (std::fseek(file, startOffset + (long)fileOffsets[first], SEEK_SET) != 0
+			|| std::fread(compressed.data(), 1, compressed.size(), file) != compressed.size())
+		return 0;
+
+	std::atomic<bool> error{};
+	{
+		std::lock_guard<std::mutex> _(chunkPoolMutex);
+		chunkPool.run(last - first, [&](u32 i) {
+			const u32 c = first + i;
+			const Chunk& chunk = chunks[c];
+			const u8 *src = &compressed[fileOffsets[c] - fileOffsets[first]];
+			const u64 chunkStart = std::max<u64>(chunkOffsets[c], readPosition);
+			const u64 chunkEnd = std::min<u64>(chunkOffsets[c + 1], end);
+			u8 *dest = (u8 *)data + (chunkStart - readPosition);
+			size_t rc;
+			if (chunkStart == chunkOffsets[c] && chunkEnd == chunkOffsets[c + 1])
+			{
+				// whole chunk
+				rc = ZSTD_decompress(dest, chunk.size, src, chunk.compressedSize);
+			}
+			else
+			{
+				std::vector<u8> buffer(chunk.size);
+				rc = ZSTD_decompress(buffer.data(), buffer.size(), src, chunk.compressedSize);
+				if (!ZSTD_isError(rc))
+					memcpy(dest, &buffer[chunkStart - chunkOffsets[c]], chunkEnd - chunkStart);
+			}
+			if (ZSTD_isError(rc) || rc != chunk.size)
+				error = true;
+		});
+	}
+	if (error)
+	{
+		WARN_LOG(SAVESTATE, "Decompression error");
+		return 0;
+	}
+	readPosition = end;
+
+	return length;
+}
+
+size_t ZstdChunkFile::Write(const void *data, size_t length)
+{
+	verify(file != nullptr);
+	verify(write);
+
+	// Only full chunks are written. The rest is kept until the next write or close.
+	const u8 *p = (const u8 *)data;
+	size_t rv = 0;
+	if (!pendingData.empty())
+	{
+		rv = std::min<size_t>(ChunkSize - pendingData.size(), length);
+		pendingData.insert(pendingData.end(), p, p + rv);
+		if (pendingData.size() < ChunkSize)
+			return rv;
+		if (writeChunks(pendingData.data(), ChunkSize) != ChunkSize)
+			return 0;
+		pendingData.clear();
+	}
+	const size_t fullSize = (length - rv) / ChunkSize * ChunkSize;
+	const size_t written = writeChunks(p + rv, fullSize);
+	if (written != fullSize)
+		return rv + written;
+	pendingData.assign(p + rv + fullSize, p + length);
+
+	return length;
+}
+
+size_t ZstdChunkFile::writeChunks(const u8 *p, size_t length)
+{
+	if (length == 0)
+		return 0;
+	const size_t maxCompressedSize = ZSTD_compressBound(ChunkSize);
+	std::vector<u8> compressed(maxCompressedSize * std::min<size_t>(CompressBatchSize, length / ChunkSize + 1));
+	size_t compressedSizes[CompressBatchSize];
+	std::lock_guard<std::mutex> _(chunkPoolMutex);
+	size_t rv = 0;
+	while (rv < length)
+	{
+		const u32 count = (u32)std::min<size_t>(CompressBatchSize, (length - rv + ChunkSize - 1) / ChunkSize);
+		chunkPool.run(count, [&](u32 i) {
+			const size_t offset = rv + (size_t)i * ChunkSize;
+			compressedSizes[i] = ZSTD_compress(&compressed[i * maxCompressedSize], maxCompressedSize, p + offset,
+					std::min<size_t>(ChunkSize, length - offset), level);
+		});
+		for (u32 i = 0; i < count; i++)
+		{
+			if (ZSTD_isError(compressedSizes[i]))
+			{
+				WARN_LOG(SAVESTATE, "Compression error: %s", ZSTD_getErrorName(compressedSizes[i]));
+				return rv;
+			}
+			if (std::fwrite(&compressed[i * maxCompressedSize], compressedSizes[i], 1, file) != 1)
+				return 0;
+			const u32 chunkSize = (u32)std::min<size_t>(ChunkSize, length - rv);
+			chunks.push_back({ (u32)compressedSizes[i], chunkSize });
+			rv += chunkSize;
+			size += chunkSize;
+		}
+	}
+
+	return rv;
+}
@@ -0,0 +1,84 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// Stream of independently compressed zstd chunks followed by a chunk index.
+// Chunks are compressed and decompressed in parallel, and any part of the stream can be read.
+//
+// Header:	u8 magic[8], u32 version, u32 reserved, u64 size, u64 indexOffset, u32 chunkCount, u32 reserved
+// Chunks:	compressed data
+// Index:	{ u32 compressedSize, u32 size } for each chunk. Only the last chunk can be smaller than ChunkSize.
+#pragma once
+#include "types.h"
+#include <vector>
+
+class ZstdChunkFile
+{
+public:
+	enum Level {
+		Fast = 1,
+		Small = 9,
+	};
+
+	~ZstdChunkFile() { Close(); }
+
+	// The file position is left unchanged if it isn't a zstd chunk file
+	bool Open(FILE *file, bool write, int level = Fast);
+	// Closes the underlying file. Returns false if the file couldn't be completed.
+	bool Close();
+	size_t Size() const { return size; }
+	// Reads from the current position
+	size_t Read(void *data, size_t length);
+	size_t Write(const void *data, size_t length);
+	// Sets the position of the next read
+	void Seek(size_t offset) { readPosition = offset; }
+	FILE *rawFile() const { return file; }
+
+	static constexpr u32 ChunkSize = 1_MB;
+
+private:
+	struct Chunk
+	{
+		u32 compressedSize;
+		u32 size;
+	};
+	struct Header
+	{
+		u8 magic[8];
+		u32 version;
+		u32 reserved1;
+		u64 size;
+		u64 indexOffset;
+		u32 chunkCount;
+		u32 reserved2;
+	};
+
+	size_t writeChunks(const u8 *data, size_t length);
+
+	FILE *file = nullptr;
+	bool write = false;
+	int level = Fast;
+	long startOffset = 0;
+	u64 size = 0;
+	size_t readPosition = 0;
+	std::vector<Chunk> chunks;
+	// uncompressed and file offset of each chunk, and of the end of the last one
+	std::vector<u64> chunkOffsets;
+	std::vector<u64> fileOffsets;
+	// Data written after the last full chunk
+	std::vector<u8> pendingData;
+};
@@ -3,6 +3,7 @@
 */
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 #include "cfg/cfg.h"
@@ -80,6 +81,8 @@ static int showhelp()
 	printf("-config	section:key=value     add a virtual config value;\n");
 	printf("                              virtual config values won't be saved to the .cfg file\n");
 	printf("                              unless a different value is written to them\n");
+	printf("-benchmark frames             replay the frame of the game savestate without rendering it\n");
+	printf("                              and print the time spent in each render stage\n");
 	printf("-help                         display this help\n");
 
 	exit(0);
@@ -103,6 +106,17 @@ void ParseCommandLine(int argc,char* argv[])
 			cl-=as;
 			arg+=as;
 		}
+		else if (stricmp(*arg,"-benchmark")==0 || stricmp(*arg,"--benchmark")==0)
+		{
+			if (cl >= 1 && atoi(arg[1]) > 0)
+			{
+				settings.benchmarkFrames = atoi(arg[1]);
+				arg++;
+				cl--;
+			}
+			else
+				WARN_LOG(COMMON, "-benchmark : invalid number of frames");
+		}
 #if defined(__APPLE__)
 		else if (!strncmp(*arg, "-NSDocumentRevisions", 20))
 		{
@@ -25,6 +25,9 @@ namespace config {
 // Dynarec
 
 Option<bool> DynarecEnabled("Dynarec.Enabled", true);
+Option<bool> DynarecPersistentCache("Dynarec.PersistentCache");
+Option<bool> DynarecAsyncCompile("Dynarec.AsyncCompile");
+Option<bool> DynarecTraces("Dynarec.Traces");
 Option<int> Sh4Clock("Sh4Clock", 200);
 
 // General
@@ -35,6 +38,8 @@ Option<int> Broadcast("Dreamcast.Broadcast", 0);	// NTSC
 Option<int> Language("Dreamcast.Language", 1);		// English
 Option<bool> AutoLoadState("Dreamcast.AutoLoadState");
 Option<bool> AutoSaveState("Dreamcast.AutoSaveState");
+Option<bool> IncrementalSavestates("Dreamcast.IncrementalSavestates");
+Option<bool> CompactSavestates("Dreamcast.CompactSavestates");
 Option<int, false> SavestateSlot("Dreamcast.SavestateSlot");
 Option<bool> ForceFreePlay("ForceFreePlay", true);
 Option<bool, false> FetchBoxart("FetchBoxart", true);
@@ -44,6 +49,8 @@ Option<int, false> UIScaling("UIScaling", 100);
 // Sound
 
 Option<bool> DSPEnabled("aica.DSPEnabled", false);
+Option<bool> ThreadedArm7("aica.ThreadedArm7", false);
+Option<bool> Arm7DeterminismCheck("aica.Arm7DeterminismCheck", false);
 #if HOST_CPU == CPU_ARM
 Option<int> AudioBufferSize("aica.BufferSize", 5644);	// 128 ms
 #else
@@ -75,7 +82,10 @@ Option<int> TextureUpscale("rend.TextureUpscale", 1);
 Option<int> MaxFilteredTextureSize("rend.MaxFilteredTextureSize", 256);
 Option<float> ExtraDepthScale("rend.ExtraDepthScale", 1.f);
 Option<bool> CustomTextures("rend.CustomTextures");
+Option<int> CustomTexturePackSize("rend.CustomTexturePackSize", 256);
 Option<bool> DumpTextures("rend.DumpTextures");
+Option<int> DecodedTextureCacheSize("rend.DecodedTextureCacheSize");
+Option<bool> DecodedTextureDiskCache("rend.DecodedTextureDiskCache");
 Option<int> ScreenStretching("rend.ScreenStretching", 100);
 Option<bool> Fog("rend.Fog", true);
 Option<bool> FloatVMUs("rend.FloatVMUs");
@@ -103,6 +113,7 @@ Option<int64_t> PixelBufferSize("rend.PixelBufferSize", 512_MB);
 Option<int> AnisotropicFiltering("rend.AnisotropicFiltering", 1);
 Option<int> TextureFiltering("rend.TextureFiltering", 0); // Default
 Option<bool> ThreadedRendering("rend.ThreadedRendering", true);
+Option<bool> ParallelTAParsing("rend.ParallelTAParsing");
 Option<bool> DupeFrames("rend.DupeFrames", false);
 Option<int> PerPixelLayers("rend.PerPixelLayers", 32);
 Option<bool> NativeDepthInterpolation("rend.NativeDepthInterpolation", false);
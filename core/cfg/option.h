@@ -356,6 +356,9 @@ using OptionString = Option<std::string>;
 // Dynarec
 
 extern Option<bool> DynarecEnabled;
+extern Option<bool> DynarecPersistentCache;
+extern Option<bool> DynarecAsyncCompile;
+extern Option<bool> DynarecTraces;
 #ifndef LIBRETRO
 extern Option<int> Sh4Clock;
 #endif
@@ -368,6 +371,8 @@ extern Option<int> Broadcast;	// 0 -> NTSC, 1 -> PAL, 2 -> PAL/M, 3 -> PAL/N, 4
 extern Option<int> Language;	// 0 -> JP, 1 -> EN, 2 -> DE, 3 -> FR, 4 -> SP, 5 -> IT, 6 -> default
 extern Option<bool> AutoLoadState;
 extern Option<bool> AutoSaveState;
+extern Option<bool> IncrementalSavestates;
+extern Option<bool> CompactSavestates;
 extern Option<int, false> SavestateSlot;
 extern Option<bool> ForceFreePlay;
 extern Option<bool, false> FetchBoxart;
@@ -378,6 +383,8 @@ extern Option<int, false> UIScaling;
 
 constexpr bool LimitFPS = true;
 extern Option<bool> DSPEnabled;
+extern Option<bool> ThreadedArm7;
+extern Option<bool> Arm7DeterminismCheck;
 extern Option<int> AudioBufferSize;	//In samples ,*4 for bytes
 extern Option<bool> AutoLatency;
 
@@ -451,7 +458,12 @@ extern Option<int> PerPixelLayers;
 #endif
 extern Option<float> ExtraDepthScale;
 extern Option<bool> CustomTextures;
+extern Option<int> CustomTexturePackSize;	// in MB
 extern Option<bool> DumpTextures;
+#ifndef LIBRETRO
+extern Option<int> DecodedTextureCacheSize;	// in MB
+#endif
+extern Option<bool> DecodedTextureDiskCache;
 extern Option<int> ScreenStretching;	// in percent. 150 means stretch from 4/3 to 6/3
 extern Option<bool> Fog;
 extern Option<bool> FloatVMUs;
@@ -470,6 +482,7 @@ extern Option<int64_t> PixelBufferSize;
 extern Option<int> AnisotropicFiltering;
 extern Option<int> TextureFiltering; // 0: default, 1: force nearest, 2: force linear
 extern Option<bool> ThreadedRendering;
+extern Option<bool> ParallelTAParsing;
 extern Option<bool> DupeFrames;
 extern Option<bool> NativeDepthInterpolation;
 extern Option<bool> EmulateFramebuffer;
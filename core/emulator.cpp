@@ -700,6 +700,8 @@ void Emulator::runInternal()
 			}
 		} while (resetRequested);
 	}
+	// The arm7 thread must be idle when the emulator is stopped
+	aica::syncArm7();
 }
 
 void Emulator::unloadGame()
@@ -7,6 +7,15 @@
 #include "hw/sh4/sh4_sched.h"
 #include "hw/arm7/arm7.h"
 #include "hw/arm7/arm_mem.h"
+#include "hw/mem/addrspace.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include <xxhash.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace aica
 {
@@ -62,9 +71,14 @@ static void update_arm_interrupts()
 }
 
 //sh4 side
+// Set while a deferred sample is generated. The sh4 interrupt is then updated by the next AicaUpdate.
+static bool deferSh4Ints;
+
 static bool UpdateSh4Ints()
 {
 	u32 p_ints = MCIEB->full & MCIPD->full;
+	if (deferSh4Ints)
+		return p_ints != 0;
 	if (p_ints)
 	{
 		if ((SB_ISTEXT & SH4_IRQ_BIT) == 0)
@@ -84,9 +98,187 @@ AicaTimer timers[3];
 int aica_schid = -1;
 constexpr int AICA_TICK = 4535;		// 44.1 KHz
 
-static int AicaUpdate(int tag, int cycles, int jitter, void *arg)
+/*
+	Deferred samples: a sample is generated while the sh4 runs until the next AicaUpdate,
+	either by the arm7 thread or on the emulation thread (netplay and determinism check).
+	The sh4 waits for the sample to complete before accessing aica registers or ram,
+	and the sh4 interrupt is updated from its result by the next AicaUpdate.
+	So the emulated results don't depend on the thread timings, and both ways to run it are identical.
+*/
+enum class DeferredMode {
+	None,
+	Thread,
+	Sync
+};
+static DeferredMode deferredMode = DeferredMode::None;
+static std::thread armThread;
+static bool armThreadRunning;
+static std::mutex armMutex;
+static std::condition_variable armCond;
+static std::condition_variable sampleDoneCond;
+static std::atomic<bool> samplePending;
+static std::atomic<bool> sh4Waiting;
+static std::exception_ptr armException;
+static thread_local bool isArmThread;
+static u64 nextDeterminismCheck;
+
+static void runDeferredSample()
 {
+	deferSh4Ints = true;
 	arm::run(1);
+	deferSh4Ints = false;
+}
+
+// The other thread is usually done within a few microseconds,
+// so spin for a short while before blocking
+template<typename Done>
+static bool spinUntil(Done done)
+{
+	const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+	while (!done())
+	{
+		if (std::chrono::steady_clock::now() >= end)
+			return false;
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+static void armThreadLoop()
+{
+	ThreadName _("Flycast-arm7");
+	isArmThread = true;
+	for (;;)
+	{
+		if (!spinUntil([] { return samplePending.load(std::memory_order_acquire); }))
+		{
+			std::unique_lock<std::mutex> lock(armMutex);
+			armCond.wait(lock, [] { return samplePending.load() || !armThreadRunning; });
+			if (!armThreadRunning)
+				break;
+		}
+		try {
+			runDeferredSample();
+		} catch (...) {
+			deferSh4Ints = false;
+			armException = std::current_exception();
+		}
+		samplePending.store(false);
+		if (sh4Waiting.load())
+		{
+			{
+				std::lock_guard<std::mutex> _(armMutex);
+			}
+			sampleDoneCond.notify_one();
+		}
+	}
+}
+
+void syncArm7()
+{
+	// aica dma accesses the registers from the arm7 thread
+	if (deferredMode != DeferredMode::Thread || isArmThread)
+		return;
+	if (!spinUntil([] { return !samplePending.load(std::memory_order_acquire); }))
+	{
+		std::unique_lock<std::mutex> lock(armMutex);
+		sh4Waiting = true;
+		sampleDoneCond.wait(lock, [] { return !samplePending.load(); });
+		sh4Waiting = false;
+	}
+	if (armException)
+	{
+		std::exception_ptr e = armException;
+		armException = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+static void postSample()
+{
+	sgc::prefetchCdda();
+	if (deferredMode == DeferredMode::Thread)
+	{
+		samplePending.store(true, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> _(armMutex);
+		}
+		armCond.notify_one();
+	}
+	else
+	{
+		runDeferredSample();
+	}
+}
+
+static DeferredMode getDeferredMode()
+{
+	if (config::ThreadedArm7)
+		// Memory watching for rollback isn't thread safe
+		return config::GGPOEnable ? DeferredMode::Sync : DeferredMode::Thread;
+	return config::Arm7DeterminismCheck ? DeferredMode::Sync : DeferredMode::None;
+}
+
+static void setDeferredMode(DeferredMode mode)
+{
+	if (mode == deferredMode)
+		return;
+	syncArm7();
+	if (deferredMode == DeferredMode::Thread)
+	{
+		{
+			std::lock_guard<std::mutex> _(armMutex);
+			armThreadRunning = false;
+		}
+		armCond.notify_one();
+		armThread.join();
+		addrspace::protectAram(false);
+	}
+	if (mode == DeferredMode::Thread && !addrspace::protectAram(true))
+	{
+		WARN_LOG(AICA, "ARM7 thread not supported on this platform");
+		mode = DeferredMode::Sync;
+	}
+	if (mode != DeferredMode::None && deferredMode == DeferredMode::None)
+		sgc::startCddaPrefetch();
+	deferredMode = mode;
+	if (mode == DeferredMode::Thread)
+	{
+		armThreadRunning = true;
+		armThread = std::thread(armThreadLoop);
+	}
+	INFO_LOG(AICA, "ARM7 deferred mode %d", (int)mode);
+}
+
+// Log a hash of the aica state every 10 seconds, which must be identical with and without the arm7 thread
+static void checkDeterminism()
+{
+	const u64 now = sh4_sched_now64();
+	if (!config::Arm7DeterminismCheck || now < nextDeterminismCheck)
+		return;
+	nextDeterminismCheck = now - now % (10 * SH4_MAIN_CLOCK) + 10 * SH4_MAIN_CLOCK;
+	XXH64_state_t *state = XXH64_createState();
+	XXH64_reset(state, 0);
+	XXH64_update(state, aica_reg, sizeof(aica_reg));
+	XXH64_update(state, arm::arm_Reg, sizeof(arm::arm_Reg[0]) * (arm::RN_ARM_REG_COUNT - 1));
+	XXH64_update(state, &aica_ram[0], ARAM_SIZE);
+	NOTICE_LOG(AICA, "ARM7 determinism check @ %llu: %016llx", (unsigned long long)now, (unsigned long long)XXH64_digest(state));
+	XXH64_freeState(state);
+}
+
+static int AicaUpdate(int tag, int cycles, int jitter, void *arg)
+{
+	if (deferredMode != DeferredMode::None)
+	{
+		syncArm7();
+		UpdateSh4Ints();
+		checkDeterminism();
+	}
+	setDeferredMode(getDeferredMode());
+	if (deferredMode != DeferredMode::None)
+		postSample();
+	else
+		arm::run(1);
 
 	return AICA_TICK;
 }
@@ -238,6 +430,7 @@ template void writeTimerAndIntReg<>(u32 reg, u32 data);
 
 void midiSend(u8 data)
 {
+	syncArm7();
 	midiSendBuffer.push_back(data);
 	SCIPD->MIDI_IN = 1;
 	update_arm_interrupts();
@@ -260,10 +453,17 @@ void reset(bool hard)
 {
 	if (hard)
 	{
+		// restarted by the next update once the memory is mapped
+		setDeferredMode(DeferredMode::None);
 		initMem();
 		sgc::term();
 		sgc::init();
 		sh4_sched_request(aica_schid, AICA_TICK);
+		nextDeterminismCheck = 0;
+	}
+	else
+	{
+		syncArm7();
 	}
 	for (std::size_t i = 0; i < std::size(timers); i++)
 		timers[i].Init(aica_reg, i);
@@ -273,6 +473,7 @@ void reset(bool hard)
 
 void term()
 {
+	setDeferredMode(DeferredMode::None);
 	arm::term();
 	sgc::term();
 	termMem();
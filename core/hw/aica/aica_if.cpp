@@ -111,6 +111,7 @@ template void writeRtcReg<>(u32 addr, u32 data);
 template<typename T>
 T readAicaReg(u32 addr)
 {
+	syncArm7();
 	addr &= 0x7FFF;
 	if (sizeof(T) == 1)
 	{
@@ -145,6 +146,7 @@ static void ArmSetRST()
 template<typename T>
 void writeAicaReg(u32 addr, T data)
 {
+	syncArm7();
 	addr &= 0x7FFF;
 
 	if (sizeof(T) == 1)
@@ -326,6 +328,8 @@ void Write_DmaStart(u32 addr, u32 data)
 		std::swap(src, dst);
 	DEBUG_LOG(AICA, "%s: DMA Write to %X from %X %d bytes", LogTag, dst, src, len);
 
+	// may access wave memory
+	syncArm7();
 	WriteMemBlock_nommu_dma(dst, src, len);
 
 	if (lenReg & 0x80000000)
@@ -395,6 +399,7 @@ static void Write_SB_ADST(u32 addr, u32 data)
 			else
 				DEBUG_LOG(AICA, "AICA-DMA : SB_ADDIR==0:DMA Write to 0x%X from 0x%X %x bytes", dst, src, SB_ADLEN);
 
+			syncArm7();
 			WriteMemBlock_nommu_dma(dst, src, len);
 
 			// indicate that dma is in progress
@@ -513,6 +518,7 @@ void sbTerm()
 
 void serialize(Serializer& ser)
 {
+	syncArm7();
 	ser << arm::aica_interr;
 	ser << arm::aica_reg_L;
 	ser << arm::e68k_out;
@@ -548,6 +554,7 @@ void serialize(Serializer& ser)
 
 void deserialize(Deserializer& deser)
 {
+	syncArm7();
 	deser >> arm::aica_interr;
 	deser >> arm::aica_reg_L;
 	deser >> arm::e68k_out;
@@ -583,9 +590,9 @@ void deserialize(Deserializer& deser)
 	deser >> rtc_EN;
 	deser >> RealTimeClock;
 
-	deser >> aica_reg;
+	const bool regsChanged = deser.deserializeChanged(aica_reg);
 
-	sgc::deserialize(deser);
+	sgc::deserialize(deser, regsChanged);
 }
 
 } // namespace aica
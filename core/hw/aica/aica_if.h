@@ -16,6 +16,8 @@ void init();
 void reset(bool hard);
 void term();
 void timeStep();
+// Wait for the sample generated by the arm7 thread before the sh4 accesses aica ram
+void syncArm7();
 void serialize(Serializer& ser);
 void deserialize(Deserializer& deser);
 
@@ -101,9 +101,6 @@ void recInit() {
 
 void recTerm() {
 }
-
-void recompile() {
-}
 #endif
 
 void init()
@@ -68,6 +68,12 @@ void recTerm();
 void runStep();
 void recompile();
 
+// Reference interpreter
+void interpStep();
+// Portable implementation running a pre-decoded program, used when the DSP isn't recompiled
+void decodeProgram();
+void decodedStep();
+
 struct Instruction
 {
 	u8 TRA;
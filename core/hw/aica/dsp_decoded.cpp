@@ -0,0 +1,263 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of flycast.
+
+    flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Portable DSP implementation.
+
+	The MPRO program is decoded once when it changes into a compact list of operations,
+	with the operand selections turned into pointers and masks.
+	Empty instructions whose result is never used are removed.
+*/
+#include "build.h"
+#include "dsp.h"
+#include "aica.h"
+#include "aica_if.h"
+
+namespace aica::dsp
+{
+
+namespace
+{
+
+struct Operation
+{
+	const s32 *input;	// MEMS, MIXS, EXTS or zero
+	u8 inputShift;
+	u8 step;			// index in MPRO
+	u8 TRA;
+	u8 TWA;
+	u8 IWA;
+	u8 EWA;
+	u8 MASA;
+	u8 YSEL;
+	s32 NEGB;			// -1 to negate B, 0 otherwise
+	s32 BMASK;			// 0 if ZERO, -1 otherwise
+	u16 ADREB;			// 0xfff if ADREB, 0 otherwise
+	u8 NXADR;
+	u8 SHIFT;
+	bool nop;
+	bool BSEL;
+	bool XSEL;
+	bool TWT;
+	bool IWT;
+	bool EWT;
+	bool ADRL;
+	bool FRCL;
+	bool YRL;
+	bool MRD;
+	bool MWT;
+	bool TABLE;
+};
+
+const s32 ZeroInput = 0;
+Operation program[128];
+u32 programSize;
+
+bool isNop(const u32 *IPtr) {
+	return IPtr[0] == 0 && IPtr[1] == 0 && IPtr[2] == 0 && IPtr[3] == 0;
+}
+
+// Returns true if the instruction at step uses the ACC value of the previous one
+bool readsAcc(u32 step)
+{
+	const u32 *IPtr = DSPData->MPRO + step * 4;
+	if (isNop(IPtr))
+		return false;
+	Instruction inst;
+	DecodeInst(IPtr, &inst);
+	if (!inst.ZERO && inst.BSEL)
+		return true;
+	// shifter output
+	return inst.TWT || inst.FRCL || inst.EWT || (inst.ADRL && inst.SHIFT == 3) || ((step & 1) && inst.MWT);
+}
+
+} // anonymous namespace
+
+void decodeProgram()
+{
+	programSize = 0;
+	for (u32 step = 0; step < 128; step++)
+	{
+		const u32 *IPtr = DSPData->MPRO + step * 4;
+		Operation& op = program[programSize];
+		op = {};
+		op.step = step;
+		if (isNop(IPtr))
+		{
+			// An empty instruction only updates ACC, so it can be removed if the next instruction doesn't use it
+			if (step < 127 && readsAcc(step + 1))
+			{
+				op.nop = true;
+				programSize++;
+			}
+			continue;
+		}
+		Instruction inst;
+		DecodeInst(IPtr, &inst);
+		if (inst.IRA <= 0x1f) {
+			op.input = &state.MEMS[inst.IRA];
+		}
+		else if (inst.IRA <= 0x2F) {
+			op.input = &state.MIXS[inst.IRA - 0x20];
+			op.inputShift = 4;		// MIXS is 20 bit
+		}
+		else if (inst.IRA <= 0x31) {
+			op.input = (const s32 *)&DSPData->EXTS[inst.IRA - 0x30];
+			op.inputShift = 8;		// EXTS is 16 bits
+		}
+		else {
+			op.input = &ZeroInput;
+		}
+		op.TRA = inst.TRA;
+		op.TWT = inst.TWT;
+		op.TWA = inst.TWA;
+		op.XSEL = inst.XSEL;
+		op.YSEL = inst.YSEL;
+		op.IWT = inst.IWT;
+		op.IWA = inst.IWA;
+		op.EWT = inst.EWT;
+		op.EWA = inst.EWA;
+		op.ADRL = inst.ADRL;
+		op.FRCL = inst.FRCL;
+		op.SHIFT = inst.SHIFT;
+		op.YRL = inst.YRL;
+		op.NEGB = inst.NEGB ? -1 : 0;
+		op.BMASK = inst.ZERO ? 0 : -1;
+		op.BSEL = inst.BSEL;
+		// memory only allowed on odd steps
+		if (step & 1)
+		{
+			op.MRD = inst.MRD;
+			op.MWT = inst.MWT;
+			op.TABLE = inst.TABLE;
+			op.MASA = inst.MASA;
+			op.ADREB = inst.ADREB ? 0xfff : 0;
+			op.NXADR = inst.NXADR;
+		}
+		programSize++;
+	}
+	DEBUG_LOG(AICA, "DSP program decoded: %d operations", programSize);
+}
+
+void decodedStep()
+{
+	s32 ACC = 0;		//26 bit
+	s32 MEMVAL[4] = {0};
+	s32 FRC_REG = 0;	//13 bit
+	s32 Y_REG = 0;		//24 bit
+	u32 ADRS_REG = 0;	//13 bit
+	const u32 MDEC_CT = state.MDEC_CT;
+
+	for (const Operation *op = &program[0]; op != &program[programSize]; op++)
+	{
+		if (op->nop)
+		{
+			s32 X = state.TEMP[MDEC_CT & 0x7F];
+			ACC = (((s64)X * (s64)FRC_REG) >> 12) + X;
+			continue;
+		}
+		// operations are done at 24 bit precision
+		s32 INPUTS = *op->input << op->inputShift;
+		if (op->IWT)
+			state.MEMS[op->IWA] = MEMVAL[op->step & 3];	// MEMVAL was selected in previous MRD
+
+		// Operand sel
+		s32 TEMP = state.TEMP[(op->TRA + MDEC_CT) & 0x7F];
+		// B
+		s32 B = (op->BSEL ? ACC : TEMP) & op->BMASK;
+		B = (B ^ op->NEGB) - op->NEGB;
+		// X
+		s32 X = op->XSEL ? INPUTS : TEMP;
+		// Y
+		s32 Y;
+		switch (op->YSEL)
+		{
+		case 0:
+			Y = FRC_REG;
+			break;
+		case 1:
+			Y = ((s32)(s16)DSPData->COEF[op->step]) >> 3;	//COEF is 16 bits
+			break;
+		case 2:
+			Y = Y_REG >> 11;
+			break;
+		default:
+			Y = (Y_REG >> 4) & 0x0FFF;
+			break;
+		}
+		if (op->YRL)
+			Y_REG = INPUTS;
+
+		// Shifter
+		// There's a 1-step delay at the output of the X*Y + B adder. So we use the ACC value from the previous step.
+		s32 SHIFTED = op->SHIFT == 1 || op->SHIFT == 2 ? ACC << 1 : ACC;
+		if (op->SHIFT < 2)
+			SHIFTED = std::min(std::max(SHIFTED, -0x00800000), 0x007FFFFF);
+
+		// ACCUM
+		ACC = (((s64)X * (s64)Y) >> 12) + B;
+
+		if (op->TWT)
+			state.TEMP[(op->TWA + MDEC_CT) & 0x7F] = SHIFTED;
+
+		if (op->FRCL)
+			FRC_REG = op->SHIFT == 3 ? SHIFTED & 0x0FFF : SHIFTED >> 11;
+
+		if (op->MRD || op->MWT)
+		{
+			u32 ADDR = DSPData->MADRS[op->MASA];
+			ADDR += ADRS_REG & op->ADREB;
+			ADDR += op->NXADR;
+			if (!op->TABLE)
+			{
+				ADDR += MDEC_CT;
+				ADDR &= state.RBL;		// RBL is ring buffer length - 1
+			}
+			else
+				ADDR &= 0xFFFF;
+
+			ADDR <<= 1;					// Word -> byte address
+			ADDR += state.RBP;			// RBP is already a byte address
+			if (op->MRD)
+				MEMVAL[(op->step + 2) & 3] = UNPACK(*(u16 *)&aica_ram[ADDR & ARAM_MASK]);
+			if (op->MWT)
+				*(u16 *)&aica_ram[ADDR & ARAM_MASK] = PACK(SHIFTED);
+		}
+
+		if (op->ADRL)
+			ADRS_REG = op->SHIFT == 3 ? SHIFTED >> 12 : INPUTS >> 16;
+
+		if (op->EWT)
+			DSPData->EFREG[op->EWA] = SHIFTED >> 8;
+	}
+	--state.MDEC_CT;
+	if (state.MDEC_CT == 0)
+		state.MDEC_CT = state.RBL + 1;		// RBL is ring buffer length - 1
+}
+
+#if FEAT_DSPREC != DYNAREC_JIT
+void recompile() {
+	decodeProgram();
+}
+
+void runStep() {
+	decodedStep();
+}
+#endif
+
+} // namespace aica::dsp
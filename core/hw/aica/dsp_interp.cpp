@@ -5,10 +5,6 @@
 // All rights reserved.
 //
 
-#include "build.h"
-
-#if FEAT_DSPREC != DYNAREC_JIT
-
 #include "dsp.h"
 #include "aica.h"
 #include "aica_if.h"
@@ -19,11 +15,8 @@ namespace aica
 namespace dsp
 {
 
-void runStep()
+void interpStep()
 {
-	if (state.stopped)
-		return;
-
 	s32 ACC = 0;		//26 bit
 	s32 SHIFTED = 0;	//24 bit
 	s32 X = 0;			//24 bit
@@ -219,4 +212,3 @@ void runStep()
 
 } // namespace dsp
 } // namespace aica
-#endif
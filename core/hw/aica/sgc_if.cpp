@@ -1461,12 +1461,34 @@ void ReadCommonReg(u32 reg,bool byte)
 
 void vmuBeep(int on, int period)
 {
+	syncArm7();
 	beep.update(on, period);
 }
 
 constexpr int CDDA_SIZE = 2352 / 2;
 static s16 cdda_sector[CDDA_SIZE];
 static u32 cdda_index = CDDA_SIZE;
+// CDDA sectors read ahead by the emulation thread when samples are generated by the arm7 thread
+static s16 cddaQueue[4][CDDA_SIZE];
+static u32 cddaQueueRead;
+static u32 cddaQueueWrite;
+static u32 cddaPrefetchIndex = CDDA_SIZE;
+
+void startCddaPrefetch()
+{
+	cddaPrefetchIndex = cdda_index;
+	cddaQueueRead = cddaQueueWrite = 0;
+}
+
+void prefetchCdda()
+{
+	if (cddaPrefetchIndex >= CDDA_SIZE)
+	{
+		cddaPrefetchIndex = 0;
+		libCore_CDDA_Sector(cddaQueue[cddaQueueWrite++ % std::size(cddaQueue)]);
+	}
+	cddaPrefetchIndex += 2;
+}
 
 void AICA_Sample()
 {
@@ -1483,7 +1505,10 @@ void AICA_Sample()
 	if (cdda_index>=CDDA_SIZE)
 	{
 		cdda_index=0;
-		libCore_CDDA_Sector(cdda_sector);
+		if (cddaQueueRead != cddaQueueWrite)
+			memcpy(cdda_sector, cddaQueue[cddaQueueRead++ % std::size(cddaQueue)], sizeof(cdda_sector));
+		else
+			libCore_CDDA_Sector(cdda_sector);
 	}
 	s32 EXTS0L=cdda_sector[cdda_index];
 	s32 EXTS0R=cdda_sector[cdda_index+1];
@@ -1585,10 +1610,45 @@ void serialize(Serializer& ser)
 		ser << b;
 }
 
-void deserialize(Deserializer& deser)
+// Skips the channel state if it hasn't changed since the rollback snapshot
+static bool skipUnchanged(Deserializer& deser, const ChannelEx& channel)
+{
+	Deserializer peek = deser;
+	const u32 addr = channel.SA - &aica_ram[0];
+	if (peek.skipUnchanged(addr)
+			&& peek.skipUnchanged(channel.CA)
+			&& peek.skipUnchanged(channel.step)
+			&& peek.skipUnchanged(channel.s0)
+			&& peek.skipUnchanged(channel.s1)
+			&& peek.skipUnchanged(channel.loop.looped)
+			&& peek.skipUnchanged(channel.adpcm.last_quant)
+			&& peek.skipUnchanged(channel.adpcm.loopstart_quant)
+			&& peek.skipUnchanged(channel.adpcm.loopstart_prev_sample)
+			&& peek.skipUnchanged(channel.adpcm.in_loop)
+			&& peek.skipUnchanged(channel.noise_state)
+			&& peek.skipUnchanged(channel.AEG.val)
+			&& peek.skipUnchanged(channel.AEG.state)
+			&& peek.skipUnchanged(channel.FEG.value)
+			&& peek.skipUnchanged(channel.FEG.state)
+			&& peek.skipUnchanged(channel.FEG.prev1)
+			&& peek.skipUnchanged(channel.FEG.prev2)
+			&& peek.skipUnchanged(channel.lfo.counter)
+			&& peek.skipUnchanged(channel.lfo.state)
+			&& peek.skipUnchanged(channel.enabled))
+	{
+		deser = peek;
+		return true;
+	}
+	return false;
+}
+
+void deserialize(Deserializer& deser, bool regsChanged)
 {
 	for (ChannelEx& channel : Chans)
 	{
+		// The derived state of the channel only depends on its registers and serialized state
+		if (!regsChanged && skipUnchanged(deser, channel))
+			continue;
 		channel.quiet = true;
 		u32 addr;
 		deser >> addr;
@@ -1630,6 +1690,8 @@ void deserialize(Deserializer& deser)
 	beep.deserialize(deser);
 	deser >> cdda_sector;
 	deser >> cdda_index;
+	cddaPrefetchIndex = cdda_index;
+	cddaQueueRead = cddaQueueWrite = 0;
 	midiSendBuffer.clear();
 	if (deser.version() >= Deserializer::V28)
 	{
@@ -5,6 +5,9 @@ namespace aica::sgc
 {
 
 void AICA_Sample();
+// Read the CDDA data of the next sample ahead of its generation
+void prefetchCdda();
+void startCddaPrefetch();
 
 void WriteChannelReg(u32 channel, u32 reg, int size);
 
@@ -43,7 +46,8 @@ typedef s32 SampleType;
 
 void ReadCommonReg(u32 reg, bool byte);
 void serialize(Serializer& ctx);
-void deserialize(Deserializer& ctx);
+// Channels unchanged since the rollback snapshot are skipped if the registers haven't changed either
+void deserialize(Deserializer& ctx, bool regsChanged = true);
 void vmuBeep(int on, int period);
 
 } // namespace aica::sgc
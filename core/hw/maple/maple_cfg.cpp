@@ -452,6 +452,21 @@ void mcfg_SerializeDevices(Serializer& ser)
 		}
 }
 
+// Skips the pending DMA output if it hasn't changed since the rollback snapshot
+static bool skipUnchangedDmaOut(Deserializer& deser)
+{
+	Deserializer peek = deser;
+	if (!peek.skipUnchanged((u32)mapleDmaOut.size()))
+		return false;
+	for (const auto& pair : mapleDmaOut)
+		if (!peek.skipUnchanged(pair.first)
+				|| !peek.skipUnchanged((u32)pair.second.size())
+				|| !peek.skipUnchanged(pair.second.data(), pair.second.size() * sizeof(u32)))
+			return false;
+	deser = peek;
+	return true;
+}
+
 void mcfg_DeserializeDevices(Deserializer& deser)
 {
 	if (!deser.rollback())
@@ -466,9 +481,13 @@ void mcfg_DeserializeDevices(Deserializer& deser)
 	deser >> maple_ddt_pending_reset;
 	if (deser.version() >= Deserializer::V47)
 		deser >> SDCKBOccupied;
-	mapleDmaOut.clear();
-	if (deser.version() >= Deserializer::V23)
+	if (deser.version() < Deserializer::V23)
+	{
+		mapleDmaOut.clear();
+	}
+	else if (!skipUnchangedDmaOut(deser))
 	{
+		mapleDmaOut.clear();
 		u32 size;
 		deser >> size;
 		for (u32 i = 0; i < size; i++)
@@ -352,8 +352,11 @@ struct maple_sega_vmu: maple_base
 	{
 		maple_base::deserialize(deser);
 		deser >> flash_data;
-		deser >> lcd_data;
+		// Don't update the lcd image if unchanged since the rollback snapshot
+		const bool lcdChanged = deser.deserializeChanged(lcd_data);
 		deser >> lcd_data_decoded;
+		if (!lcdChanged)
+			return;
 		for (u8 b : lcd_data)
 			if (b != 0)
 			{
@@ -767,13 +770,18 @@ struct maple_microphone: maple_base
 	}
 	void deserialize(Deserializer& deser) override
 	{
-		if (sampling)
-			StopAudioRecording();
+		const bool wasSampling = sampling;
+		const bool wasEightKhz = eight_khz;
 		maple_base::deserialize(deser);
 		deser >> gain;
 		deser >> sampling;
 		deser >> eight_khz;
 		deser.skip(480 - sizeof(u32) - sizeof(bool) * 2, Deserializer::V23);
+		// Keep recording during rollbacks if the sampling state hasn't changed
+		if (deser.rollback() && sampling == wasSampling && eight_khz == wasEightKhz)
+			return;
+		if (wasSampling)
+			StopAudioRecording();
 		if (sampling)
 			StartAudioRecording(eight_khz);
 	}
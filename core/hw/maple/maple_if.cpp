@@ -5,6 +5,7 @@
 #include "hw/holly/sb.h"
 #include "hw/sh4/sh4_mem.h"
 #include "hw/sh4/sh4_sched.h"
+#include "hw/mem/mem_watch.h"
 #include "network/ggpo.h"
 #include "hw/naomi/card_reader.h"
 
@@ -356,6 +357,8 @@ void maple_ReconnectDevices()
 {
 	mcfg_DestroyDevices();
 	reconnect_time = sh4_sched_now64() + SH4_MAIN_CLOCK / 10;
+	// Savestate deltas don't recreate the devices. The next savestate must be a full one.
+	memwatch::generation++;
 }
 
 static void maple_handle_reconnect()
@@ -364,5 +367,6 @@ static void maple_handle_reconnect()
 	{
 		reconnect_time = 0;
 		mcfg_CreateDevices();
+		memwatch::generation++;
 	}
 }
@@ -525,6 +525,23 @@ void unprotectVram(u32 addr, u32 size)
 	}
 }
 
+bool protectAram(bool protect)
+{
+	if (!virtmemEnabled())
+		// always handled by sb_mem
+		return true;
+#ifndef __SWITCH__
+	// aica ram and its mirrors
+	if (protect)
+		virtmem::region_set_noaccess(ram_base + 0x00800000, 8_MB);
+	else
+		virtmem::region_lock(ram_base + 0x00800000, 8_MB);
+	return true;
+#else
+	return false;
+#endif
+}
+
 u32 getVramOffset(void *addr)
 {
 #ifndef __SWITCH__
@@ -80,5 +80,7 @@ bool bm_lockedWrite(u8* address); // FIXME rename?
 void protectVram(u32 addr, u32 size);
 void unprotectVram(u32 addr, u32 size);
 u32 getVramOffset(void *addr);
+// Make all sh4 accesses to aica ram go through the memory handlers
+bool protectAram(bool protect);
 
 } // namespace addrspace
@@ -26,6 +26,39 @@ VramWatcher vramWatcher;
 RamWatcher ramWatcher;
 AicaRamWatcher aramWatcher;
 ElanRamWatcher elanWatcher;
+bool watching;
+u32 generation;
+PagePool pagePool;
+
+u32 PagePool::save(const void *page)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	if (freeSlots.empty())
+	{
+		const u32 first = (u32)blocks.size() * BlockSize;
+		blocks.emplace_back(new Page[BlockSize]);
+		for (u32 slot = first + BlockSize; slot > first; slot--)
+			freeSlots.push_back(slot - 1);
+	}
+	const u32 slot = freeSlots.back();
+	freeSlots.pop_back();
+	memcpy(blocks[slot / BlockSize][slot % BlockSize].data, page, PAGE_SIZE);
+
+	return slot;
+}
+
+void PagePool::release(u32 slot)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	freeSlots.push_back(slot);
+}
+
+void PagePool::clear()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	blocks.clear();
+	freeSlots.clear();
+}
 
 void AicaRamWatcher::protectMem(u32 addr, u32 size)
 {
@@ -25,7 +25,11 @@
 #include "hw/pvr/pvr_mem.h"
 #include "hw/pvr/elan.h"
 #include "rend/TexCache.h"
-#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
 
 namespace memwatch
 {
@@ -37,17 +41,58 @@ struct Page
 	}
 	u8 data[PAGE_SIZE];
 };
-using PageMap = std::unordered_map<u32, Page>;
+
+// Slab of page copies. Freed pages are reused and the memory is only released by clear().
+class PagePool
+{
+public:
+	// Copies the page and returns its slot
+	u32 save(const void *page);
+	void release(u32 slot);
+	const Page& get(u32 slot)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		return blocks[slot / BlockSize][slot % BlockSize];
+	}
+	size_t memorySize()
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		return blocks.size() * BlockSize * sizeof(Page);
+	}
+	void clear();
+
+private:
+	static constexpr u32 BlockSize = 256;
+
+	std::vector<std::unique_ptr<Page[]>> blocks;
+	std::vector<u32> freeSlots;
+	std::mutex mutex;
+};
+extern PagePool pagePool;
+
+struct SavedPage
+{
+	u32 offset;
+	u32 slot;
+};
+using PageList = std::vector<SavedPage>;
 
 template<typename T>
 class Watcher
 {
 	bool started;
-	PageMap pages;
+	// Original content of the written pages, for net rollback
+	PageList pages;
+	// Pages in the list above, indexed by page number
+	std::vector<bool> savedPages;
+	// Offset of the written pages, for incremental savestates
+	std::unordered_set<u32> dirtyPages;
+	std::mutex mutex;
 
 public:
 	void protect()
 	{
+		std::lock_guard<std::mutex> _(mutex);
 		if (!started)
 		{
 			static_cast<T&>(*this).protectMem(0, 0xffffffff);
@@ -55,8 +100,10 @@ public:
 		}
 		else
 		{
-			for (const auto& pair : pages)
-				static_cast<T&>(*this).protectMem(pair.first, PAGE_SIZE);
+			for (const SavedPage& page : pages)
+				static_cast<T&>(*this).protectMem(page.offset, PAGE_SIZE);
+			for (u32 offset : dirtyPages)
+				static_cast<T&>(*this).protectMem(offset, PAGE_SIZE);
 		}
 	}
 
@@ -67,8 +114,13 @@ public:
 
 	void reset()
 	{
+		std::lock_guard<std::mutex> _(mutex);
 		started = false;
+		for (const SavedPage& page : pages)
+			pagePool.release(page.slot);
 		pages.clear();
+		savedPages.clear();
+		dirtyPages.clear();
 	}
 
 	bool hit(void *addr)
@@ -77,20 +129,44 @@ public:
 		if (offset == (u32)-1)
 			return false;
 		offset &= ~PAGE_MASK;
-	    auto rv = pages.emplace(offset, Page());
-	    if (!rv.second)
-	      // already saved
-	      return true;
-	    Page& page = rv.first->second;
-	    memcpy(&page.data[0], static_cast<T&>(*this).getMemPage(offset), PAGE_SIZE);
+		std::lock_guard<std::mutex> _(mutex);
+		if (config::GGPOEnable)
+		{
+			const u32 index = offset / PAGE_SIZE;
+			if (index >= savedPages.size())
+				savedPages.resize(index + 1);
+			if (!savedPages[index])
+			{
+				savedPages[index] = true;
+				pages.push_back({ offset, pagePool.save(static_cast<T&>(*this).getMemPage(offset)) });
+			}
+		}
+		else
+		{
+			dirtyPages.insert(offset);
+		}
+		// The page may have been protected again since it was first saved
 		static_cast<T&>(*this).unprotectMem(offset, PAGE_SIZE);
 		return true;
 	}
 
-	void getPages(PageMap& other)
+	// Returns the pages saved since the last call. The list passed in must be empty.
+	// Its storage is reused.
+	void getPages(PageList& other)
 	{
+		std::lock_guard<std::mutex> _(mutex);
+		for (const SavedPage& page : pages)
+			savedPages[page.offset / PAGE_SIZE] = false;
 		std::swap(pages, other);
-		pages = PageMap();
+	}
+
+	// Returns the sorted offsets of the pages written since the last call
+	void getDirtyPages(std::vector<u32>& offsets)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		offsets.assign(dirtyPages.begin(), dirtyPages.end());
+		dirtyPages.clear();
+		std::sort(offsets.begin(), offsets.end());
 	}
 };
 
@@ -185,9 +261,23 @@ extern RamWatcher ramWatcher;
 extern AicaRamWatcher aramWatcher;
 extern ElanRamWatcher elanWatcher;
 
+// Set while memory is write-protected
+extern bool watching;
+// Incremented each time the written pages are discarded or the state can't be restored incrementally
+extern u32 generation;
+
+inline static bool enabled()
+{
+#ifndef TARGET_NO_EXCEPTIONS
+	if (config::IncrementalSavestates)
+		return true;
+#endif
+	return config::GGPOEnable;
+}
+
 inline static bool writeAccess(void *p)
 {
-	if (!config::GGPOEnable)
+	if (!watching)
 		return false;
 	if (ramWatcher.hit(p))
 	{
@@ -206,8 +296,9 @@ inline static bool writeAccess(void *p)
 
 inline static void protect()
 {
-	if (!config::GGPOEnable)
+	if (!enabled())
 		return;
+	watching = true;
 	vramWatcher.protect();
 	ramWatcher.protect();
 	aramWatcher.protect();
@@ -216,6 +307,7 @@ inline static void protect()
 
 inline static void unprotect()
 {
+	watching = false;
 	vramWatcher.unprotect();
 	ramWatcher.unprotect();
 	aramWatcher.unprotect();
@@ -228,6 +320,7 @@ inline static void reset()
 	ramWatcher.reset();
 	aramWatcher.reset();
 	elanWatcher.reset();
+	generation++;
 }
 
 }
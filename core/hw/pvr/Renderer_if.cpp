@@ -353,6 +353,24 @@ void rend_reset()
 	fbAddrHistory[1] = 1;
 }
 
+void rend_set_render_params(TA_context *ctx)
+{
+	FillBGP(ctx);
+
+	ctx->rend.isRTT = (FB_W_SOF1 & 0x1000000) != 0;
+	ctx->rend.fb_W_SOF1 = FB_W_SOF1;
+	ctx->rend.fb_W_CTRL.full = FB_W_CTRL.full;
+
+	ctx->rend.ta_GLOB_TILE_CLIP = TA_GLOB_TILE_CLIP;
+	ctx->rend.scaler_ctl = SCALER_CTL;
+	ctx->rend.fb_X_CLIP = FB_X_CLIP;
+	ctx->rend.fb_Y_CLIP = FB_Y_CLIP;
+	ctx->rend.fb_W_LINESTRIDE = FB_W_LINESTRIDE.stride;
+
+	ctx->rend.fog_clamp_min = FOG_CLAMP_MIN;
+	ctx->rend.fog_clamp_max = FOG_CLAMP_MAX;
+}
+
 void rend_start_render()
 {
 	render_called = true;
@@ -387,20 +405,7 @@ void rend_start_render()
 	if (ctx == nullptr)
 		return;
 
-	FillBGP(ctx);
-
-	ctx->rend.isRTT = (FB_W_SOF1 & 0x1000000) != 0;
-	ctx->rend.fb_W_SOF1 = FB_W_SOF1;
-	ctx->rend.fb_W_CTRL.full = FB_W_CTRL.full;
-
-	ctx->rend.ta_GLOB_TILE_CLIP = TA_GLOB_TILE_CLIP;
-	ctx->rend.scaler_ctl = SCALER_CTL;
-	ctx->rend.fb_X_CLIP = FB_X_CLIP;
-	ctx->rend.fb_Y_CLIP = FB_Y_CLIP;
-	ctx->rend.fb_W_LINESTRIDE = FB_W_LINESTRIDE.stride;
-
-	ctx->rend.fog_clamp_min = FOG_CLAMP_MIN;
-	ctx->rend.fog_clamp_max = FOG_CLAMP_MAX;
+	rend_set_render_params(ctx);
 
 	if (!ctx->rend.isRTT)
 	{
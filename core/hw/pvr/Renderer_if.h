@@ -9,6 +9,8 @@ bool rend_init_renderer();
 void rend_term_renderer();
 void rend_vblank();
 void rend_start_render();
+// Sets the render parameters of a TA context from the pvr registers
+void rend_set_render_params(TA_context *ctx);
 int rend_end_render(int tag, int cycles, int jitter, void *arg);
 void rend_cancel_emu_wait();
 bool rend_single_frame(const bool& enabled);
@@ -22,6 +22,7 @@
 #include "Renderer_if.h"
 #include "ta_ctx.h"
 #include "rend/TexCache.h"
+#include "rend/DecodedTexCache.h"
 #include "serialize.h"
 #include "pvr_mem.h"
 #include "elan.h"
@@ -58,6 +59,7 @@ void init()
 {
 	spg_Init();
 	elan::init();
+	texcache::init();
 }
 
 void term()
@@ -65,6 +67,7 @@ void term()
 	tactx_Term();
 	spg_Term();
 	elan::term();
+	texcache::term();
 }
 
 void serialize(Serializer& ser)
@@ -91,8 +94,10 @@ void deserialize(Deserializer& deser)
 {
 	YUV_deserialize(deser);
 
-	deser >> pvr_regs;
-	fog_needs_update = true;
+	// Fog and palette tables only need to be updated if the registers have changed
+	const bool regsChanged = deser.deserializeChanged(pvr_regs);
+	if (regsChanged)
+		fog_needs_update = true;
 
 	spg_Deserialize(deser);
 
@@ -109,7 +114,8 @@ void deserialize(Deserializer& deser)
 	if (!deser.rollback())
 		vram.deserialize(deser);
 	elan::deserialize(deser);
-	pal_needs_update = true;
+	if (regsChanged)
+		pal_needs_update = true;
 }
 
 }
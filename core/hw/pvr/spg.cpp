@@ -7,6 +7,7 @@
 #include "network/ggpo.h"
 #include "hw/pvr/Renderer_if.h"
 #include "stdclass.h"
+#include "hw/sh4/dyna/ngen.h"
 #include <array>
 
 #ifdef TEST_AUTOMATION
@@ -215,6 +216,13 @@ static int spg_line_sched(int tag, int cycles, int jitter, void *arg)
 					mspdf, spd_cpu * 100 / 200, spd_vbs,
 					spd_vbs / full_rps, mode, res, fullvbs,
 					spd_fps, fskip / ts);
+#if FEAT_SHREC != DYNAREC_NONE
+				if (rdv_blockDispatches != 0)
+				{
+					INFO_LOG(DYNAREC, "Block dispatches: %.0f per frame", rdv_blockDispatches / ts / std::max(spd_vbs, 1.0));
+					rdv_blockDispatches = 0;
+				}
+#endif
 				
 				fskip = 0;
 				last_fps = getTimeMs();
@@ -5,7 +5,9 @@
 #include "serialize.h"
 #include "stdclass.h"
 
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 extern u32 fskip;
@@ -39,7 +41,7 @@ void SetCurrentTARC(u32 addr)
 		
 		//clear context
 		ta_ctx=0;
-		ta_tad.Reset(0);
+		ta_tad.Reset(nullptr, 0);
 	}
 }
 
@@ -103,7 +105,132 @@ void FinishRender(TA_context* ctx)
 static std::mutex mtx_pool;
 
 static std::vector<TA_context*> ctx_pool;
+// Contexts in use, in creation order
 static std::vector<TA_context*> ctx_list;
+// Same contexts indexed by address
+static std::unordered_map<u32, TA_context*> ctx_map;
+
+// Recycled contexts are deleted when the pool is full or its TA data exceeds this budget
+constexpr size_t MaxPoolSize = 16;
+constexpr size_t PoolTADataBudget = 32_MB;
+
+// Largest display list seen since the last reset. Pooled and new contexts are sized after it
+// so that frames can be parsed without reallocating.
+static RendContextSizes highWaterMark;
+static std::atomic<u32> contextCount;
+static std::atomic<u32> peakContextCount;
+static std::atomic<size_t> taDataMemory;
+static std::atomic<size_t> peakTADataMemory;
+
+// Contexts are created and resized by the emulation and render threads
+template<typename T>
+static void updatePeak(std::atomic<T>& peak, T value)
+{
+	T cur = peak.load(std::memory_order_relaxed);
+	while (cur < value && !peak.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+		;
+}
+
+void tad_context::reserve(u32 newSize)
+{
+	if (newSize <= size)
+		return;
+	u8 *newRoot = (u8 *)allocAligned(32, newSize);
+	if (thd_root != nullptr)
+	{
+		memcpy(newRoot, thd_root, std::max(thd_data, thd_old_data) - thd_root);
+		freeAligned(thd_root);
+	}
+	thd_data = newRoot + (thd_data - thd_root);
+	thd_old_data = newRoot + (thd_old_data - thd_root);
+	thd_root = newRoot;
+	updatePeak(peakTADataMemory, taDataMemory += newSize - size);
+	size = newSize;
+}
+
+TA_context::TA_context() {
+	updatePeak(peakContextCount, ++contextCount);
+}
+
+TA_context::~TA_context()
+{
+	verify(tad.End() - tad.thd_root <= (ptrdiff_t)tad.size);
+	freeAligned(tad.thd_root);
+	taDataMemory -= tad.size;
+	contextCount--;
+}
+
+bool tactx_GrowTAData()
+{
+	verify(ta_ctx != nullptr);
+	if (ta_tad.size >= TA_DATA_SIZE)
+		return false;
+	ta_tad.reserve(ta_tad.size == 0 ? TA_DATA_INITIAL_SIZE : std::min<u32>(ta_tad.size * 2, TA_DATA_SIZE));
+	// The context owns the buffer
+	ta_ctx->tad = ta_tad;
+	return true;
+}
+
+void rend_context::reserve(const RendContextSizes& sizes)
+{
+	verts.reserve(sizes.verts);
+	idx.reserve(sizes.idx);
+	modtrig.reserve(sizes.modtrig);
+	global_param_op.reserve(sizes.op);
+	global_param_pt.reserve(sizes.pt);
+	global_param_tr.reserve(sizes.tr);
+	global_param_mvo.reserve(sizes.mvo);
+	global_param_mvo_tr.reserve(sizes.mvo_tr);
+	sortedTriangles.reserve(sizes.sortedTriangles);
+	matrices.reserve(sizes.matrices);
+	lightModels.reserve(sizes.lightModels);
+}
+
+static void updateHighWaterMark(const rend_context& rend)
+{
+	auto update = [](u32& hwm, size_t size) {
+		hwm = std::max(hwm, (u32)size);
+	};
+	update(highWaterMark.verts, rend.verts.size());
+	update(highWaterMark.idx, rend.idx.size());
+	update(highWaterMark.modtrig, rend.modtrig.size());
+	update(highWaterMark.op, rend.global_param_op.size());
+	update(highWaterMark.pt, rend.global_param_pt.size());
+	update(highWaterMark.tr, rend.global_param_tr.size());
+	update(highWaterMark.mvo, rend.global_param_mvo.size());
+	update(highWaterMark.mvo_tr, rend.global_param_mvo_tr.size());
+	update(highWaterMark.sortedTriangles, rend.sortedTriangles.size());
+	update(highWaterMark.matrices, rend.matrices.size());
+	update(highWaterMark.lightModels, rend.lightModels.size());
+}
+
+// Default sizes, or 25% above the high-water mark
+static RendContextSizes reserveSizes()
+{
+	auto size = [](u32 def, u32 hwm) {
+		return std::max(def, hwm + hwm / 4);
+	};
+	const bool naomi2 = settings.platform.isNaomi2();
+	RendContextSizes sizes;
+	sizes.verts = size(32768, highWaterMark.verts);
+	sizes.idx = size(32768, highWaterMark.idx);
+	sizes.modtrig = size(16384, highWaterMark.modtrig);
+	sizes.op = size(4096, highWaterMark.op);
+	sizes.pt = size(4096, highWaterMark.pt);
+	sizes.tr = size(4096, highWaterMark.tr);
+	sizes.mvo = size(4096, highWaterMark.mvo);
+	sizes.mvo_tr = size(4096, highWaterMark.mvo_tr);
+	sizes.sortedTriangles = size(0, highWaterMark.sortedTriangles);
+	sizes.matrices = size(naomi2 ? 2000 : 0, highWaterMark.matrices);
+	sizes.lightModels = size(naomi2 ? 150 : 0, highWaterMark.lightModels);
+	return sizes;
+}
+
+RendContextSizes tactx_GetReserveSizes()
+{
+	std::lock_guard<std::mutex> _(mtx_pool);
+	return reserveSizes();
+}
 
 TA_context *tactx_Alloc()
 {
@@ -130,13 +257,19 @@ static void tactx_Recycle(TA_context* ctx)
 	if (ctx->nextContext != nullptr)
 		tactx_Recycle(ctx->nextContext);
 	mtx_pool.lock();
-	if (ctx_pool.size() > 3)
+	updateHighWaterMark(ctx->rend);
+	size_t poolTAData = ctx->tad.size;
+	for (const TA_context *pooled : ctx_pool)
+		poolTAData += pooled->tad.size;
+	if (ctx_pool.size() >= MaxPoolSize || poolTAData > PoolTADataBudget)
 	{
 		delete ctx;
 	}
 	else
 	{
 		ctx->Reset();
+		// Grow now rather than while parsing the next frame
+		ctx->rend.reserve(reserveSizes());
 		ctx_pool.push_back(ctx);
 	}
 	mtx_pool.unlock();
@@ -144,24 +277,24 @@ static void tactx_Recycle(TA_context* ctx)
 
 static TA_context *tactx_Find(u32 addr, bool allocnew)
 {
-	TA_context *oldCtx = nullptr;
-	for (TA_context *ctx : ctx_list)
+	auto it = ctx_map.find(addr);
+	if (it != ctx_map.end())
 	{
-		if (ctx->Address == addr)
-		{
-			ctx->lastFrameUsed = FrameCount;
-			return ctx;
-		}
-		if (FrameCount - ctx->lastFrameUsed > 60)
-			oldCtx = ctx;
+		it->second->lastFrameUsed = FrameCount;
+		return it->second;
 	}
 
 	if (allocnew)
 	{
+		TA_context *oldCtx = nullptr;
+		for (TA_context *ctx : ctx_list)
+			if (FrameCount - ctx->lastFrameUsed > 60)
+				oldCtx = ctx;
 		TA_context *ctx;
 		if (oldCtx != nullptr)
 		{
 			ctx = oldCtx;
+			ctx_map.erase(ctx->Address);
 			ctx->Reset();
 		}
 		else
@@ -171,6 +304,7 @@ static TA_context *tactx_Find(u32 addr, bool allocnew)
 		}
 		ctx->Address = addr;
 		ctx->lastFrameUsed = FrameCount;
+		ctx_map[addr] = ctx;
 
 		return ctx;
 	}
@@ -179,21 +313,18 @@ static TA_context *tactx_Find(u32 addr, bool allocnew)
 
 TA_context *tactx_Pop(u32 addr)
 {
-	for (size_t i = 0; i < ctx_list.size(); i++)
-	{
-		if (ctx_list[i]->Address == addr)
-		{
-			TA_context *ctx = ctx_list[i];
-			
-			if (::ta_ctx == ctx)
-				SetCurrentTARC(TACTX_NONE);
+	auto it = ctx_map.find(addr);
+	if (it == ctx_map.end())
+		return nullptr;
+	TA_context *ctx = it->second;
 
-			ctx_list.erase(ctx_list.begin() + i);
+	if (::ta_ctx == ctx)
+		SetCurrentTARC(TACTX_NONE);
 
-			return ctx;
-		}
-	}
-	return nullptr;
+	ctx_map.erase(it);
+	ctx_list.erase(std::find(ctx_list.begin(), ctx_list.end(), ctx));
+
+	return ctx;
 }
 
 void tactx_Term()
@@ -204,11 +335,25 @@ void tactx_Term()
 	for (TA_context *ctx : ctx_list)
 		delete ctx;
 	ctx_list.clear();
+	ctx_map.clear();
 
 	mtx_pool.lock();
 	for (TA_context *ctx : ctx_pool)
 		delete ctx;
 	ctx_pool.clear();
+	if (peakContextCount != 0)
+	{
+		INFO_LOG(PVR, "TA contexts for %s: peak %d contexts, peak TA data %d KB", settings.content.gameId.c_str(),
+				peakContextCount.load(), (int)(peakTADataMemory / 1024));
+		INFO_LOG(PVR, "TA context high-water mark: verts %d, idx %d, modtrig %d, op %d, pt %d, tr %d, mvo %d, mvo_tr %d, "
+				"sorted tr %d, matrices %d, lights %d",
+				highWaterMark.verts, highWaterMark.idx, highWaterMark.modtrig, highWaterMark.op, highWaterMark.pt, highWaterMark.tr,
+				highWaterMark.mvo, highWaterMark.mvo_tr, highWaterMark.sortedTriangles, highWaterMark.matrices, highWaterMark.lightModels);
+	}
+	highWaterMark = {};
+	// Contexts being rendered are still alive
+	peakContextCount = contextCount.load();
+	peakTADataMemory = taDataMemory.load();
 	mtx_pool.unlock();
 }
 
@@ -247,6 +392,9 @@ static void deserializeContext(Deserializer& deser, TA_context **pctx)
 	u32 size;
 	deser >> size;
 	tad_context& tad = (*pctx)->tad;
+	if (size > TA_DATA_SIZE)
+		throw Deserializer::Exception("Invalid TA data size");
+	tad.reserve(std::max<u32>(size, TA_DATA_INITIAL_SIZE));
 	deser.deserialize(tad.thd_root, size);
 	tad.thd_data = tad.thd_root + size;
 	if (deser.version() < Deserializer::V26)
@@ -281,6 +429,7 @@ void DeserializeTAContext(Deserializer& deser)
 		for (const auto& ctx : ctx_list)
 			tactx_Recycle(ctx);
 		ctx_list.clear();
+		ctx_map.clear();
 		for (u32 i = 0; i < listSize; i++)
 		{
 			TA_context *ctx;
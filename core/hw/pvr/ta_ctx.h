@@ -139,9 +139,10 @@ constexpr size_t MAX_PASSES = 10;
 
 struct  tad_context
 {
-	u8* thd_data;
-	u8* thd_root;
-	u8* thd_old_data;
+	u8* thd_data = nullptr;
+	u8* thd_root = nullptr;
+	u8* thd_old_data = nullptr;
+	u32 size = 0;		// allocated size of the TA data buffer
 
 	void Clear()
 	{
@@ -159,11 +160,15 @@ struct  tad_context
 		return thd_data == thd_root ? thd_old_data : thd_data;
 	}
 
-	void Reset(u8* ptr)
+	void Reset(u8* ptr, u32 size)
 	{
 		thd_root = ptr;
+		this->size = size;
 		Clear();
 	}
+
+	// Grows the TA data buffer to the given size, keeping its contents
+	void reserve(u32 newSize);
 };
 
 struct RenderPass {
@@ -227,6 +232,22 @@ struct SortedTriangle
 	u32 count;
 };
 
+// Number of elements of the rend_context vectors
+struct RendContextSizes
+{
+	u32 verts;
+	u32 idx;
+	u32 modtrig;
+	u32 op;
+	u32 pt;
+	u32 tr;
+	u32 mvo;
+	u32 mvo_tr;
+	u32 sortedTriangles;
+	u32 matrices;
+	u32 lightModels;
+};
+
 struct rend_context
 {
 	f32 fZ_max;
@@ -286,6 +307,8 @@ struct rend_context
 	}
 
 	void newRenderPass();
+	// Grows the vectors so that they can hold the given number of elements without reallocating
+	void reserve(const RendContextSizes& sizes);
 
 	// For RTT TODO merge with framebufferWidth/Height
 	u32 getFramebufferWidth() const
@@ -317,6 +340,10 @@ struct rend_context
 };
 
 #define TA_DATA_SIZE 8_MB
+// TA data buffers are allocated on first use with this size, then doubled up to TA_DATA_SIZE
+constexpr u32 TA_DATA_INITIAL_SIZE = 256_KB;
+
+RendContextSizes tactx_GetReserveSizes();
 
 //vertex lists
 struct TA_context
@@ -354,38 +381,20 @@ struct TA_context
 
 	void Alloc()
 	{
-		tad.Reset((u8*)allocAligned(32, TA_DATA_SIZE));
-
-		rend.verts.reserve(32768);
-		rend.idx.reserve(32768);
-		rend.global_param_op.reserve(4096);
-		rend.global_param_pt.reserve(4096);
-		rend.global_param_tr.reserve(4096);
-		rend.global_param_mvo.reserve(4096);
-		rend.global_param_mvo_tr.reserve(4096);
-		rend.modtrig.reserve(16384);
-
-		if (settings.platform.isNaomi2())
-		{
-			rend.matrices.reserve(2000);
-			rend.lightModels.reserve(150);
-		}
+		rend.reserve(tactx_GetReserveSizes());
 		Reset();
 	}
 
 	void Reset()
 	{
-		verify(tad.End() - tad.thd_root <= (ptrdiff_t)TA_DATA_SIZE);
+		verify(tad.End() - tad.thd_root <= (ptrdiff_t)tad.size);
 		tad.Clear();
 		nextContext = nullptr;
 		rend.Clear();
 	}
 
-	~TA_context()
-	{
-		verify(tad.End() - tad.thd_root <= (ptrdiff_t)TA_DATA_SIZE);
-		freeAligned(tad.thd_root);
-	}
+	TA_context();
+	~TA_context();
 };
 
 extern TA_context* ta_ctx;
@@ -394,6 +403,8 @@ extern tad_context ta_tad;
 TA_context* tactx_Pop(u32 addr);
 void tactx_Term();
 TA_context *tactx_Alloc();
+// Grows the TA data buffer of the current context. Returns false if it has reached its maximum size.
+bool tactx_GrowTAData();
 
 /*
 	Ta Context
@@ -429,6 +440,8 @@ void ta_parse_reset();
 void getRegionTileAddrAndSize(u32& address, u32& size);
 
 void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previousPass);
+// Total time spent sorting translucent polygons by ta_parse, in ns
+extern u64 ta_sortTime;
 void sortPolyParams(std::vector<PolyParam>& polys, int first, int end, rend_context& ctx);
 void fix_texture_bleeding(const std::vector<PolyParam>& polys, int first, int end, rend_context& ctx);
 void makeIndex(std::vector<PolyParam>& polys, int first, int end, bool merge, rend_context& ctx);
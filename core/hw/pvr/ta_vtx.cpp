@@ -11,6 +11,7 @@
 #include "cfg/option.h"
 
 #include <algorithm>
+#include <chrono>
 #include <utility>
 
 #define TACALL DYNACALL
@@ -25,8 +26,7 @@ static u8 float_to_satu8(float val) {
 	return f32_su8_tbl[(u32&)val >> 16];
 }
 
-static TA_context *vd_ctx;
-#define vd_rc (vd_ctx->rend)
+#define vd_rc (*state->rend)
 
 constexpr u32 ListType_None = -1;
 
@@ -38,6 +38,7 @@ static f32 f16(u16 v)
 
 class BaseTAParser
 {
+protected:
 	static Ta_Dma *DYNACALL NullVertexData(Ta_Dma *data, Ta_Dma *data_end)
 	{
 		INFO_LOG(PVR, "TA: Invalid state, ignoring VTX data");
@@ -45,72 +46,98 @@ class BaseTAParser
 	}
 
 public:
-	static bool startList(u32 listType)
-	{
-		if (CurrentList != ListType_None)
-			return true;
-		switch (listType)
-		{
-		case ListType_Opaque:
-			CurrentPPlist = &vd_rc.global_param_op;
-			break;
-		case ListType_Punch_Through:
-			CurrentPPlist = &vd_rc.global_param_pt;
-			break;
-		case ListType_Translucent:
-			CurrentPPlist = &vd_rc.global_param_tr;
-			break;
-		case ListType_Opaque_Modifier_Volume:
-		case ListType_Translucent_Modifier_Volume:
-			break;
-		default:
-			WARN_LOG(PVR, "Invalid list type %d", listType);
-			return false;
-		}
-		CurrentList = listType;
-		CurrentPP = nullptr;
-
-		return true;
-	}
-
-	static void endList()
-	{
-		if (CurrentList == ListType_None)
-			return;
-		if (CurrentPP != nullptr && CurrentPP->count == 0 && CurrentPP == &CurrentPPlist->back())
-			CurrentPPlist->pop_back();
-		CurrentPP = nullptr;
-		CurrentPPlist = nullptr;
-
-		if (CurrentList == ListType_Opaque_Modifier_Volume
-				|| CurrentList == ListType_Translucent_Modifier_Volume)
-			endModVol();
-		CurrentList = ListType_None;
-		VertexDataFP = NullVertexData;
-	}
-
 	static int getCurrentList() {
-		return CurrentList;
+		return state->CurrentList;
 	}
 
 	static u32 getTileClip() {
-		return tileclip_val;
+		return state->tileclip_val;
 	}
 
 	static void setTileClip(u32 tileclip) {
-		tileclip_val = tileclip;
+		state->tileclip_val = tileclip;
 	}
 
-protected:
 	typedef Ta_Dma* DYNACALL TaListFP(Ta_Dma* data, Ta_Dma* data_end);
 	typedef void TACALL TaPolyParamFP(void* ptr);
 
+	// Threads parsing TA data segments in parallel have their own parser state.
+	// All other threads share the same one.
+	struct State
+	{
+		rend_context *rend;
+
+		//cache state vars
+		u32 tileclip_val;
+
+		//TA state vars
+		alignas(4) u8 FaceBaseColor[4];
+		alignas(4) u8 FaceOffsColor[4];
+		alignas(4) u8 FaceBaseColor1[4];
+		alignas(4) u8 FaceOffsColor1[4];
+		u32 SFaceBaseColor;
+		u32 SFaceOffsColor;
+		//vdec state variables
+		ModTriangle* lmr;
+
+		u32 CurrentList;
+		TaListFP *VertexDataFP;
+		std::vector<PolyParam> *CurrentPPlist;
+		PolyParam* CurrentPP;
+		TaListFP* TaCmd;
+		bool fetchTextures = true;
+	};
+	static State sharedState;
+	static thread_local State *threadState;
+
+	// The serial parser uses the shared state directly. The parser run by
+	// the worker threads gets it through a thread-local pointer.
+	template<bool Threaded>
+	struct StateRef
+	{
+		State *operator->() const
+		{
+			if constexpr (Threaded)
+				return threadState;
+			else
+				return &sharedState;
+		}
+		State& operator*() const {
+			return *operator->();
+		}
+	};
+	static constexpr StateRef<false> state{};
+
+protected:
+	static const u32 *ta_type_lut;
+};
+
+const u32 *BaseTAParser::ta_type_lut = TaTypeLut::instance().table;
+BaseTAParser::State BaseTAParser::sharedState;
+thread_local BaseTAParser::State *BaseTAParser::threadState = &BaseTAParser::sharedState;
+
+// Part of the TA data that can be parsed independently
+struct TASegment
+{
+	Ta_Dma *begin;
+	Ta_Dma *end;
+	// List continued from the previous segment, or ListType_None if the segment starts a new list
+	u32 listType;
+	BaseTAParser::State state;
+	rend_context rend;
+};
+
+template<int Red = 0, int Green = 1, int Blue = 2, int Alpha = 3, bool Threaded = false>
+class TAParserTempl : public BaseTAParser
+{
+	static constexpr StateRef<Threaded> state{};
+
 	static void endModVol()
 	{
 		std::vector<ModifierVolumeParam> *list = nullptr;
-		if (CurrentList == ListType_Opaque_Modifier_Volume)
+		if (state->CurrentList == ListType_Opaque_Modifier_Volume)
 			list = &vd_rc.global_param_mvo;
-		else if (CurrentList == ListType_Translucent_Modifier_Volume)
+		else if (state->CurrentList == ListType_Translucent_Modifier_Volume)
 			list = &vd_rc.global_param_mvo_tr;
 		else
 			return;
@@ -123,63 +150,6 @@ protected:
 		}
 	}
 
-	static void reset()
-	{
-		memset(FaceBaseColor, 0xff, sizeof(FaceBaseColor));
-		memset(FaceOffsColor, 0xff, sizeof(FaceOffsColor));
-		memset(FaceBaseColor1, 0xff, sizeof(FaceBaseColor1));
-		memset(FaceOffsColor1, 0xff, sizeof(FaceOffsColor1));
-		SFaceBaseColor = 0;
-		SFaceOffsColor = 0;
-		lmr = nullptr;
-		CurrentList = ListType_None;
-		CurrentPP = nullptr;
-		CurrentPPlist = nullptr;
-		VertexDataFP = NullVertexData;
-	}
-
-	static const u32 *ta_type_lut;
-
-	//cache state vars
-	static u32 tileclip_val;
-
-	//TA state vars
-	static u8 FaceBaseColor[4];
-	static u8 FaceOffsColor[4];
-	static u8 FaceBaseColor1[4];
-	static u8 FaceOffsColor1[4];
-	static u32 SFaceBaseColor;
-	static u32 SFaceOffsColor;
-	//vdec state variables
-	static ModTriangle* lmr;
-
-	static u32 CurrentList;
-	static TaListFP *VertexDataFP;
-public:
-	static std::vector<PolyParam> *CurrentPPlist;
-	static PolyParam* CurrentPP;
-	static TaListFP* TaCmd;
-	inline static bool fetchTextures = true;
-};
-
-const u32 *BaseTAParser::ta_type_lut = TaTypeLut::instance().table;
-u32 BaseTAParser::tileclip_val;
-alignas(4) u8 BaseTAParser::FaceBaseColor[4];
-alignas(4) u8 BaseTAParser::FaceOffsColor[4];
-alignas(4) u8 BaseTAParser::FaceBaseColor1[4];
-alignas(4) u8 BaseTAParser::FaceOffsColor1[4];
-u32 BaseTAParser::SFaceBaseColor;
-u32 BaseTAParser::SFaceOffsColor;
-ModTriangle* BaseTAParser::lmr;
-u32 BaseTAParser::CurrentList;
-PolyParam* BaseTAParser::CurrentPP;
-std::vector<PolyParam>* BaseTAParser::CurrentPPlist;
-BaseTAParser::TaListFP *BaseTAParser::TaCmd;
-BaseTAParser::TaListFP *BaseTAParser::VertexDataFP;
-
-template<int Red = 0, int Green = 1, int Blue = 2, int Alpha = 3>
-class TAParserTempl : public BaseTAParser
-{
 	//part : 0 fill all data , 1 fill upper 32B , 2 fill lower 32B
 	//Poly decoder , will be moved to pvr code
 	template <u32 poly_type,u32 part>
@@ -190,7 +160,7 @@ class TAParserTempl : public BaseTAParser
 
 		if constexpr (part == 2)
 		{
-			TaCmd=ta_main;
+			state->TaCmd=ta_main;
 		}
 
 		switch (poly_type)
@@ -255,7 +225,7 @@ case num : {\
 	static Ta_Dma* TACALL ta_modvolB_32(Ta_Dma* data,Ta_Dma* data_end)
 	{
 		AppendModVolVertexB((TA_ModVolB*)data);
-		TaCmd=ta_main;
+		state->TaCmd=ta_main;
 		return data+SZ32;
 	}
 		
@@ -266,7 +236,7 @@ case num : {\
 		{
 			AppendModVolVertexA(&vp->mvolA);
 			//32B more needed , 32B done :)
-			TaCmd=ta_modvolB_32;
+			state->TaCmd=ta_modvolB_32;
 			return data+SZ32;
 		}
 		else
@@ -280,7 +250,7 @@ case num : {\
 	static Ta_Dma* TACALL ta_spriteB_data(Ta_Dma* data,Ta_Dma* data_end)
 	{
 		//32B more needed , 32B done :)
-		TaCmd=ta_main;
+		state->TaCmd=ta_main;
 			
 		AppendSpriteVertexB((TA_Sprite1B*)data);
 
@@ -292,7 +262,7 @@ case num : {\
 		if (data == data_end - SZ32)
 		{
 			//32B more needed , 32B done :)
-			TaCmd=ta_spriteB_data;
+			state->TaCmd=ta_spriteB_data;
 
 			TA_VertexParam* vp=(TA_VertexParam*)data;
 
@@ -335,7 +305,7 @@ case num : {\
 		fist_half:
 			ta_handle_poly<poly_type,1>(data,0);
 			if (data->pcw.EndOfStrip) EndPolyStrip();
-			TaCmd=ta_handle_poly<poly_type,2>;
+			state->TaCmd=ta_handle_poly<poly_type,2>;
 					
 			data+=SZ32;
 		}
@@ -343,7 +313,7 @@ case num : {\
 		return data;
 
 strip_end:
-		TaCmd=ta_main;
+		state->TaCmd=ta_main;
 		if (data->pcw.EndOfStrip)
 			EndPolyStrip();
 		return data+poly_size;
@@ -373,7 +343,7 @@ strip_end:
 		else
 			AppendPolyParam4B((TA_PolyParam4B*)data);
 	
-		TaCmd=ta_main;
+		state->TaCmd=ta_main;
 		return data+SZ32;
 	}
 
@@ -416,16 +386,16 @@ strip_end:
 					setClipMode(data->pcw.User_Clip);
 					//Yep , C++ IS lame & limited
 					#include "ta_const_df.h"
-					if (CurrentList == ListType_None && !startList(data->pcw.ListType))
+					if (state->CurrentList == ListType_None && !startList(data->pcw.ListType))
 					{
 						// Invalid list type
 						data += SZ32;
 					}
-					else if (IsModVolList(CurrentList))
+					else if (IsModVolList(state->CurrentList))
 					{
 						//accept mod data
 						StartModVol((TA_ModVolParam*)data);
-						VertexDataFP = ta_mod_vol_data;
+						state->VertexDataFP = ta_mod_vol_data;
 						data += SZ32;
 					}
 					else
@@ -442,7 +412,7 @@ strip_end:
 							u32 pdid = (u8)uid;
 							u32 ppid = (u8)(uid >> 8);
 
-							VertexDataFP = ta_poly_data_lut[pdid];
+							state->VertexDataFP = ta_poly_data_lut[pdid];
 
 							if (data <= data_end - psz)
 							{
@@ -455,7 +425,7 @@ strip_end:
 								// 64B, first part
 								ta_poly_param_a_lut[ppid](data);
 								// Handle next 32B
-								TaCmd = ta_poly_param_b_lut[ppid];
+								state->TaCmd = ta_poly_param_b_lut[ppid];
 								data += SZ32;
 							}
 						}
@@ -466,9 +436,9 @@ strip_end:
 				//Sets Sprite info , and switches to ta_sprite_data function
 			case ParamType_Sprite:
 				setClipMode(data->pcw.User_Clip);
-				if (CurrentList != ListType_None || startList(data->pcw.ListType))
+				if (state->CurrentList != ListType_None || startList(data->pcw.ListType))
 				{
-					VertexDataFP = ta_sprite_data;
+					state->VertexDataFP = ta_sprite_data;
 					AppendSpriteParam((TA_SpriteParam*)data);
 				}
 				data += SZ32;
@@ -476,7 +446,7 @@ strip_end:
 
 				//Variable size
 			case ParamType_Vertex_Parameter:
-				data = VertexDataFP(data, data_end);
+				data = state->VertexDataFP(data, data_end);
 				break;
 
 				//not handled
@@ -497,10 +467,64 @@ strip_end:
 	TAParserTempl();
 
 public:
+	static bool startList(u32 listType)
+	{
+		if (state->CurrentList != ListType_None)
+			return true;
+		switch (listType)
+		{
+		case ListType_Opaque:
+			state->CurrentPPlist = &vd_rc.global_param_op;
+			break;
+		case ListType_Punch_Through:
+			state->CurrentPPlist = &vd_rc.global_param_pt;
+			break;
+		case ListType_Translucent:
+			state->CurrentPPlist = &vd_rc.global_param_tr;
+			break;
+		case ListType_Opaque_Modifier_Volume:
+		case ListType_Translucent_Modifier_Volume:
+			break;
+		default:
+			WARN_LOG(PVR, "Invalid list type %d", listType);
+			return false;
+		}
+		state->CurrentList = listType;
+		state->CurrentPP = nullptr;
+
+		return true;
+	}
+
+	static void endList()
+	{
+		if (state->CurrentList == ListType_None)
+			return;
+		if (state->CurrentPP != nullptr && state->CurrentPP->count == 0 && state->CurrentPP == &state->CurrentPPlist->back())
+			state->CurrentPPlist->pop_back();
+		state->CurrentPP = nullptr;
+		state->CurrentPPlist = nullptr;
+
+		if (state->CurrentList == ListType_Opaque_Modifier_Volume
+				|| state->CurrentList == ListType_Translucent_Modifier_Volume)
+			endModVol();
+		state->CurrentList = ListType_None;
+		state->VertexDataFP = NullVertexData;
+	}
+
 	static void reset()
 	{
-		TaCmd = ta_main;
-		BaseTAParser::reset();
+		state->TaCmd = ta_main;
+		memset(state->FaceBaseColor, 0xff, sizeof(state->FaceBaseColor));
+		memset(state->FaceOffsColor, 0xff, sizeof(state->FaceOffsColor));
+		memset(state->FaceBaseColor1, 0xff, sizeof(state->FaceBaseColor1));
+		memset(state->FaceOffsColor1, 0xff, sizeof(state->FaceOffsColor1));
+		state->SFaceBaseColor = 0;
+		state->SFaceOffsColor = 0;
+		state->lmr = nullptr;
+		state->CurrentList = ListType_None;
+		state->CurrentPP = nullptr;
+		state->CurrentPPlist = nullptr;
+		state->VertexDataFP = NullVertexData;
 		setClipRect(0, 0, 39, 14);
 		setClipMode(0);
 	}
@@ -508,30 +532,30 @@ public:
 private:
 	static void setClipRect(u32 xmin, u32 ymin, u32 xmax, u32 ymax)
 	{
-		u32 rv = tileclip_val & 0xF0000000;
+		u32 rv = state->tileclip_val & 0xF0000000;
 		rv |= xmin; 		// 6 bits
 		rv |= xmax << 6;	// 6 bits
 		rv |= ymin << 12;	// 5 bits
 		rv |= ymax << 17;	// 5 bits
-		tileclip_val = rv;
+		state->tileclip_val = rv;
 	}
 
 	static void setClipMode(u32 mode)
 	{
 		//Group_En bit seems ignored, thanks p1pkin
-		tileclip_val = (tileclip_val & ~0xF0000000) | (mode << 28);
+		state->tileclip_val = (state->tileclip_val & ~0xF0000000) | (mode << 28);
 	}
 
 	//Polys  -- update code on sprites if that gets updated too --
 	template<class T>
 	static void glob_param_bdc_(T* pp)
 	{
-		PolyParam* d_pp = CurrentPP;
+		PolyParam* d_pp = state->CurrentPP;
 		if (d_pp == NULL || d_pp->count != 0)
 		{
-			CurrentPPlist->emplace_back();
-			d_pp = &CurrentPPlist->back();
-			CurrentPP = d_pp;
+			state->CurrentPPlist->emplace_back();
+			d_pp = &state->CurrentPPlist->back();
+			state->CurrentPP = d_pp;
 		}
 		d_pp->init();
 		d_pp->first = vd_rc.verts.size();
@@ -540,9 +564,9 @@ private:
 		d_pp->tsp = pp->tsp;
 		d_pp->tcw = pp->tcw;
 		d_pp->pcw = pp->pcw;
-		d_pp->tileclip = tileclip_val;
+		d_pp->tileclip = state->tileclip_val;
 
-		if (d_pp->pcw.Texture && fetchTextures)
+		if (d_pp->pcw.Texture && state->fetchTextures)
 			d_pp->texture = renderer->GetTexture(d_pp->tsp, d_pp->tcw);
 	}
 
@@ -574,7 +598,7 @@ private:
 		TA_PolyParam1* pp=(TA_PolyParam1*)vpp;
 
 		glob_param_bdc(pp);
-		poly_float_color(FaceBaseColor,FaceColor);
+		poly_float_color(state->FaceBaseColor,FaceColor);
 	}
 
 	// Intensity, use Offset Color
@@ -589,8 +613,8 @@ private:
 	{
 		TA_PolyParam2B* pp=(TA_PolyParam2B*)vpp;
 
-		poly_float_color(FaceBaseColor,FaceColor);
-		poly_float_color(FaceOffsColor,FaceOffset);
+		poly_float_color(state->FaceBaseColor,FaceColor);
+		poly_float_color(state->FaceOffsColor,FaceOffset);
 	}
 
 	// Packed Color, with Two Volumes
@@ -600,10 +624,10 @@ private:
 
 		glob_param_bdc(pp);
 
-		CurrentPP->tsp1.full = pp->tsp1.full;
-		CurrentPP->tcw1.full = pp->tcw1.full;
-		if (pp->pcw.Texture && fetchTextures)
-			CurrentPP->texture1 = renderer->GetTexture(pp->tsp1, pp->tcw1);
+		state->CurrentPP->tsp1.full = pp->tsp1.full;
+		state->CurrentPP->tcw1.full = pp->tcw1.full;
+		if (pp->pcw.Texture && state->fetchTextures)
+			state->CurrentPP->texture1 = renderer->GetTexture(pp->tsp1, pp->tcw1);
 	}
 
 	// Intensity, with Two Volumes
@@ -613,31 +637,31 @@ private:
 
 		glob_param_bdc(pp);
 
-		CurrentPP->tsp1.full = pp->tsp1.full;
-		CurrentPP->tcw1.full = pp->tcw1.full;
-		if (pp->pcw.Texture && fetchTextures)
-			CurrentPP->texture1 = renderer->GetTexture(pp->tsp1, pp->tcw1);
+		state->CurrentPP->tsp1.full = pp->tsp1.full;
+		state->CurrentPP->tcw1.full = pp->tcw1.full;
+		if (pp->pcw.Texture && state->fetchTextures)
+			state->CurrentPP->texture1 = renderer->GetTexture(pp->tsp1, pp->tcw1);
 	}
 
 	static void TACALL AppendPolyParam4B(void* vpp)
 	{
 		TA_PolyParam4B* pp=(TA_PolyParam4B*)vpp;
 
-		poly_float_color(FaceBaseColor, FaceColor0);
-		poly_float_color(FaceBaseColor1, FaceColor1);
+		poly_float_color(state->FaceBaseColor, FaceColor0);
+		poly_float_color(state->FaceBaseColor1, FaceColor1);
 	}
 
 	//Poly Strip handling
 	static void EndPolyStrip()
 	{
-		CurrentPP->count = vd_rc.verts.size() - CurrentPP->first;
+		state->CurrentPP->count = vd_rc.verts.size() - state->CurrentPP->first;
 
-		if (CurrentPP->count > 0)
+		if (state->CurrentPP->count > 0)
 		{
-			CurrentPPlist->push_back(*CurrentPP);
-			CurrentPP = &CurrentPPlist->back();
-			CurrentPP->first = vd_rc.verts.size();
-			CurrentPP->count = 0;
+			state->CurrentPPlist->push_back(*state->CurrentPP);
+			state->CurrentPP = &state->CurrentPPlist->back();
+			state->CurrentPP->first = vd_rc.verts.size();
+			state->CurrentPP->count = 0;
 		}
 	}
 	
@@ -716,31 +740,31 @@ private:
 
 	#define vert_face_base_color(baseint) \
 		{ u32 satint = float_to_satu8(vtx->baseint); \
-		cv->col[Red] = FaceBaseColor[Red] * satint / 256;  \
-		cv->col[Green] = FaceBaseColor[Green] * satint / 256;  \
-		cv->col[Blue] = FaceBaseColor[Blue] * satint / 256;  \
-		cv->col[Alpha] = FaceBaseColor[Alpha]; }
+		cv->col[Red] = state->FaceBaseColor[Red] * satint / 256;  \
+		cv->col[Green] = state->FaceBaseColor[Green] * satint / 256;  \
+		cv->col[Blue] = state->FaceBaseColor[Blue] * satint / 256;  \
+		cv->col[Alpha] = state->FaceBaseColor[Alpha]; }
 
 	#define vert_face_offs_color(offsint) \
 		{ u32 satint = float_to_satu8(vtx->offsint); \
-		cv->spc[Red] = FaceOffsColor[Red] * satint / 256;  \
-		cv->spc[Green] = FaceOffsColor[Green] * satint / 256;  \
-		cv->spc[Blue] = FaceOffsColor[Blue] * satint / 256;  \
-		cv->spc[Alpha] = FaceOffsColor[Alpha]; }
+		cv->spc[Red] = state->FaceOffsColor[Red] * satint / 256;  \
+		cv->spc[Green] = state->FaceOffsColor[Green] * satint / 256;  \
+		cv->spc[Blue] = state->FaceOffsColor[Blue] * satint / 256;  \
+		cv->spc[Alpha] = state->FaceOffsColor[Alpha]; }
 
 	#define vert_face_base_color1(baseint) \
 		{ u32 satint = float_to_satu8(vtx->baseint); \
-		cv->col1[Red] = FaceBaseColor1[Red] * satint / 256;  \
-		cv->col1[Green] = FaceBaseColor1[Green] * satint / 256;  \
-		cv->col1[Blue] = FaceBaseColor1[Blue] * satint / 256;  \
-		cv->col1[Alpha] = FaceBaseColor1[Alpha]; }
+		cv->col1[Red] = state->FaceBaseColor1[Red] * satint / 256;  \
+		cv->col1[Green] = state->FaceBaseColor1[Green] * satint / 256;  \
+		cv->col1[Blue] = state->FaceBaseColor1[Blue] * satint / 256;  \
+		cv->col1[Alpha] = state->FaceBaseColor1[Alpha]; }
 
 	#define vert_face_offs_color1(offsint) \
 		{ u32 satint = float_to_satu8(vtx->offsint); \
-		cv->spc1[Red] = FaceOffsColor1[Red] * satint / 256;  \
-		cv->spc1[Green] = FaceOffsColor1[Green] * satint / 256;  \
-		cv->spc1[Blue] = FaceOffsColor1[Blue] * satint / 256;  \
-		cv->spc1[Alpha] = FaceOffsColor1[Alpha]; }
+		cv->spc1[Red] = state->FaceOffsColor1[Red] * satint / 256;  \
+		cv->spc1[Green] = state->FaceOffsColor1[Green] * satint / 256;  \
+		cv->spc1[Blue] = state->FaceOffsColor1[Blue] * satint / 256;  \
+		cv->spc1[Alpha] = state->FaceOffsColor1[Alpha]; }
 
 
 	//(Non-Textured, Packed Color)
@@ -953,14 +977,14 @@ private:
 	//Sprites
 	static void AppendSpriteParam(TA_SpriteParam* spr)
 	{
-		PolyParam* d_pp = CurrentPP;
-		if (CurrentPP == NULL || CurrentPP->count != 0)
+		PolyParam* d_pp = state->CurrentPP;
+		if (state->CurrentPP == NULL || state->CurrentPP->count != 0)
 		{
-			if (CurrentPPlist == nullptr)	// wldkickspw
+			if (state->CurrentPPlist == nullptr)	// wldkickspw
 				return;
-			CurrentPPlist->emplace_back();
-			d_pp = &CurrentPPlist->back();
-			CurrentPP = d_pp;
+			state->CurrentPPlist->emplace_back();
+			d_pp = &state->CurrentPPlist->back();
+			state->CurrentPP = d_pp;
 		}
 		d_pp->init();
 		d_pp->first = vd_rc.verts.size();
@@ -968,20 +992,20 @@ private:
 		d_pp->tsp = spr->tsp;
 		d_pp->tcw = spr->tcw;
 		d_pp->pcw = spr->pcw;
-		d_pp->tileclip = tileclip_val;
+		d_pp->tileclip = state->tileclip_val;
 
-		if (d_pp->pcw.Texture && fetchTextures)
+		if (d_pp->pcw.Texture && state->fetchTextures)
 			d_pp->texture = renderer->GetTexture(d_pp->tsp, d_pp->tcw);
 
-		SFaceBaseColor = spr->BaseCol;
-		SFaceOffsColor = spr->OffsCol;
+		state->SFaceBaseColor = spr->BaseCol;
+		state->SFaceOffsColor = spr->OffsCol;
         
         d_pp->isp.CullMode ^= 1;
 	}
 
 	#define append_sprite(indx) \
-		vert_packed_color_(cv[indx].col,SFaceBaseColor)\
-		vert_packed_color_(cv[indx].spc,SFaceOffsColor)
+		vert_packed_color_(cv[indx].col,state->SFaceBaseColor)\
+		vert_packed_color_(cv[indx].spc,state->SFaceOffsColor)
 
 	#define sprite_uv(indx,u_name,v_name) \
 		cv[indx].u = f16(sv->u_name);\
@@ -990,9 +1014,9 @@ private:
 	//Sprite Vertex Handlers
 	static void AppendSpriteVertexA(TA_Sprite1A* sv)
 	{
-		if (CurrentPP == nullptr)
+		if (state->CurrentPP == nullptr)
 			return;
-        CurrentPP->count = 4;
+        state->CurrentPP->count = 4;
 
         vd_rc.verts.resize(vd_rc.verts.size() + 4);
 		Vertex *cv = &vd_rc.verts.back() - 3;
@@ -1067,7 +1091,7 @@ private:
 
 	static void AppendSpriteVertexB(TA_Sprite1B* sv)
 	{
-		if (CurrentPP == nullptr)
+		if (state->CurrentPP == nullptr)
 			return;
 		vert_res_base;
 		cv-=3;
@@ -1089,9 +1113,9 @@ private:
 
 		update_fz(cv[0].z);
 
-		CurrentPPlist->push_back(*CurrentPP);
-		PolyParam *d_pp = &CurrentPPlist->back();
-		CurrentPP = d_pp;
+		state->CurrentPPlist->push_back(*state->CurrentPP);
+		PolyParam *d_pp = &state->CurrentPPlist->back();
+		state->CurrentPP = d_pp;
 		d_pp->first = vd_rc.verts.size();
 		d_pp->count = 0;
 	}
@@ -1103,12 +1127,12 @@ private:
 		endModVol();
 
 		ModifierVolumeParam *p = NULL;
-		if (CurrentList == ListType_Opaque_Modifier_Volume)
+		if (state->CurrentList == ListType_Opaque_Modifier_Volume)
 		{
 			vd_rc.global_param_mvo.emplace_back();
 			p = &vd_rc.global_param_mvo.back();
 		}
-		else if (CurrentList == ListType_Translucent_Modifier_Volume)
+		else if (state->CurrentList == ListType_Translucent_Modifier_Volume)
 		{
 			vd_rc.global_param_mvo_tr.emplace_back();
 			p = &vd_rc.global_param_mvo_tr.back();
@@ -1119,42 +1143,245 @@ private:
 		p->isp.full = param->isp.full;
 		p->isp.VolumeLast = param->pcw.Volume != 0;
 		p->first = vd_rc.modtrig.size();
-		p->tileclip = tileclip_val;
+		p->tileclip = state->tileclip_val;
 	}
 
 	static void AppendModVolVertexA(TA_ModVolA* mvv)
 	{
-		if (CurrentList != ListType_Opaque_Modifier_Volume && CurrentList != ListType_Translucent_Modifier_Volume)
+		if (state->CurrentList != ListType_Opaque_Modifier_Volume && state->CurrentList != ListType_Translucent_Modifier_Volume)
 			return;
 		vd_rc.modtrig.emplace_back();
-		lmr = &vd_rc.modtrig.back();
+		state->lmr = &vd_rc.modtrig.back();
 
-		lmr->x0=mvv->x0;
-		lmr->y0=mvv->y0;
-		lmr->z0=mvv->z0;
+		state->lmr->x0=mvv->x0;
+		state->lmr->y0=mvv->y0;
+		state->lmr->z0=mvv->z0;
 		//update_fz(mvv->z0);
 
-		lmr->x1=mvv->x1;
-		lmr->y1=mvv->y1;
-		lmr->z1=mvv->z1;
+		state->lmr->x1=mvv->x1;
+		state->lmr->y1=mvv->y1;
+		state->lmr->z1=mvv->z1;
 		//update_fz(mvv->z1);
 
-		lmr->x2=mvv->x2;
+		state->lmr->x2=mvv->x2;
 	}
 
 	static void AppendModVolVertexB(TA_ModVolB* mvv)
 	{
-		if (CurrentList != ListType_Opaque_Modifier_Volume && CurrentList != ListType_Translucent_Modifier_Volume)
+		if (state->CurrentList != ListType_Opaque_Modifier_Volume && state->CurrentList != ListType_Translucent_Modifier_Volume)
 			return;
-		lmr->y2=mvv->y2;
-		lmr->z2=mvv->z2;
+		state->lmr->y2=mvv->y2;
+		state->lmr->z2=mvv->z2;
 		//update_fz(mvv->z2);
 	}
+
+public:
+	// Splits the TA data into lists, and large polygon lists into parts starting with a polygon or sprite parameter.
+	// Only complete lists are split. The shared parser state is updated as if the data had been parsed
+	// up to the end of the last complete list, which is returned.
+	static Ta_Dma *splitSegments(Ta_Dma *data, Ta_Dma *data_end, std::vector<TASegment>& segments, u32& count)
+	{
+		constexpr ptrdiff_t MinSegmentSize = 1024;	// in 32B units
+
+		count = 0;
+		// The parser must be between two lists
+		if (state->CurrentList != ListType_None || state->TaCmd != ta_main)
+			return data;
+
+		Ta_Dma *begin = data;
+		State listState = *state;
+		u32 complete = 0;
+		u32 listType = ListType_None;
+		u32 vertexSize = SZ32;
+		bool strip = false;
+
+		auto startSegment = [&](Ta_Dma *begin, u32 list) {
+			if (count == segments.size())
+				segments.emplace_back();
+			TASegment& segment = segments[count++];
+			segment.begin = begin;
+			segment.end = begin;
+			segment.listType = list;
+			segment.state = *state;
+		};
+		// New polygons reuse the last empty one, which is kept at the end of a segment when the list continues
+		// in the next one. It is removed when merging the segments.
+		auto splitList = [&]() {
+			if (data - segments[count - 1].begin >= MinSegmentSize)
+			{
+				segments[count - 1].end = data;
+				startSegment(data, listType);
+			}
+		};
+
+		startSegment(data, ListType_None);
+		while (data < data_end)
+		{
+			switch (data->pcw.ParaType)
+			{
+			case ParamType_End_Of_List:
+				data += SZ32;
+				segments[count - 1].end = data;
+				complete = count;
+				listState = *state;
+				listType = ListType_None;
+				vertexSize = SZ32;
+				strip = false;
+				if (data < data_end)
+					startSegment(data, ListType_None);
+				break;
+
+			case ParamType_User_Tile_Clip:
+				setClipRect(data->data_32[3] & 63, data->data_32[4] & 31, data->data_32[5] & 63, data->data_32[6] & 31);
+				data += SZ32;
+				break;
+
+			case ParamType_Object_List_Set:
+				data += SZ32;
+				break;
+
+			case ParamType_Polygon_or_Modifier_Volume:
+				if (listType == ListType_None)
+				{
+					if (data->pcw.ListType > ListType_Punch_Through)
+					{
+						setClipMode(data->pcw.User_Clip);
+						data += SZ32;
+						break;
+					}
+					listType = data->pcw.ListType;
+				}
+				else if (!IsModVolList(listType) && ta_type_lut[data->pcw.obj_ctrl] != TaTypeLut::INVALID_TYPE
+						&& data <= data_end - (ta_type_lut[data->pcw.obj_ctrl] >> 30))
+				{
+					splitList();
+				}
+				setClipMode(data->pcw.User_Clip);
+				if (IsModVolList(listType))
+				{
+					vertexSize = SZ64;
+					strip = false;
+					data += SZ32;
+				}
+				else
+				{
+					u32 uid = ta_type_lut[data->pcw.obj_ctrl];
+					if (uid == TaTypeLut::INVALID_TYPE)
+					{
+						data += SZ32;
+						break;
+					}
+					u32 psz = uid >> 30;
+					u32 pdid = (u8)uid;
+					u32 ppid = (u8)(uid >> 8);
+					if (data > data_end - psz)
+						goto incomplete;
+					if (ppid == 1)
+					{
+						TA_PolyParam1 *pp = (TA_PolyParam1 *)data;
+						poly_float_color(state->FaceBaseColor, FaceColor);
+					}
+					else if (ppid == 2)
+						AppendPolyParam2B((TA_PolyParam2B *)&data[1]);
+					else if (ppid == 4)
+						AppendPolyParam4B((TA_PolyParam4B *)&data[1]);
+					vertexSize = pdid == 5 || pdid == 6 || pdid >= 11 ? SZ64 : SZ32;
+					strip = true;
+					data += psz;
+				}
+				break;
+
+			case ParamType_Sprite:
+				if (listType == ListType_None)
+				{
+					if (data->pcw.ListType > ListType_Punch_Through)
+					{
+						setClipMode(data->pcw.User_Clip);
+						data += SZ32;
+						break;
+					}
+					listType = data->pcw.ListType;
+				}
+				else if (!IsModVolList(listType))
+				{
+					splitList();
+				}
+				setClipMode(data->pcw.User_Clip);
+				if (!IsModVolList(listType))
+				{
+					state->SFaceBaseColor = ((TA_SpriteParam *)data)->BaseCol;
+					state->SFaceOffsColor = ((TA_SpriteParam *)data)->OffsCol;
+				}
+				vertexSize = SZ64;
+				strip = false;
+				data += SZ32;
+				break;
+
+			case ParamType_Vertex_Parameter:
+				if (vertexSize == SZ64 && data == data_end - SZ32)
+					goto incomplete;
+				if (!strip)
+				{
+					data += vertexSize;
+				}
+				else
+				{
+					// Everything up to the end of the strip is vertex data
+					bool endOfStrip;
+					do {
+						endOfStrip = data->pcw.EndOfStrip;
+						data += vertexSize;
+					} while (!endOfStrip && data <= data_end - vertexSize);
+					if (!endOfStrip && data < data_end)
+						goto incomplete;
+				}
+				break;
+
+			default:
+				// Invalid parameter: let the serial parser handle it
+				goto incomplete;
+			}
+		}
+	incomplete:
+		count = complete;
+		*state = listState;
+		return count == 0 ? begin : segments[count - 1].end;
+	}
+
+	// Parses a segment into its own rend_context. Called by worker threads.
+	static void parseSegment(TASegment& segment)
+	{
+		rend_context& rend = segment.rend;
+		rend.verts.clear();
+		rend.modtrig.clear();
+		rend.global_param_op.clear();
+		rend.global_param_pt.clear();
+		rend.global_param_tr.clear();
+		rend.global_param_mvo.clear();
+		rend.global_param_mvo_tr.clear();
+		// Lowest value when compared as integers
+		rend.fZ_max = -0.f;
+
+		static_assert(Threaded, "Segments must be parsed with the thread-local state");
+		threadState = &segment.state;
+		state->rend = &rend;
+		// Textures can only be fetched by the render thread
+		state->fetchTextures = false;
+		if (segment.listType != ListType_None)
+			startList(segment.listType);
+
+		Ta_Dma *data = segment.begin;
+		while (data < segment.end)
+			data = state->TaCmd(data, segment.end);
+		threadState = &sharedState;
+	}
 };
 
 static void getRegionTileClipping(u32& xmin, u32& xmax, u32& ymin, u32& ymax);
 static void getRegionSettings(int passNumber, RenderPass& pass);
 
+u64 ta_sortTime;
+
 static void parseRenderPass(RenderPass& pass, const RenderPass& previousPass, rend_context& ctx, bool primRestart)
 {
 	const bool perPixel = config::RendererType == RenderType::OpenGL_OIT
@@ -1181,10 +1408,12 @@ static void parseRenderPass(RenderPass& pass, const RenderPass& previousPass, re
 	pass.sorted_tr_count = previousPass.sorted_tr_count;
 	if (pass.autosort && !perPixel)
 	{
+		const auto start = std::chrono::steady_clock::now();
 		if (config::PerStripSorting)
 			sortPolyParams(ctx.global_param_tr, previousPass.tr_count, pass.tr_count, ctx);
 		else
 			sortTriangles(ctx, pass, previousPass);
+		ta_sortTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 	}
 	// sortTriangles already created the index
 	if (!pass.autosort || perPixel || config::PerStripSorting)
@@ -1196,14 +1425,116 @@ static void parseRenderPass(RenderPass& pass, const RenderPass& previousPass, re
 	}
 }
 
+using TAParser = TAParserTempl<>;
+using TAParserDX = TAParserTempl<2, 1, 0, 3>;
+// Used when parallel parsing is enabled
+using ThreadedTAParser = TAParserTempl<0, 1, 2, 3, true>;
+using ThreadedTAParserDX = TAParserTempl<2, 1, 0, 3, true>;
+
+// TA data is only parsed in parallel above this size, in 32B units
+constexpr ptrdiff_t ParallelParsingMinSize = 4096;
+static std::vector<TASegment> segments;
+static WorkerPool parserPool("TA parser", std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4u));
+
+static std::vector<PolyParam>& getPolyList(rend_context& rc, u32 listType)
+{
+	switch (listType)
+	{
+	case ListType_Opaque:
+		return rc.global_param_op;
+	case ListType_Punch_Through:
+		return rc.global_param_pt;
+	default:
+		return rc.global_param_tr;
+	}
+}
+
+static void mergePolys(std::vector<PolyParam>& polys, const std::vector<PolyParam>& segmentPolys, u32 vertexBase)
+{
+	TSP lastTsp{};
+	TCW lastTcw{};
+	BaseTextureCacheData *lastTexture = nullptr;
+	for (const PolyParam& segmentPoly : segmentPolys)
+	{
+		polys.push_back(segmentPoly);
+		PolyParam& pp = polys.back();
+		pp.first += vertexBase;
+		if (!pp.pcw.Texture)
+			continue;
+		// Strips of the same polygon share its texture
+		if (lastTexture == nullptr || pp.tsp.full != lastTsp.full || pp.tcw.full != lastTcw.full)
+		{
+			lastTsp = pp.tsp;
+			lastTcw = pp.tcw;
+			lastTexture = renderer->GetTexture(pp.tsp, pp.tcw);
+		}
+		pp.texture = lastTexture;
+		// Polygon with two volumes
+		if (pp.pcw.Volume && pp.pcw.ParaType == ParamType_Polygon_or_Modifier_Volume)
+			pp.texture1 = renderer->GetTexture(pp.tsp1, pp.tcw1);
+	}
+}
+
+static void mergeModVols(std::vector<ModifierVolumeParam>& params, const std::vector<ModifierVolumeParam>& segmentParams, u32 trigBase)
+{
+	// Like the serial parser, the first volume of a list updates the count of the last volume of the previous list
+	if (!segmentParams.empty() && !params.empty())
+		params.back().count = trigBase + segmentParams.front().first - params.back().first;
+	for (const ModifierVolumeParam& param : segmentParams)
+	{
+		params.push_back(param);
+		params.back().first += trigBase;
+	}
+}
+
+// Parses the complete lists of the TA data on worker threads and appends the results in order.
+// Returns where serial parsing must resume.
+template<typename Parser>
+static Ta_Dma *parseParallel(rend_context& ctx, Ta_Dma *data, Ta_Dma *data_end)
+{
+	u32 count;
+	data = Parser::splitSegments(data, data_end, segments, count);
+	if (count == 0)
+		return data;
+	parserPool.run(count, [](u32 i) {
+		Parser::parseSegment(segments[i]);
+	});
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const TASegment& segment = segments[i];
+		const rend_context& rend = segment.rend;
+		const u32 vertexBase = ctx.verts.size();
+		const u32 trigBase = ctx.modtrig.size();
+		ctx.verts.insert(ctx.verts.end(), rend.verts.begin(), rend.verts.end());
+		ctx.modtrig.insert(ctx.modtrig.end(), rend.modtrig.begin(), rend.modtrig.end());
+		mergePolys(ctx.global_param_op, rend.global_param_op, vertexBase);
+		mergePolys(ctx.global_param_pt, rend.global_param_pt, vertexBase);
+		mergePolys(ctx.global_param_tr, rend.global_param_tr, vertexBase);
+		mergeModVols(ctx.global_param_mvo, rend.global_param_mvo, trigBase);
+		mergeModVols(ctx.global_param_mvo_tr, rend.global_param_mvo_tr, trigBase);
+		float fZ_max = rend.fZ_max;
+		if ((s32&)fZ_max > (s32&)ctx.fZ_max)
+			ctx.fZ_max = fZ_max;
+
+		// When a list continues in the next segment, its first polygon replaces the empty one
+		// left at the end of this segment
+		if (i + 1 < count && segments[i + 1].listType != ListType_None
+				&& segment.state.CurrentPP != nullptr && segment.state.CurrentPP->count == 0)
+			getPolyList(ctx, segments[i + 1].listType).pop_back();
+	}
+
+	return data;
+}
+
 static void ta_parse_vdrc(TA_context* ctx, bool primRestart)
 {
-	verify(vd_ctx == nullptr);
-	vd_ctx = ctx;
+	verify(BaseTAParser::state->rend == nullptr);
+	BaseTAParser::state->rend = &ctx->rend;
 
 	ta_parse_reset();
 
-	PolyParam *bgpp = &vd_rc.global_param_op.front();
+	PolyParam *bgpp = &ctx->rend.global_param_op.front();
 	if (bgpp->pcw.Texture)
 		bgpp->texture = renderer->GetTexture(bgpp->tsp, bgpp->tcw);
 
@@ -1216,9 +1547,17 @@ static void ta_parse_vdrc(TA_context* ctx, bool primRestart)
 		Ta_Dma* ta_data = (Ta_Dma *)childCtx->getTADataBegin();
 		Ta_Dma* ta_data_end = (Ta_Dma *)childCtx->getTADataEnd();
 
+		if (config::ParallelTAParsing && ta_data_end - ta_data >= ParallelParsingMinSize)
+		{
+			if (isDirectX(config::RendererType))
+				ta_data = parseParallel<ThreadedTAParserDX>(ctx->rend, ta_data, ta_data_end);
+			else
+				ta_data = parseParallel<ThreadedTAParser>(ctx->rend, ta_data, ta_data_end);
+		}
+
 		while (ta_data < ta_data_end)
 			try {
-				ta_data = BaseTAParser::TaCmd(ta_data, ta_data_end);
+				ta_data = BaseTAParser::state->TaCmd(ta_data, ta_data_end);
 			} catch (const TAParserException& e) {
 				break;
 			}
@@ -1226,29 +1565,29 @@ static void ta_parse_vdrc(TA_context* ctx, bool primRestart)
 		// Disable blending for opaque polys of the first pass
 		if (pass == 0)
 		{
-			for (PolyParam& pp : vd_rc.global_param_op) {
+			for (PolyParam& pp : ctx->rend.global_param_op) {
 				pp.tsp.DstInstr = 0;
 				pp.tsp.SrcInstr = 1;
 			}
 		}
 
-		bool empty_pass = vd_rc.global_param_op.size() == (pass == 0 ? 0u : (int)vd_rc.render_passes.back().op_count)
-				&& vd_rc.global_param_pt.size() == (pass == 0 ? 0u : (int)vd_rc.render_passes.back().pt_count)
-				&& vd_rc.global_param_tr.size() == (pass == 0 ? 0u : (int)vd_rc.render_passes.back().tr_count);
+		bool empty_pass = ctx->rend.global_param_op.size() == (pass == 0 ? 0u : (int)ctx->rend.render_passes.back().op_count)
+				&& ctx->rend.global_param_pt.size() == (pass == 0 ? 0u : (int)ctx->rend.render_passes.back().pt_count)
+				&& ctx->rend.global_param_tr.size() == (pass == 0 ? 0u : (int)ctx->rend.render_passes.back().tr_count);
 
 		if (pass == 0 || !empty_pass)
 		{
-			vd_rc.render_passes.emplace_back();
-			RenderPass& render_pass = vd_rc.render_passes.back();
+			ctx->rend.render_passes.emplace_back();
+			RenderPass& render_pass = ctx->rend.render_passes.back();
 			getRegionSettings(pass, render_pass);
-			render_pass.op_count = vd_rc.global_param_op.size();
-			render_pass.pt_count = vd_rc.global_param_pt.size();
-			render_pass.tr_count = vd_rc.global_param_tr.size();
+			render_pass.op_count = ctx->rend.global_param_op.size();
+			render_pass.pt_count = ctx->rend.global_param_pt.size();
+			render_pass.tr_count = ctx->rend.global_param_tr.size();
 			render_pass.sorted_tr_count = 0;
-			render_pass.mvo_count = vd_rc.global_param_mvo.size();
-			render_pass.mvo_tr_count = vd_rc.global_param_mvo_tr.size();
+			render_pass.mvo_count = ctx->rend.global_param_mvo.size();
+			render_pass.mvo_tr_count = ctx->rend.global_param_mvo_tr.size();
 
-			parseRenderPass(render_pass, previousPass, vd_rc, primRestart);
+			parseRenderPass(render_pass, previousPass, ctx->rend, primRestart);
 			previousPass = render_pass;
 		}
 		childCtx = childCtx->nextContext;
@@ -1257,12 +1596,12 @@ static void ta_parse_vdrc(TA_context* ctx, bool primRestart)
 
 	u32 xmin, xmax, ymin, ymax;
 	getRegionTileClipping(xmin, xmax, ymin, ymax);
-	vd_rc.fb_X_CLIP.min = std::max(vd_rc.fb_X_CLIP.min, xmin);
-	vd_rc.fb_X_CLIP.max = std::min(vd_rc.fb_X_CLIP.max, xmax + 31);
-	vd_rc.fb_Y_CLIP.min = std::max(vd_rc.fb_Y_CLIP.min, ymin);
-	vd_rc.fb_Y_CLIP.max = std::min(vd_rc.fb_Y_CLIP.max, ymax + 31);
+	ctx->rend.fb_X_CLIP.min = std::max(ctx->rend.fb_X_CLIP.min, xmin);
+	ctx->rend.fb_X_CLIP.max = std::min(ctx->rend.fb_X_CLIP.max, xmax + 31);
+	ctx->rend.fb_Y_CLIP.min = std::max(ctx->rend.fb_Y_CLIP.min, ymin);
+	ctx->rend.fb_Y_CLIP.max = std::min(ctx->rend.fb_Y_CLIP.max, ymax + 31);
 
-	vd_ctx = nullptr;
+	BaseTAParser::state->rend = nullptr;
 }
 
 static void ta_parse_naomi2(TA_context* ctx, bool primRestart)
@@ -1353,13 +1692,13 @@ static void setDefaultLight()
 void ta_add_poly(const PolyParam& pp)
 {
 	verify(ta_ctx != nullptr);
-	verify(vd_ctx == nullptr);
-	vd_ctx = ta_ctx;
-	BaseTAParser::startList(pp.pcw.ListType);
+	verify(BaseTAParser::state->rend == nullptr);
+	BaseTAParser::state->rend = &ta_ctx->rend;
+	TAParser::startList(pp.pcw.ListType);
 
-	BaseTAParser::CurrentPPlist->push_back(pp);
-	BaseTAParser::CurrentPP = nullptr; // might be invalidated
-	n2CurrentPP = &BaseTAParser::CurrentPPlist->back();
+	BaseTAParser::state->CurrentPPlist->push_back(pp);
+	BaseTAParser::state->CurrentPP = nullptr; // might be invalidated
+	n2CurrentPP = &BaseTAParser::state->CurrentPPlist->back();
 	n2CurrentPP->first = ta_ctx->rend.verts.size();
 	n2CurrentPP->count = 0;
 	n2CurrentPP->tileclip = BaseTAParser::getTileClip();
@@ -1371,15 +1710,15 @@ void ta_add_poly(const PolyParam& pp)
 	setDefaultLight();
 	if (n2CurrentPP->lightModel == -1)
 		n2CurrentPP->lightModel = NoLightIndex;
-	vd_ctx = nullptr;
+	BaseTAParser::state->rend = nullptr;
 }
 
 void ta_add_poly(int listType, const ModifierVolumeParam& mvp)
 {
 	verify(ta_ctx != nullptr);
-	verify(vd_ctx == nullptr);
-	vd_ctx = ta_ctx;
-	BaseTAParser::startList(listType);
+	verify(BaseTAParser::state->rend == nullptr);
+	BaseTAParser::state->rend = &ta_ctx->rend;
+	TAParser::startList(listType);
 
 	switch (BaseTAParser::getCurrentList())
 	{
@@ -1400,7 +1739,7 @@ void ta_add_poly(int listType, const ModifierVolumeParam& mvp)
 	setDefaultMatrices();
 	if (n2CurrentMVP->mvMatrix == -1)
 		n2CurrentMVP->mvMatrix = IdentityMatIndex;
-	vd_ctx = nullptr;
+	BaseTAParser::state->rend = nullptr;
 }
 
 void ta_add_vertex(const Vertex& vtx)
@@ -1431,22 +1770,22 @@ int ta_add_light(const N2LightModel& light)
 
 u32 ta_add_ta_data(u32 *data, u32 size)
 {
-	verify(vd_ctx == nullptr);
-	vd_ctx = ta_ctx;
-	BaseTAParser::fetchTextures = false;
+	verify(BaseTAParser::state->rend == nullptr);
+	BaseTAParser::state->rend = &ta_ctx->rend;
+	BaseTAParser::state->fetchTextures = false;
 
 	Ta_Dma *ta_data = (Ta_Dma *)data;
 	Ta_Dma *ta_data_end = (Ta_Dma *)(data + size / 4);
 	try {
-		ta_data = BaseTAParser::TaCmd(ta_data, ta_data_end);
+		ta_data = BaseTAParser::state->TaCmd(ta_data, ta_data_end);
 	} catch (const FlycastException& e) {
-		vd_ctx = nullptr;
-		BaseTAParser::fetchTextures = true;
+		BaseTAParser::state->rend = nullptr;
+		BaseTAParser::state->fetchTextures = true;
 		throw;
 	}
 
-	vd_ctx = nullptr;
-	BaseTAParser::fetchTextures = true;
+	BaseTAParser::state->rend = nullptr;
+	BaseTAParser::state->fetchTextures = true;
 
 	return (u8 *)ta_data - (u8 *)data;
 }
@@ -1465,12 +1804,12 @@ u32 ta_get_list_type() {
 
 void ta_set_list_type(u32 listType)
 {
-	verify(vd_ctx == nullptr);
-	vd_ctx = ta_ctx;
-	BaseTAParser::endList();
+	verify(BaseTAParser::state->rend == nullptr);
+	BaseTAParser::state->rend = &ta_ctx->rend;
+	TAParser::endList();
 	if (listType != ListType_None)
-		BaseTAParser::startList(listType);
-	vd_ctx = nullptr;
+		TAParser::startList(listType);
+	BaseTAParser::state->rend = nullptr;
 }
 
 //
@@ -1479,13 +1818,20 @@ void ta_set_list_type(u32 listType)
 
 void ta_parse_reset()
 {
-	using TAParser = TAParserTempl<>;
-	using TAParserDX = TAParserTempl<2, 1, 0, 3>;
-
 	if (isDirectX(config::RendererType))
-		TAParserDX::reset();
+	{
+		if (config::ParallelTAParsing)
+			ThreadedTAParserDX::reset();
+		else
+			TAParserDX::reset();
+	}
 	else
-		TAParser::reset();
+	{
+		if (config::ParallelTAParsing)
+			ThreadedTAParser::reset();
+		else
+			TAParser::reset();
+	}
 }
 
 //decode a vertex in the native pvr format
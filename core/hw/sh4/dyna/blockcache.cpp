@@ -0,0 +1,532 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "blockcache.h"
+#include "blockmanager.h"
+#include "hw/sh4/sh4_core.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/modules/mmu.h"
+#include "hw/mem/addrspace.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include "oslib/virtmem.h"
+#include "emulator.h"
+#include "version.h"
+
+#include <unordered_map>
+#include <xxhash.h>
+#include <nowide/cstdio.hpp>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#if FEAT_SHREC != DYNAREC_NONE
+
+namespace blockcache
+{
+
+constexpr u32 MAGIC = 0x43344853;	// SH4C
+constexpr u32 VERSION = 5;
+// Maximum size of the cached code. The rest of the code buffer is left for new blocks.
+constexpr u32 MAX_CODE_SIZE = 4_MB;
+
+struct Header
+{
+	u32 magic;
+	u32 version;
+	char gitHash[16];
+	// host layout
+	u64 functionOffset;		// offset of a host function relative to the code buffer
+	u64 dataOffset;			// offset of a host variable relative to the code buffer
+	u64 imageBase;
+	u64 contextBase;
+	u64 ramBase;
+	// code generation settings
+	u32 ramSize;
+	u32 sh4Clock;
+	u8 platform;
+	u8 virtmem;
+	u8 ggpo;
+	u8 padding;
+	// code buffer layout
+	u32 baseOffset;
+	u32 entryCount;
+};
+
+struct EntryInfo
+{
+	u32 addr;
+	u32 fpuKey;
+	u32 hash;
+	u32 sh4_code_size;
+	u32 guest_cycles;
+	u32 guest_opcodes;
+	u32 host_opcodes;
+	u32 BranchBlock;
+	u32 NextBlock;
+	u32 relink_offset;
+	u32 BlockType;
+	u8 has_jcond;
+	u8 has_fpu_op;
+	u8 smc_checks;
+	u8 padding;
+	u32 codeOffset;
+	u32 codeSize;
+	u32 relocCount;
+};
+
+struct Entry
+{
+	EntryInfo info;
+	std::vector<u8> code;
+	std::vector<CodeRelocation> relocations;
+};
+
+static Sh4CodeBuffer *codeBuffer;
+static bool enabled;
+static std::string cachePath;
+static Header header;
+// Blocks saved in the cache file, or accumulated during this session
+static std::vector<Entry> entries;
+// Blocks compiled since the code buffer was last reset
+static std::vector<Entry> newEntries;
+static std::unordered_map<u64, const Entry *> index;
+// Offset of the first block in the current code buffer
+static u32 epochBase;
+// The cached code is present in the code buffer
+static bool epochValid;
+static bool pendingRestore;
+static Stats stats;
+
+static u32 fpuKey(fpscr_t fpu_cfg)
+{
+	// Only these bits are used by the decoder
+	return fpu_cfg.PR | (fpu_cfg.SZ << 1) | (fpu_cfg.RM << 2);
+}
+
+static u64 makeKey(u32 addr, u32 fpuKey)
+{
+	return ((u64)fpuKey << 32) | addr;
+}
+
+// Hashes the 4 KB pages containing the guest code. Constant reads from these pages
+// may have been folded into the block by the SSA optimizer.
+static u32 hashGuestCode(u32 addr, u32 size)
+{
+	const u32 start = addr & ~0xfff;
+	const u32 end = ((addr + size - 1) | 0xfff) + 1;
+	const u8 *p = GetMemPtr(start, end - start);
+	if (p == nullptr)
+		return 0;
+	return XXH32(p, end - start, 7);
+}
+
+static uintptr_t getRamBase()
+{
+	if (addrspace::virtmemEnabled())
+		return (uintptr_t)addrspace::ram_base;
+	else
+		return (uintptr_t)&mem_b[0];
+}
+
+static void setupHeader(Header& h)
+{
+	memset(&h, 0, sizeof(h));
+	h.magic = MAGIC;
+	h.version = VERSION;
+	strncpy(h.gitHash, GIT_HASH, sizeof(h.gitHash) - 1);
+	uintptr_t codeBase = (uintptr_t)codeBuffer->getBase();
+	h.functionOffset = (uintptr_t)&rdv_FailedToFindBlock - codeBase;
+	h.dataOffset = (uintptr_t)&sh4Dynarec - codeBase;
+	h.imageBase = codeBase;
+	h.contextBase = (uintptr_t)p_sh4rcb;
+	h.ramBase = getRamBase();
+	h.ramSize = settings.platform.ram_size;
+	h.sh4Clock = config::Sh4Clock;
+	h.platform = settings.platform.system;
+	h.virtmem = addrspace::virtmemEnabled();
+	h.ggpo = config::GGPOEnable;
+}
+
+static bool isCompatible(const Header& h)
+{
+	Header cur;
+	setupHeader(cur);
+	return h.magic == cur.magic
+			&& h.version == cur.version
+			&& !strncmp(h.gitHash, cur.gitHash, sizeof(h.gitHash))
+			&& h.functionOffset == cur.functionOffset
+			&& h.dataOffset == cur.dataOffset
+			&& h.ramSize == cur.ramSize
+			&& h.sh4Clock == cur.sh4Clock
+			&& h.platform == cur.platform
+			&& h.virtmem == cur.virtmem
+			&& h.ggpo == cur.ggpo;
+}
+
+// Returns true if the address is inside the executable image
+static bool isInImage(uintptr_t address)
+{
+#ifdef _WIN32
+	constexpr DWORD flags = GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT;
+	HMODULE module;
+	HMODULE imageModule;
+	return GetModuleHandleExW(flags, (LPCWSTR)address, &module)
+			&& GetModuleHandleExW(flags, (LPCWSTR)&rdv_FailedToFindBlock, &imageModule)
+			&& module == imageModule;
+#else
+	Dl_info info;
+	Dl_info imageInfo;
+	return dladdr((const void *)address, &info) != 0
+			&& dladdr((const void *)&rdv_FailedToFindBlock, &imageInfo) != 0
+			&& info.dli_fbase == imageInfo.dli_fbase;
+#endif
+}
+
+bool classifyAddress(uintptr_t address, CodeRelocation::Type& type)
+{
+	if (codeBuffer == nullptr)
+		return false;
+	if (address >= (uintptr_t)p_sh4rcb && address < (uintptr_t)(p_sh4rcb + 1))
+	{
+		type = CodeRelocation::Context;
+		return true;
+	}
+	uintptr_t ramBase = getRamBase();
+	if (address >= ramBase && address < ramBase + (addrspace::virtmemEnabled() ? 512_MB : RAM_SIZE))
+	{
+		type = CodeRelocation::Ram;
+		return true;
+	}
+	// The code buffer is part of the executable on platforms where blocks can be relocated.
+	// Static code and data are relocated along with it.
+	if (address - (uintptr_t)codeBuffer->getBase() < codeBuffer->getSize() || isInImage(address))
+	{
+		type = CodeRelocation::Image;
+		return true;
+	}
+	return false;
+}
+
+static void rebuildIndex()
+{
+	index.clear();
+	for (const Entry& entry : entries)
+		index[makeKey(entry.info.addr, entry.info.fpuKey)] = &entry;
+}
+
+// Add the blocks compiled in the current code buffer epoch to the cache
+static void mergeNewEntries()
+{
+	if (!epochValid || newEntries.empty())
+	{
+		newEntries.clear();
+		return;
+	}
+	if (entries.empty())
+	{
+		setupHeader(header);
+		header.baseOffset = epochBase;
+	}
+	std::unordered_map<u64, size_t> keys;
+	for (size_t i = 0; i < entries.size(); i++)
+		keys[makeKey(entries[i].info.addr, entries[i].info.fpuKey)] = i;
+	for (Entry& entry : newEntries)
+	{
+		if (entry.info.codeOffset + entry.info.codeSize - header.baseOffset > MAX_CODE_SIZE)
+			continue;
+		u64 key = makeKey(entry.info.addr, entry.info.fpuKey);
+		auto it = keys.find(key);
+		if (it != keys.end()) {
+			entries[it->second] = std::move(entry);
+		}
+		else
+		{
+			keys[key] = entries.size();
+			entries.push_back(std::move(entry));
+		}
+	}
+	newEntries.clear();
+	header.entryCount = entries.size();
+}
+
+void restore()
+{
+	if (codeBuffer == nullptr)
+		return;
+	mergeNewEntries();
+	index.clear();
+	pendingRestore = false;
+	epochValid = enabled;
+	epochBase = (u8 *)codeBuffer->get() - (u8 *)codeBuffer->getBase();
+	if (!enabled || entries.empty())
+		return;
+
+	u32 endOffset = epochBase;
+	for (const Entry& entry : entries)
+		endOffset = std::max(endOffset, entry.info.codeOffset + entry.info.codeSize);
+	if (header.baseOffset != epochBase || endOffset - epochBase > codeBuffer->getFreeSpace() / 2)
+	{
+		WARN_LOG(DYNAREC, "Block cache: incompatible code buffer layout. Cache discarded");
+		entries.clear();
+		return;
+	}
+
+	RelocationDeltas deltas;
+	deltas.image = (uintptr_t)codeBuffer->getBase() - header.imageBase;
+	deltas.context = (uintptr_t)p_sh4rcb - header.contextBase;
+	deltas.ram = getRamBase() - header.ramBase;
+	bool relocate = deltas.image != 0 || deltas.context != 0 || deltas.ram != 0;
+
+	u8 *base = (u8 *)codeBuffer->getBase();
+	virtmem::jit_set_exec(base + epochBase, endOffset - epochBase, false);
+	for (Entry& entry : entries)
+	{
+		if (relocate && !sh4Dynarec->relocate(&entry.code[0], entry.info.codeSize, entry.relocations, deltas))
+		{
+			WARN_LOG(DYNAREC, "Block cache: relocation failed. Cache discarded");
+			entries.clear();
+			break;
+		}
+		memcpy(base + entry.info.codeOffset, &entry.code[0], entry.info.codeSize);
+	}
+	virtmem::jit_set_exec(base + epochBase, endOffset - epochBase, true);
+	if (entries.empty())
+		return;
+	virtmem::flush_cache(CC_RW2RX(base + epochBase), CC_RW2RX(base + endOffset), base + epochBase, base + endOffset);
+
+	header.imageBase = (uintptr_t)codeBuffer->getBase();
+	header.contextBase = (uintptr_t)p_sh4rcb;
+	header.ramBase = getRamBase();
+	codeBuffer->advance(endOffset - epochBase);
+	rebuildIndex();
+	stats.entries = entries.size();
+	DEBUG_LOG(DYNAREC, "Block cache: %d blocks restored (%d KB)", (int)entries.size(), (endOffset - epochBase) / 1024);
+}
+
+bool restorePending()
+{
+	return pendingRestore;
+}
+
+bool lookup(RuntimeBlockInfo *block, u32 pc, fpscr_t fpu_cfg)
+{
+	if (!enabled || mmu_enabled())
+		return false;
+	auto it = index.find(makeKey(pc, fpuKey(fpu_cfg)));
+	if (it == index.end())
+	{
+		stats.misses++;
+		return false;
+	}
+	const EntryInfo& info = it->second->info;
+	u8 *code = (u8 *)codeBuffer->getBase() + info.codeOffset;
+	if (hashGuestCode(pc, info.sh4_code_size) != info.hash
+			// code compiled without smc checks can only be used if its pages are write-protected
+			|| (!info.smc_checks && !bm_IsCodeProtectable(pc, info.sh4_code_size))
+			// already in use
+			|| bm_GetBlock(CC_RW2RX(code)) != nullptr)
+	{
+		stats.rejects++;
+		return false;
+	}
+	block->vaddr = pc;
+	block->addr = pc;
+	block->fpu_cfg = fpu_cfg;
+	block->code = (DynarecCodeEntryPtr)code;
+	block->host_code_size = info.codeSize;
+	block->sh4_code_size = info.sh4_code_size;
+	block->guest_cycles = info.guest_cycles;
+	block->guest_opcodes = info.guest_opcodes;
+	block->host_opcodes = info.host_opcodes;
+	block->has_fpu_op = info.has_fpu_op;
+	block->blockcheck_failures = 0;
+	block->temp_block = false;
+	block->BranchBlock = info.BranchBlock;
+	block->NextBlock = info.NextBlock;
+	block->pBranchBlock = nullptr;
+	block->pNextBlock = nullptr;
+	block->relink_offset = info.relink_offset;
+	block->relink_data = 0;
+	block->BlockType = (BlockEndType)info.BlockType;
+	block->has_jcond = info.has_jcond;
+	block->oplist.clear();
+	block->SetProtectedFlags();
+	stats.hits++;
+
+	return true;
+}
+
+void add(const RuntimeBlockInfo *block, bool smc_checks)
+{
+	std::vector<CodeRelocation> relocations;
+	if (sh4Dynarec->getRelocations(block, relocations))
+		add(block, smc_checks, std::move(relocations));
+}
+
+void add(const RuntimeBlockInfo *block, bool smc_checks, std::vector<CodeRelocation>&& relocations)
+{
+	if (!epochValid || block->temp_block || mmu_enabled() || !IsOnRam(block->addr))
+		return;
+	Entry entry;
+	entry.relocations = std::move(relocations);
+	EntryInfo& info = entry.info;
+	memset(&info, 0, sizeof(info));
+	info.addr = block->addr;
+	info.fpuKey = fpuKey(block->fpu_cfg);
+	info.hash = hashGuestCode(block->addr, block->sh4_code_size);
+	info.sh4_code_size = block->sh4_code_size;
+	info.guest_cycles = block->guest_cycles;
+	info.guest_opcodes = block->guest_opcodes;
+	info.host_opcodes = block->host_opcodes;
+	info.BranchBlock = block->BranchBlock;
+	info.NextBlock = block->NextBlock;
+	info.relink_offset = block->relink_offset;
+	info.BlockType = block->BlockType;
+	info.has_jcond = block->has_jcond;
+	info.has_fpu_op = block->has_fpu_op;
+	info.smc_checks = smc_checks;
+	info.codeOffset = (const u8 *)block->code - (const u8 *)codeBuffer->getBase();
+	info.codeSize = block->host_code_size;
+	info.relocCount = entry.relocations.size();
+	entry.code.assign((const u8 *)block->code, (const u8 *)block->code + block->host_code_size);
+	newEntries.push_back(std::move(entry));
+}
+
+static void load()
+{
+	entries.clear();
+	newEntries.clear();
+	index.clear();
+	epochValid = false;
+	stats = {};
+	enabled = config::DynarecPersistentCache && config::DynarecEnabled && !settings.content.gameId.empty();
+	if (!enabled)
+		return;
+	cachePath = hostfs::getBlockCachePath(settings.content.gameId);
+	// make sure the next compiled block resets the code buffer
+	pendingRestore = true;
+
+	FILE *f = nowide::fopen(cachePath.c_str(), "rb");
+	if (f == nullptr)
+		return;
+	bool success = std::fread(&header, sizeof(header), 1, f) == 1 && isCompatible(header);
+	if (success)
+	{
+		entries.resize(header.entryCount);
+		for (Entry& entry : entries)
+		{
+			if (std::fread(&entry.info, sizeof(entry.info), 1, f) != 1
+					|| entry.info.codeSize == 0 || entry.info.codeSize > MAX_CODE_SIZE
+					|| entry.info.relocCount > entry.info.codeSize)
+			{
+				success = false;
+				break;
+			}
+			entry.code.resize(entry.info.codeSize);
+			entry.relocations.resize(entry.info.relocCount);
+			if (std::fread(&entry.code[0], 1, entry.code.size(), f) != entry.code.size()
+					|| (!entry.relocations.empty()
+							&& std::fread(&entry.relocations[0], sizeof(CodeRelocation), entry.relocations.size(), f) != entry.relocations.size()))
+			{
+				success = false;
+				break;
+			}
+		}
+	}
+	std::fclose(f);
+	if (!success)
+	{
+		WARN_LOG(DYNAREC, "Block cache %s is invalid or outdated", cachePath.c_str());
+		entries.clear();
+		return;
+	}
+	stats.entries = entries.size();
+	INFO_LOG(DYNAREC, "Block cache loaded from %s: %d blocks", cachePath.c_str(), (int)entries.size());
+}
+
+static void save()
+{
+	if (!enabled)
+		return;
+	enabled = false;
+	INFO_LOG(DYNAREC, "Block cache: %d hits, %d misses, %d rejected", stats.hits, stats.misses, stats.rejects);
+	mergeNewEntries();
+	epochValid = false;
+	index.clear();
+	if (entries.empty())
+		return;
+	FILE *f = nowide::fopen(cachePath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(DYNAREC, "Can't save block cache to %s", cachePath.c_str());
+		return;
+	}
+	header.entryCount = entries.size();
+	std::fwrite(&header, sizeof(header), 1, f);
+	for (const Entry& entry : entries)
+	{
+		std::fwrite(&entry.info, sizeof(entry.info), 1, f);
+		std::fwrite(&entry.code[0], 1, entry.code.size(), f);
+		if (!entry.relocations.empty())
+			std::fwrite(&entry.relocations[0], sizeof(CodeRelocation), entry.relocations.size(), f);
+	}
+	std::fclose(f);
+	INFO_LOG(DYNAREC, "Block cache saved to %s: %d blocks", cachePath.c_str(), (int)entries.size());
+	entries.clear();
+}
+
+static void eventCallback(Event event, void *)
+{
+	switch (event)
+	{
+	case Event::Start:
+		load();
+		break;
+	case Event::Terminate:
+		save();
+		break;
+	default:
+		break;
+	}
+}
+
+void init(Sh4CodeBuffer& buffer)
+{
+	codeBuffer = &buffer;
+	EventManager::listen(Event::Start, eventCallback);
+	EventManager::listen(Event::Terminate, eventCallback);
+}
+
+void term()
+{
+	EventManager::unlisten(Event::Start, eventCallback);
+	EventManager::unlisten(Event::Terminate, eventCallback);
+	save();
+	codeBuffer = nullptr;
+}
+
+const Stats& getStats()
+{
+	return stats;
+}
+
+}
+#endif	// FEAT_SHREC != DYNAREC_NONE
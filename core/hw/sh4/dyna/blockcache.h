@@ -0,0 +1,60 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// Persistent on-disk cache of compiled SH4 blocks.
+//
+// Blocks compiled during a session are saved along with their host code relocations
+// when the game is unloaded. On the next launch, the host code is copied back at the same
+// offset in the code buffer and relocated. Blocks are only used after their guest code
+// has been validated against the current RAM contents.
+#pragma once
+#include "ngen.h"
+
+namespace blockcache
+{
+
+struct Stats
+{
+	u32 entries;	// blocks available in the cache
+	u32 hits;		// blocks restored from the cache
+	u32 misses;		// blocks not found in the cache
+	u32 rejects;	// blocks found but whose guest code has changed
+};
+
+void init(Sh4CodeBuffer& codeBuffer);
+void term();
+
+// Copy the cached host code back into the code buffer. Must be called after the code buffer has been reset.
+void restore();
+// True if a cache file has been loaded but not restored yet.
+bool restorePending();
+
+// Set up the given block from the cache if possible. Returns false if the block needs to be compiled.
+bool lookup(RuntimeBlockInfo *block, u32 pc, fpscr_t fpu_cfg);
+// Add a newly compiled block to the cache.
+void add(const RuntimeBlockInfo *block, bool smc_checks);
+// Same as above, with the block relocations already retrieved from the dynarec.
+void add(const RuntimeBlockInfo *block, bool smc_checks, std::vector<CodeRelocation>&& relocations);
+
+// Determine whether a host address embedded in generated code needs to be relocated, and which base it's relative to.
+// Returns false if the address isn't relocatable.
+bool classifyAddress(uintptr_t address, CodeRelocation::Type& type);
+
+const Stats& getStats();
+
+}
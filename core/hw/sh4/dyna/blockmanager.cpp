@@ -4,8 +4,6 @@
 */
 
 #include <algorithm>
-#include <set>
-#include <map>
 #include "blockmanager.h"
 #include "ngen.h"
 
@@ -26,16 +24,86 @@ op_agent_t          oprofHandle;
 
 
 typedef std::vector<RuntimeBlockInfoPtr> bm_List;
-typedef std::set<RuntimeBlockInfoPtr> bm_Set;
-typedef std::map<void*, RuntimeBlockInfoPtr> bm_Map;
 
-static bm_Set all_temp_blocks;
+// Blocks sorted by host code address.
+// Code is allocated linearly in the code buffer so new blocks are normally appended at the end.
+// Code buffer space can be reused once blocks are discarded, so their entries must be removed.
+class BlockIndex
+{
+public:
+	void add(const RuntimeBlockInfoPtr& block)
+	{
+		const u8 *code = (const u8 *)block->code;
+		auto it = entries.end();
+		if (!entries.empty() && entries.back().code >= code)
+			it = std::upper_bound(entries.begin(), entries.end(), code,
+					[](const u8 *code, const Entry& entry) { return code < entry.code; });
+		if (it != entries.begin() && (it - 1)->code == code)
+		{
+			const RuntimeBlockInfoPtr& dup = (it - 1)->block;
+			ERROR_LOG(DYNAREC, "DUP: %08X %p %08X %p", dup->addr, dup->code, block->addr, block->code);
+			die("Duplicated block");
+		}
+		entries.insert(it, { code, block });
+	}
+
+	void remove(const RuntimeBlockInfo *block)
+	{
+		auto range = std::equal_range(entries.begin(), entries.end(), Entry{ (const u8 *)block->code },
+				[](const Entry& a, const Entry& b) { return a.code < b.code; });
+		auto it = std::find_if(range.first, range.second, [block](const Entry& entry) {
+			return entry.block.get() == block;
+		});
+		verify(it != range.second);
+		entries.erase(it);
+	}
+
+	// Returns the block containing the given host code address, or null
+	RuntimeBlockInfoPtr find(const void *code) const
+	{
+		auto it = std::upper_bound(entries.begin(), entries.end(), (const u8 *)code,
+				[](const u8 *code, const Entry& entry) { return code < entry.code; });
+		if (it == entries.begin())
+			return nullptr;
+		--it;
+		if (!it->block->containsCode(code))
+			return nullptr;
+		return it->block;
+	}
+
+	template<typename F>
+	void forEach(F f) const
+	{
+		for (const Entry& entry : entries)
+			f(entry.block);
+	}
+
+	void clear()
+	{
+		entries.clear();
+	}
+
+	bool empty() const {
+		return entries.empty();
+	}
+
+private:
+	struct Entry
+	{
+		const u8 *code;
+		RuntimeBlockInfoPtr block;
+	};
+	std::vector<Entry> entries;
+};
+
+static bm_List all_temp_blocks;
 static bm_List del_blocks;
 
 bool unprotected_pages[RAM_SIZE_MAX/PAGE_SIZE];
-static std::set<RuntimeBlockInfo*> blocks_per_page[RAM_SIZE_MAX/PAGE_SIZE];
+// Head of the intrusive list of protected blocks in each page
+static RuntimeBlockInfo *blocks_per_page[RAM_SIZE_MAX/PAGE_SIZE];
 
-static bm_Map blkmap;
+static BlockIndex blkmap;
 // Stats
 u32 protected_blocks;
 u32 unprotected_blocks;
@@ -123,21 +191,7 @@ RuntimeBlockInfoPtr DYNACALL bm_GetBlock(u32 addr)
 // This takes a RX address and returns the info block ptr (RW space)
 RuntimeBlockInfoPtr bm_GetBlock(void* dynarec_code)
 {
-	if (blkmap.empty())
-		return NULL;
-
-	void *dynarecrw = CC_RX2RW(dynarec_code);
-	// Returns a block who's code addr is bigger than dynarec_code (or end)
-	auto iter = blkmap.upper_bound(dynarecrw);
-	if (iter == blkmap.begin())
-		return NULL;
-	iter--;  // Need to go back to find the potential candidate
-
-	// However it might be out of bounds, check for that
-	if (!iter->second->containsCode(dynarecrw))
-		return NULL;
-
-	return iter->second;
+	return blkmap.find(CC_RX2RW(dynarec_code));
 }
 
 static void bm_CleanupDeletedBlocks()
@@ -167,13 +221,8 @@ void bm_AddBlock(RuntimeBlockInfo* blk)
 {
 	RuntimeBlockInfoPtr block(blk);
 	if (block->temp_block)
-		all_temp_blocks.insert(block);
-	auto iter = blkmap.find((void*)blk->code);
-	if (iter != blkmap.end()) {
-		ERROR_LOG(DYNAREC, "DUP: %08X %p %08X %p", iter->second->addr, iter->second->code, block->addr, block->code);
-		die("Duplicated block");
-	}
-	blkmap[(void*)block->code] = block;
+		all_temp_blocks.push_back(block);
+	blkmap.add(block);
 
 	verify((void*)bm_GetCode(block->addr) == (void*)ngen_FailedToFindBlock);
 	FPCA(block->addr) = (DynarecCodeEntryPtr)CC_RW2RX(block->code);
@@ -197,11 +246,10 @@ void bm_AddBlock(RuntimeBlockInfo* blk)
 void bm_DiscardBlock(RuntimeBlockInfo* block)
 {
 	// Remove from block map
-	auto it = blkmap.find((void*)block->code);
-	verify(it != blkmap.end());
-	RuntimeBlockInfoPtr block_ptr = it->second;
+	RuntimeBlockInfoPtr block_ptr = blkmap.find((const void *)block->code);
+	verify(block_ptr.get() == block);
 
-	blkmap.erase(it);
+	blkmap.remove(block);
 
 	block_ptr->pNextBlock = NULL;
 	block_ptr->pBranchBlock = NULL;
@@ -212,7 +260,14 @@ void bm_DiscardBlock(RuntimeBlockInfo* block)
 	FPCA(block_ptr->addr) = ngen_FailedToFindBlock;
 
 	if (block_ptr->temp_block)
-		all_temp_blocks.erase(block_ptr);
+	{
+		auto it = std::find(all_temp_blocks.begin(), all_temp_blocks.end(), block_ptr);
+		if (it != all_temp_blocks.end())
+		{
+			*it = std::move(all_temp_blocks.back());
+			all_temp_blocks.pop_back();
+		}
+	}
 
 	del_blocks.push_back(block_ptr);
 	block_ptr->Discard();
@@ -285,9 +340,7 @@ void bm_ResetCache()
 	sh4Dynarec->reset();
 	addrspace::bm_reset();
 
-	for (const auto& it : blkmap)
-	{
-		RuntimeBlockInfoPtr block = it.second;
+	blkmap.forEach([](const RuntimeBlockInfoPtr& block) {
 		block->relink_data = 0;
 		block->pNextBlock = NULL;
 		block->pBranchBlock = NULL;
@@ -296,14 +349,13 @@ void bm_ResetCache()
 		// Avoid circular references
 		block->Discard();
 		del_blocks.push_back(block);
-	}
+	});
 
 	blkmap.clear();
 	// blkmap includes temp blocks as well
 	all_temp_blocks.clear();
 
-	for (auto& block_list : blocks_per_page)
-		block_list.clear();
+	memset(blocks_per_page, 0, sizeof(blocks_per_page));
 
 	memset(unprotected_pages, 0, sizeof(unprotected_pages));
 
@@ -328,7 +380,7 @@ void bm_ResetTempCache(bool full)
 		for (const auto& block : all_temp_blocks)
 		{
 			FPCA(block->addr) = ngen_FailedToFindBlock;
-			blkmap.erase((void*)block->code);
+			blkmap.remove(block.get());
 		}
 	}
 	del_blocks.insert(del_blocks.begin(),all_temp_blocks.begin(),all_temp_blocks.end());
@@ -362,12 +414,11 @@ void bm_WriteBlockMap(const std::string& file)
 	if (f)
 	{
 		INFO_LOG(DYNAREC, "Writing block map !");
-		for (const auto& [_, block] : blkmap)
-		{
+		blkmap.forEach([f](const RuntimeBlockInfoPtr& block) {
 			fprintf(f, "block: %d:%08X:%p:%d:%d:%d\n", block->BlockType, block->addr, block->code, block->host_code_size, block->guest_cycles, block->guest_opcodes);
 			for(size_t j = 0; j < block->oplist.size(); j++)
 				fprintf(f,"\top: %zd:%d:%s\n", j, block->oplist[j].guest_offs, block->oplist[j].dissasm().c_str());
-		}
+		});
 		fclose(f);
 		INFO_LOG(DYNAREC, "Finished writing block map");
 	}
@@ -375,10 +426,9 @@ void bm_WriteBlockMap(const std::string& file)
 
 void sh4_jitsym(FILE* out)
 {
-	for (const auto& [_, block] : blkmap)
-	{
+	blkmap.forEach([out](const RuntimeBlockInfoPtr& block) {
 		fprintf(out, "%p %d %08X\n", block->code, block->host_code_size, block->addr);
-	}
+	});
 }
 
 RuntimeBlockInfo::~RuntimeBlockInfo()
@@ -421,44 +471,65 @@ void RuntimeBlockInfo::Discard()
 	if (read_only)
 	{
 		// Remove this block from the per-page block lists
-		for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + this->sh4_code_size; addr += PAGE_SIZE)
+		int i = 0;
+		for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + this->sh4_code_size; addr += PAGE_SIZE, i++)
 		{
-			auto& block_list = blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE];
-			block_list.erase(this);
+			PageLink& link = pageLinks[i];
+			if (link.prev != nullptr)
+				link.prev->pageLinks[link.prev->getPageLinkIndex(addr)].next = link.next;
+			else if (blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE] == this)
+				blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE] = link.next;
+			else
+				// not linked
+				continue;
+			if (link.next != nullptr)
+				link.next->pageLinks[link.next->getPageLinkIndex(addr)].prev = link.prev;
+			link.prev = link.next = nullptr;
 		}
 	}
 }
 
-void RuntimeBlockInfo::SetProtectedFlags()
+int RuntimeBlockInfo::getPageLinkIndex(u32 pageAddr) const
+{
+	return ((pageAddr & RAM_MASK) / PAGE_SIZE) == ((addr & RAM_MASK) / PAGE_SIZE) ? 0 : 1;
+}
+
+bool bm_IsCodeProtectable(u32 addr, u32 size)
 {
 #ifdef TARGET_NO_EXCEPTIONS
-	this->read_only = false;
-	return;
+	return false;
 #endif
 	// Don't write protect rom and BIOS/IP.BIN (Grandia II)
 	if (!IsOnRam(addr) || (addr & 0x1FFF0000) == 0x0c000000)
+		return false;
+	for (u32 page = addr & ~PAGE_MASK; page < addr + size; page += PAGE_SIZE)
+		if (unprotected_pages[(page & RAM_MASK) / PAGE_SIZE])
+			return false;
+	return true;
+}
+
+void RuntimeBlockInfo::SetProtectedFlags()
+{
+	if (!bm_IsCodeProtectable(addr, sh4_code_size))
 	{
 		this->read_only = false;
 		unprotected_blocks++;
 		return;
 	}
-	for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + sh4_code_size; addr += PAGE_SIZE)
-	{
-		if (unprotected_pages[(addr & RAM_MASK) / PAGE_SIZE])
-		{
-			this->read_only = false;
-			unprotected_blocks++;
-			return;
-		}
-	}
 	this->read_only = true;
 	protected_blocks++;
-	for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + sh4_code_size; addr += PAGE_SIZE)
+	int i = 0;
+	for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + sh4_code_size; addr += PAGE_SIZE, i++)
 	{
-		auto& block_list = blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE];
-		if (block_list.empty())
+		verify(i < (int)std::size(pageLinks));
+		RuntimeBlockInfo *&head = blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE];
+		if (head == nullptr)
 			bm_LockPage(addr);
-		block_list.insert(this);
+		else
+			head->pageLinks[head->getPageLinkIndex(addr)].prev = this;
+		pageLinks[i].prev = nullptr;
+		pageLinks[i].next = head;
+		head = this;
 	}
 }
 
@@ -470,16 +541,13 @@ void bm_RamWriteAccess(u32 addr)
 
 	unprotected_pages[addr / PAGE_SIZE] = true;
 	bm_UnlockPage(addr);
-	std::set<RuntimeBlockInfo*>& block_list = blocks_per_page[addr / PAGE_SIZE];
-	if (!block_list.empty())
+	RuntimeBlockInfo *&head = blocks_per_page[addr / PAGE_SIZE];
+	if (head != nullptr)
 	{
-		std::vector<RuntimeBlockInfo*> list_copy;
-		list_copy.insert(list_copy.begin(), block_list.begin(), block_list.end());
-		if (!list_copy.empty())
-			DEBUG_LOG(DYNAREC, "bm_RamWriteAccess write access to %08x pc %08x", addr, next_pc);
-		for (auto& block : list_copy)
-			bm_DiscardBlock(block);
-		verify(block_list.empty());
+		DEBUG_LOG(DYNAREC, "bm_RamWriteAccess write access to %08x pc %08x", addr, next_pc);
+		// Discarding a block removes it from the list
+		while (head != nullptr)
+			bm_DiscardBlock(head);
 	}
 }
 
@@ -550,8 +618,7 @@ void print_blocks()
 		INFO_LOG(DYNAREC, "Writing blocks to %p", f);
 	}
 
-	for (const auto& [_, blk] : blkmap)
-	{
+	blkmap.forEach([f](const RuntimeBlockInfoPtr& blk) {
 		if (f)
 		{
 			fprintf(f,"block: %p\n",blk.get());
@@ -602,7 +669,7 @@ void print_blocks()
 
 			fprintf(f,"}\n");
 		}
-	}
+	});
 
 	if (f) fclose(f);
 }
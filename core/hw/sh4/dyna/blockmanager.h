@@ -13,7 +13,9 @@ typedef std::shared_ptr<RuntimeBlockInfo> RuntimeBlockInfoPtr;
 
 struct RuntimeBlockInfo
 {
-	bool Setup(u32 pc,fpscr_t fpu_cfg);
+	// If protect is false, the block isn't write-protected nor optimized.
+	// AnalyseBlock() must then be called before compiling it and SetProtectedFlags() before adding it.
+	bool Setup(u32 pc, fpscr_t fpu_cfg, bool protect = true);
 
 	u32 addr;
 	DynarecCodeEntryPtr code;
@@ -66,6 +68,17 @@ struct RuntimeBlockInfo
 	void SetProtectedFlags();
 
 	bool read_only;
+
+	// Intrusive links in the lists of protected blocks of each RAM page.
+	// A block spans at most 2 pages.
+	struct PageLink
+	{
+		RuntimeBlockInfo *prev = nullptr;
+		RuntimeBlockInfo *next = nullptr;
+	};
+	PageLink pageLinks[2];
+	// Index of the link used for the given page
+	int getPageLinkIndex(u32 pageAddr) const;
 };
 
 void bm_WriteBlockMap(const std::string& file);
@@ -94,6 +107,8 @@ static inline bool bm_IsRamPageProtected(u32 addr)
 	addr &= RAM_MASK;
 	return !unprotected_pages[addr / PAGE_SIZE];
 }
+// Returns true if the code in the given address range can be write-protected
+bool bm_IsCodeProtectable(u32 addr, u32 size);
 void bm_LockPage(u32 addr, u32 size = PAGE_SIZE);
 void bm_UnlockPage(u32 addr, u32 size = PAGE_SIZE);
 u32 bm_getRamOffset(void *p);
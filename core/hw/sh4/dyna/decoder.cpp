@@ -117,10 +117,22 @@ static void dec_write_sr(shil_param src)
 	Emit(shop_and,mk_reg(reg_sr_status),src,mk_imm(SR_STATUS_MASK));
 	Emit(shop_and,mk_reg(reg_sr_T),src,mk_imm(SR_T_MASK));
 }
+// Extend the block across a conditional branch if it's probably not taken.
+// Forward branches are assumed to be rarely taken, and backward branches (loops) to be usually taken.
+static bool dec_SideExit(u32 target, u32 condition)
+{
+	if (!state.traces || target <= state.cpu.rpc)
+		return false;
+	// rs3 holds the number of cycles elapsed so far until the end of the decoding
+	Emit(shop_cond_exit, shil_param(), mk_reg(reg_sr_T), mk_imm(target), condition, mk_imm(blk->guest_cycles));
+	return true;
+}
+
 //bf <bdisp8>
 sh4dec(i1000_1011_iiii_iiii)
 {
-	dec_End(dec_jump_simm8(op),BET_Cond_0,false);
+	if (!dec_SideExit(dec_jump_simm8(op), 0))
+		dec_End(dec_jump_simm8(op),BET_Cond_0,false);
 }
 //bf.s <bdisp8>
 sh4dec(i1000_1111_iiii_iiii)
@@ -132,7 +144,8 @@ sh4dec(i1000_1111_iiii_iiii)
 //bt <bdisp8>
 sh4dec(i1000_1001_iiii_iiii)
 {
-	dec_End(dec_jump_simm8(op),BET_Cond_1,false);
+	if (!dec_SideExit(dec_jump_simm8(op), 1))
+		dec_End(dec_jump_simm8(op),BET_Cond_1,false);
 }
 //bt.s <bdisp8>
 sh4dec(i1000_1101_iiii_iiii)
@@ -946,6 +959,8 @@ static void state_Setup(u32 rpc,fpscr_t fpu_cfg)
 	state.info.has_readm=false;
 	state.info.has_writem=false;
 	state.info.has_fpu=false;
+
+	state.traces = config::DynarecTraces && !mmu_enabled() && sh4Dynarec->supportsSideExits();
 }
 
 void dec_updateBlockCycles(RuntimeBlockInfo *block, u16 op)
@@ -1067,6 +1082,14 @@ _end:
 
 	//make sure we don't use wayy-too-few cycles
 	blk->guest_cycles = std::max(1U, blk->guest_cycles);
+
+	// Side exits give back the cycles of the rest of the block
+	for (shil_opcode& op : blk->oplist)
+		if (op.op == shop_cond_exit)
+		{
+			u32 cycles = std::round(op.rs3._imm * 200.f / std::max(1.f, (float)config::Sh4Clock));
+			op.rs3._imm = blk->guest_cycles > cycles ? blk->guest_cycles - cycles : 0;
+		}
 	blk = nullptr;
 
 	return true;
@@ -63,6 +63,8 @@ struct state_t
 		bool has_writem;
 		bool has_fpu;
 	} info;
+
+	bool traces;	// extend blocks across conditional branches
 };
 
 const u32 NullAddress = 0xFFFFFFFF;
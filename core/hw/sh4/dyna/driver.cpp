@@ -1,17 +1,27 @@
 #include "types.h"
 #include <unordered_set>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include "hw/sh4/sh4_interpreter.h"
 #include "hw/sh4/sh4_core.h"
 #include "hw/sh4/sh4_interrupts.h"
 
 #include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_opcode_list.h"
+#include "hw/sh4/sh4_cycles.h"
 #include "hw/sh4/modules/mmu.h"
 
 #include "blockmanager.h"
 #include "ngen.h"
 #include "decoder.h"
+#include "blockcache.h"
 #include "oslib/virtmem.h"
+#include "oslib/oslib.h"
+#include "cfg/option.h"
+#include "stdclass.h"
 
 #if FEAT_SHREC != DYNAREC_NONE
 
@@ -43,6 +53,42 @@ static std::unordered_set<u32> smc_hotspots;
 static sh4_if sh4Interp;
 static Sh4CodeBuffer codeBuffer;
 Sh4Dynarec *sh4Dynarec;
+// Protects the code buffer and the dynarec compiler
+static std::recursive_mutex compileMutex;
+
+// Background compilation.
+// Blocks that aren't found are decoded on the emulation thread and queued to be compiled
+// by a worker thread. They are run by the interpreter until their code is ready.
+// Only supported by backends that use the default ngen_FailedToFindBlock handler.
+struct CompileRequest
+{
+	RuntimeBlockInfo *block = nullptr;
+	bool smcChecks = false;
+	bool compiled = false;
+	bool relocatable = false;
+	u32 generation = 0;
+	std::vector<u8> guestCode;
+	std::vector<CodeRelocation> relocations;
+};
+
+struct PendingBlock
+{
+	u32 sh4_code_size;
+};
+
+static bool asyncCompile;
+static std::thread compileThread;
+static bool compileThreadRunning;
+static cResetEvent compileEvent;
+// Protects the following variables
+static std::mutex queueMutex;
+static std::deque<CompileRequest> compileQueue;
+static std::vector<CompileRequest> compiledBlocks;
+static u32 compileGeneration;
+// Blocks being compiled, indexed by address. Only used by the emulation thread.
+static std::unordered_map<u32, PendingBlock> pendingBlocks;
+
+static void cancelAsyncCompile();
 
 void *Sh4CodeBuffer::get()
 {
@@ -92,11 +138,14 @@ static void clear_temp_cache(bool full)
 
 static void recSh4_ClearCache()
 {
+	std::lock_guard<std::recursive_mutex> _(compileMutex);
+	cancelAsyncCompile();
 	INFO_LOG(DYNAREC, "recSh4:Dynarec Cache clear at %08X free space %d", next_pc, codeBuffer.getFreeSpace());
 	codeBuffer.reset(false);
 	bm_ResetCache();
 	smc_hotspots.clear();
 	clear_temp_cache(true);
+	blockcache::restore();
 }
 
 static void recSh4_Run()
@@ -113,7 +162,7 @@ static void recSh4_Run()
 
 void AnalyseBlock(RuntimeBlockInfo* blk);
 
-bool RuntimeBlockInfo::Setup(u32 rpc,fpscr_t rfpu_cfg)
+bool RuntimeBlockInfo::Setup(u32 rpc, fpscr_t rfpu_cfg, bool protect)
 {
 	addr = host_code_size = 0;
 	guest_cycles = guest_opcodes = host_opcodes = 0;
@@ -159,9 +208,15 @@ bool RuntimeBlockInfo::Setup(u32 rpc,fpscr_t rfpu_cfg)
 		Do_Exception(rpc, ex.expEvn);
 		return false;
 	}
-	SetProtectedFlags();
-
-	AnalyseBlock(this);
+	if (protect)
+	{
+		SetProtectedFlags();
+		AnalyseBlock(this);
+	}
+	else
+	{
+		read_only = false;
+	}
 
 	return true;
 }
@@ -169,12 +224,19 @@ bool RuntimeBlockInfo::Setup(u32 rpc,fpscr_t rfpu_cfg)
 DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 {
 	const u32 pc = next_pc;
+	std::lock_guard<std::recursive_mutex> _(compileMutex);
 
-	if (codeBuffer.getFreeSpace() < 32_KB || pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300)
+	if (codeBuffer.getFreeSpace() < 32_KB || pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300
+			|| blockcache::restorePending())
 		recSh4_ClearCache();
 
 	RuntimeBlockInfo* rbi = sh4Dynarec->allocateBlock();
 
+	if (smc_hotspots.find(pc) == smc_hotspots.end() && blockcache::lookup(rbi, pc, fpscr))
+	{
+		bm_AddBlock(rbi);
+		return rbi->code;
+	}
 	if (!rbi->Setup(pc, fpscr))
 	{
 		delete rbi;
@@ -194,6 +256,7 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 	bool block_check = !rbi->read_only;
 	sh4Dynarec->compile(rbi, block_check, do_opts);
 	verify(rbi->code != nullptr);
+	blockcache::add(rbi, block_check);
 
 	bm_AddBlock(rbi);
 
@@ -202,6 +265,216 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 	return rbi->code;
 }
 
+u32 rdv_blockDispatches;
+
+std::recursive_mutex& rdv_CompileMutex()
+{
+	return compileMutex;
+}
+
+// Pending blocks haven't been accounted for in the block statistics yet
+static void deletePendingBlock(RuntimeBlockInfo *block)
+{
+	block->sh4_code_size = 0;
+	delete block;
+}
+
+static void compileThreadLoop()
+{
+	ThreadName _("SH4-compiler");
+	while (true)
+	{
+		CompileRequest request;
+		{
+			std::lock_guard<std::mutex> _(queueMutex);
+			if (!compileThreadRunning)
+				break;
+			if (!compileQueue.empty())
+			{
+				request = std::move(compileQueue.front());
+				compileQueue.pop_front();
+			}
+		}
+		if (request.block == nullptr)
+		{
+			compileEvent.Wait();
+			continue;
+		}
+		std::lock_guard<std::recursive_mutex> _(compileMutex);
+		bool cancelled;
+		{
+			std::lock_guard<std::mutex> _(queueMutex);
+			cancelled = request.generation != compileGeneration;
+		}
+		// The code buffer can only be reset by the emulation thread
+		if (!cancelled && codeBuffer.getFreeSpace() >= 32_KB)
+		{
+			AnalyseBlock(request.block);
+			sh4Dynarec->compile(request.block, request.smcChecks, true);
+			request.compiled = request.block->code != nullptr;
+			if (request.compiled)
+				request.relocatable = sh4Dynarec->getRelocations(request.block, request.relocations);
+		}
+		std::lock_guard<std::mutex> lock(queueMutex);
+		compiledBlocks.push_back(std::move(request));
+	}
+}
+
+static void startCompileThread()
+{
+	if (compileThread.joinable())
+		return;
+	compileThreadRunning = true;
+	compileThread = std::thread(compileThreadLoop);
+}
+
+static void stopCompileThread()
+{
+	if (!compileThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> _(queueMutex);
+		compileThreadRunning = false;
+	}
+	compileEvent.Set();
+	compileThread.join();
+	cancelAsyncCompile();
+}
+
+// Drop all queued and compiled blocks. Blocks being compiled will be ignored once done.
+static void cancelAsyncCompile()
+{
+	std::lock_guard<std::mutex> _(queueMutex);
+	compileGeneration++;
+	for (CompileRequest& request : compileQueue)
+		deletePendingBlock(request.block);
+	compileQueue.clear();
+	for (CompileRequest& request : compiledBlocks)
+		deletePendingBlock(request.block);
+	compiledBlocks.clear();
+	pendingBlocks.clear();
+}
+
+// Returns false if some blocks couldn't be compiled, usually because the code buffer is full
+static bool publishCompiledBlocks()
+{
+	std::vector<CompileRequest> requests;
+	u32 generation;
+	{
+		std::lock_guard<std::mutex> _(queueMutex);
+		if (compiledBlocks.empty())
+			return true;
+		requests.swap(compiledBlocks);
+		generation = compileGeneration;
+	}
+	bool success = true;
+	for (CompileRequest& request : requests)
+	{
+		RuntimeBlockInfo *block = request.block;
+		if (request.generation != generation)
+		{
+			deletePendingBlock(block);
+			continue;
+		}
+		pendingBlocks.erase(block->addr);
+		if (!request.compiled)
+		{
+			deletePendingBlock(block);
+			success = false;
+			continue;
+		}
+		// The guest code may have been modified while compiling,
+		// or the block compiled synchronously in the meantime
+		if (memcmp(GetMemPtr(block->addr, block->sh4_code_size), request.guestCode.data(), request.guestCode.size()) != 0
+				|| bm_GetBlock(block->addr) != nullptr)
+		{
+			deletePendingBlock(block);
+			continue;
+		}
+		block->SetProtectedFlags();
+		if (!request.smcChecks && !block->read_only)
+		{
+			// compiled without smc checks but its pages can't be protected anymore
+			delete block;
+			continue;
+		}
+		if (request.relocatable)
+			blockcache::add(block, request.smcChecks, std::move(request.relocations));
+		bm_AddBlock(block);
+	}
+	return success;
+}
+
+// Run a block with the interpreter.
+// Only the cycles of the instructions actually executed are charged.
+static void interpretBlock(u32 pc, const PendingBlock& block)
+{
+	Sh4Cycles cycles;
+	const u32 end = pc + block.sh4_code_size;
+	next_pc = pc;
+	try {
+		while (next_pc < end)
+		{
+			const u32 addr = next_pc;
+			next_pc += 2;
+			u16 op = IReadMem16(addr);
+			cycles.executeCycles(op);
+			if (sr.FD == 1 && OpDesc[op]->IsFloatingPoint())
+				RaiseFPUDisableException();
+			OpPtr[op](op);
+			if (next_pc != addr + 2)
+				// branch
+				break;
+		}
+	} catch (const SH4ThrownException& ex) {
+		Do_Exception(ex.epc, ex.expEvn);
+	}
+}
+
+// Returns false if the block must be compiled synchronously
+static bool compileAsync(u32 pc)
+{
+	if (mmu_enabled() || !publishCompiledBlocks())
+		return false;
+	if (bm_GetBlock(pc) != nullptr)
+		return true;
+	auto it = pendingBlocks.find(pc);
+	if (it == pendingBlocks.end())
+	{
+		if (!IsOnRam(pc) || (pc & 1) || smc_hotspots.count(pc) != 0 || blockcache::restorePending())
+			return false;
+		RuntimeBlockInfo *block = sh4Dynarec->allocateBlock();
+		if (blockcache::lookup(block, pc, fpscr))
+		{
+			bm_AddBlock(block);
+			return true;
+		}
+		if (!block->Setup(pc, fpscr, false))
+		{
+			// an exception has been raised
+			delete block;
+			return true;
+		}
+		block->blockcheck_failures = 0;
+		it = pendingBlocks.emplace(pc, PendingBlock{ block->sh4_code_size }).first;
+
+		CompileRequest request;
+		request.block = block;
+		request.smcChecks = !bm_IsCodeProtectable(block->addr, block->sh4_code_size);
+		const u8 *code = GetMemPtr(block->addr, block->sh4_code_size);
+		request.guestCode.assign(code, code + block->sh4_code_size);
+		{
+			std::lock_guard<std::mutex> _(queueMutex);
+			request.generation = compileGeneration;
+			compileQueue.push_back(std::move(request));
+		}
+		compileEvent.Set();
+	}
+	interpretBlock(pc, it->second);
+
+	return true;
+}
+
 DynarecCodeEntryPtr DYNACALL rdv_FailedToFindBlock_pc()
 {
 	return rdv_FailedToFindBlock(next_pc);
@@ -219,7 +492,10 @@ DynarecCodeEntryPtr DYNACALL rdv_FailedToFindBlock(u32 pc)
 	return code;
 }
 
-static void ngen_FailedToFindBlock_internal() {
+static void ngen_FailedToFindBlock_internal()
+{
+	if (asyncCompile && compileAsync(Sh4cntx.pc))
+		return;
 	rdv_FailedToFindBlock(Sh4cntx.pc);
 }
 
@@ -342,6 +618,22 @@ void* DYNACALL rdv_LinkBlock(u8* code,u32 dpc)
 
 static void recSh4_Start()
 {
+	// Compiling in the background isn't deterministic
+	bool async = config::DynarecAsyncCompile && !config::GGPOEnable
+			&& ngen_FailedToFindBlock == &ngen_FailedToFindBlock_internal;
+	if (async != asyncCompile)
+	{
+		if (async)
+		{
+			INFO_LOG(DYNAREC, "Background compilation enabled");
+			startCompileThread();
+		}
+		else
+		{
+			stopCompileThread();
+		}
+		asyncCompile = async;
+	}
 	sh4Interp.Start();
 }
 
@@ -385,6 +677,7 @@ static void recSh4_Init()
 	verify(CodeCache != nullptr);
 
 	TempCodeCache = CodeCache + CODE_SIZE;
+	blockcache::init(codeBuffer);
 	sh4Dynarec->init(codeBuffer);
 	bm_ResetCache();
 }
@@ -392,6 +685,9 @@ static void recSh4_Init()
 static void recSh4_Term()
 {
 	INFO_LOG(DYNAREC, "recSh4 Term");
+	stopCompileThread();
+	asyncCompile = false;
+	blockcache::term();
 #ifdef FEAT_NO_RWX_PAGES
 	if (CodeCache != nullptr)
 		virtmem::release_jit_block(CodeCache, (u8 *)CodeCache + cc_rx_offset, FULL_SIZE);
@@ -3,6 +3,7 @@
 #pragma once
 #include "blockmanager.h"
 #include "oslib/host_context.h"
+#include <mutex>
 
 // When NO_RWX is enabled there's two address-spaces, one executable and
 // one writtable. The emitter and most of the code in rec-* will work with
@@ -25,6 +26,10 @@ DynarecCodeEntryPtr DYNACALL rdv_FailedToFindBlock_pc();
 DynarecCodeEntryPtr DYNACALL rdv_BlockCheckFail(u32 addr);
 //Called to compile code @pc
 DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures);
+// Number of blocks entered from the main loop. Only updated in debug builds.
+extern u32 rdv_blockDispatches;
+// Protects the code buffer and the compiler. Must be held when patching generated code.
+std::recursive_mutex& rdv_CompileMutex();
 //Finds or compiles code @pc
 DynarecCodeEntryPtr rdv_FindOrCompile();
 // Registers a custom FailedToFindBlock handler function
@@ -50,6 +55,39 @@ enum CanonicalParamType
 	CPT_ptr,
 };
 
+// Host address embedded in the generated code that must be adjusted when a block is restored
+// from the persistent block cache in another session.
+struct CodeRelocation
+{
+	enum Type : u8 {
+		Image,		// host executable code or data, including the code buffer
+		Context,	// Sh4RCB
+		Ram,		// SH4 main RAM or virtual address space
+	};
+	u32 offset;		// offset of the address in the block code
+	Type type;
+};
+
+// Displacement of each relocation base between the session that compiled a block and the current one.
+struct RelocationDeltas
+{
+	ptrdiff_t image;
+	ptrdiff_t context;
+	ptrdiff_t ram;
+
+	ptrdiff_t get(CodeRelocation::Type type) const {
+		switch (type)
+		{
+		case CodeRelocation::Image:
+			return image;
+		case CodeRelocation::Context:
+			return context;
+		default:
+			return ram;
+		}
+	}
+};
+
 bool rdv_readMemImmediate(u32 addr, int size, void*& ptr, bool& isRam, u32& physAddr, RuntimeBlockInfo* block = nullptr);
 bool rdv_writeMemImmediate(u32 addr, int size, void*& ptr, bool& isRam, u32& physAddr, RuntimeBlockInfo* block = nullptr);
 
@@ -105,6 +143,21 @@ public:
 	virtual RuntimeBlockInfo *allocateBlock() {
 		return new RuntimeBlockInfo();
 	}
+	// Return true if the dynarec implements shop_cond_exit, so that blocks can extend across conditional branches.
+	virtual bool supportsSideExits() {
+		return false;
+	}
+
+	// Persistent block cache support (optional).
+	// Return the host address relocations of the block that has just been compiled.
+	// Return false if the block code cannot be relocated.
+	virtual bool getRelocations(const RuntimeBlockInfo *block, std::vector<CodeRelocation>& relocations) {
+		return false;
+	}
+	// Apply the relocations of a block's code restored at its original offset in the code buffer.
+	virtual bool relocate(void *code, u32 size, const std::vector<CodeRelocation>& relocations, const RelocationDeltas& deltas) {
+		return false;
+	}
 
 	// Dynarec canonical implementation callback methods.
 	// Used to call default implementation of shil ops that the dynarec doesn't implement.
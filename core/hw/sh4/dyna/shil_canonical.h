@@ -197,6 +197,11 @@ shil_opc(jcond)
 shil_recimp()
 shil_opc_end()
 
+//shop_cond_exit: side exit of a trace. Exit the block to rs2 if rs1 (sr.T) == size, giving back rs3 cycles.
+shil_opc(cond_exit)
+shil_recimp()
+shil_opc_end()
+
 //shop_ifb
 shil_opc(ifb)
 shil_recimp()
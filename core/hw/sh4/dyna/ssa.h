@@ -331,8 +331,9 @@ private:
 			shil_opcode& op = block->oplist[opnum];
 			bool dead_code = false;
 
-			if (op.op == shop_ifb || (mmu_enabled() && (op.op == shop_readm || op.op == shop_writem)))
+			if (op.op == shop_ifb || op.op == shop_cond_exit || (mmu_enabled() && (op.op == shop_readm || op.op == shop_writem)))
 			{
+				// side exits need all regs to be saved beforehand
 				// if mmu enabled, mem accesses can throw an exception
 				// so last_versions must be reset so the regs are correctly saved beforehand
 				memset(last_versions, -1, sizeof(last_versions));
@@ -602,7 +603,7 @@ private:
 						aliasdef = opnum;
 					else if (DefinesHigherVersion(op->rd2, alias.second))
 						aliasdef = opnum;
-					else if (op->op == shop_ifb)
+					else if (op->op == shop_ifb || op->op == shop_cond_exit)
 						aliasdef = opnum;
 				}
 
@@ -55,7 +55,7 @@ public:
 	void OpBegin(shil_opcode* op, int opid)
 	{
 		opnum = opid;
-		if (op->op == shop_ifb)
+		if (op->op == shop_ifb || op->op == shop_cond_exit)
 		{
 			FlushAllRegs(true);
 		}
@@ -95,7 +95,7 @@ public:
 			for (u32 i = 0; i < op->rs3.count(); i++)
 				FlushReg((Sh4RegType)(op->rs3._reg + i), false);
 		}
-		if (op->op != shop_ifb)
+		if (op->op != shop_ifb && op->op != shop_cond_exit)
 		{
 			AllocSourceReg(op->rs1);
 			AllocSourceReg(op->rs2);
@@ -416,7 +416,7 @@ private:
 			shil_opcode* op = &block->oplist[i];
 			// if a subsequent op needs all or some regs flushed to mem
 			// TODO we could look at the ifb op to optimize what to flush
-			if (op->op == shop_ifb || (mmu_enabled() && (op->op == shop_readm || op->op == shop_writem || op->op == shop_pref)))
+			if (op->op == shop_ifb || op->op == shop_cond_exit || (mmu_enabled() && (op->op == shop_readm || op->op == shop_writem || op->op == shop_pref)))
 				return true;
 			if (op->op == shop_sync_sr && (/*reg == reg_sr_T ||*/ reg == reg_sr_status || (reg >= reg_r0 && reg <= reg_r7)
 					|| (reg >= reg_r0_Bank && reg <= reg_r7_Bank)))
@@ -620,7 +620,7 @@ private:
 	{
 		shil_opcode* op = &block->oplist[cur_op];
 		shil_opcode* next_op = &block->oplist[early_op];
-		if (next_op->op == shop_ifb || next_op->op == shop_sync_sr || next_op->op == shop_sync_fpscr)
+		if (next_op->op == shop_ifb || next_op->op == shop_cond_exit || next_op->op == shop_sync_sr || next_op->op == shop_sync_fpscr)
 			return false;
 		if (next_op->rs1.is_r32() && !DefsReg(cur_op, early_op - 1, next_op->rs1._reg))
 		{
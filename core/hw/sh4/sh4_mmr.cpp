@@ -696,7 +696,8 @@ void deserialize(Deserializer& deser)
 {
 	deser >> OnChipRAM;
 
-	deser >> CCN;
+	// The store queue handler only depends on CCN registers
+	const bool ccnChanged = deser.deserializeChanged(CCN);
 	deser >> UBC;
 	deser >> BSC;
 	deser >> DMAC;
@@ -718,8 +719,11 @@ void deserialize(Deserializer& deser)
 
 	if (deser.version() <= Deserializer::V31)
 		deser.skip<int>();		// do_sqw index
-	CCN_QACR_write<0>(0, CCN_QACR0.reg_data);
-	CCN_QACR_write<1>(0, CCN_QACR1.reg_data);
+	if (ccnChanged)
+	{
+		CCN_QACR_write<0>(0, CCN_QACR0.reg_data);
+		CCN_QACR_write<1>(0, CCN_QACR1.reg_data);
+	}
 
 	deser >> (*p_sh4rcb).sq_buffer;
 
@@ -20,6 +20,8 @@
 
 	sh4_sched_now()
 
+	Scheduled callbacks are kept in a binary min-heap ordered by deadline then id,
+	so that the next callback is found in constant time.
 */
 struct sched_list
 {
@@ -28,11 +30,28 @@ struct sched_list
 	int tag;
 	int start;
 	int end;
+	int heapPos;	// index in sch_heap or -1 if not scheduled. Not serialized
+};
+
+struct sched_heap_node
+{
+	u64 deadline;	// 64-bit end time
+	int id;
+
+	bool operator<(const sched_heap_node& other) const {
+		return deadline < other.deadline || (deadline == other.deadline && id < other.id);
+	}
 };
 
 static u64 sh4_sched_ffb;
 static std::vector<sched_list> sch_list;
 static int sh4_sched_next_id = -1;
+// scheduled callbacks
+static std::vector<sched_heap_node> sch_heap;
+// set when end times have been modified directly (deserialization)
+static bool sch_heap_dirty;
+// set while sh4_sched_tick runs the expired callbacks. sh4_sched_ffts is called once they're done.
+static bool sch_ticking;
 
 static u32 sh4_sched_now();
 
@@ -44,19 +63,128 @@ static u32 sh4_sched_remaining(const sched_list& sched, u32 reference)
 		return -1;
 }
 
+static void heap_set(size_t pos, const sched_heap_node& node)
+{
+	sch_heap[pos] = node;
+	sch_list[node.id].heapPos = (int)pos;
+}
+
+static void heap_sift_up(size_t pos)
+{
+	sched_heap_node node = sch_heap[pos];
+	while (pos > 0)
+	{
+		size_t parent = (pos - 1) / 2;
+		if (!(node < sch_heap[parent]))
+			break;
+		heap_set(pos, sch_heap[parent]);
+		pos = parent;
+	}
+	heap_set(pos, node);
+}
+
+static void heap_sift_down(size_t pos)
+{
+	sched_heap_node node = sch_heap[pos];
+	for (;;)
+	{
+		size_t child = pos * 2 + 1;
+		if (child >= sch_heap.size())
+			break;
+		if (child + 1 < sch_heap.size() && sch_heap[child + 1] < sch_heap[child])
+			child++;
+		if (!(sch_heap[child] < node))
+			break;
+		heap_set(pos, sch_heap[child]);
+		pos = child;
+	}
+	heap_set(pos, node);
+}
+
+static void heap_remove(sched_list& sched)
+{
+	size_t pos = sched.heapPos;
+	sched.heapPos = -1;
+	sched_heap_node last = sch_heap.back();
+	sch_heap.pop_back();
+	if (pos == sch_heap.size())
+		return;
+	heap_set(pos, last);
+	if (pos > 0 && last < sch_heap[(pos - 1) / 2])
+		heap_sift_up(pos);
+	else
+		heap_sift_down(pos);
+}
+
+// Update the heap after the end time of a callback has changed
+static void heap_update(int id)
+{
+	if (sch_heap_dirty)
+		return;
+	sched_list& sched = sch_list[id];
+	if (sched.end == -1)
+	{
+		if (sched.heapPos != -1)
+			heap_remove(sched);
+		return;
+	}
+	// Deadlines are relative to the current time, like sh4_sched_remaining()
+	u64 deadline = sh4_sched_now64() + sh4_sched_remaining(sched, sh4_sched_now());
+	if (sched.heapPos == -1)
+	{
+		sch_heap.push_back({ deadline, id });
+		heap_sift_up(sch_heap.size() - 1);
+	}
+	else
+	{
+		size_t pos = sched.heapPos;
+		u64 oldDeadline = sch_heap[pos].deadline;
+		sch_heap[pos].deadline = deadline;
+		if (deadline < oldDeadline)
+			heap_sift_up(pos);
+		else
+			heap_sift_down(pos);
+	}
+}
+
+static void heap_rebuild()
+{
+	sch_heap.clear();
+	sch_heap_dirty = false;
+	for (sched_list& sched : sch_list)
+		sched.heapPos = -1;
+	for (size_t id = 0; id < sch_list.size(); id++)
+		heap_update(id);
+}
+
 void sh4_sched_ffts()
 {
+	if (sch_ticking)
+		return;
+	if (sch_heap_dirty)
+		heap_rebuild();
 	u32 diff = -1;
 	int slot = -1;
 
 	u32 now = sh4_sched_now();
-	for (const sched_list& sched : sch_list)
+	if (!sch_heap.empty() && sch_heap[0].deadline >= sh4_sched_now64()
+			&& sch_list[sch_heap[0].id].end != -1)
 	{
-		u32 remaining = sh4_sched_remaining(sched, now);
-		if (remaining < diff)
+		diff = sh4_sched_remaining(sch_list[sch_heap[0].id], now);
+		if (diff != (u32)-1)
+			slot = sch_heap[0].id;
+	}
+	else if (!sch_heap.empty())
+	{
+		// Some callbacks are overdue while running sh4_sched_tick. They must come last.
+		for (const sched_list& sched : sch_list)
 		{
-			slot = &sched - &sch_list[0];
-			diff = remaining;
+			u32 remaining = sh4_sched_remaining(sched, now);
+			if (remaining < diff)
+			{
+				slot = &sched - &sch_list[0];
+				diff = remaining;
+			}
 		}
 	}
 
@@ -73,7 +201,7 @@ void sh4_sched_ffts()
 
 int sh4_sched_register(int tag, sh4_sched_callback* ssc, void *arg)
 {
-	sched_list t{ ssc, arg, tag, -1, -1};
+	sched_list t{ ssc, arg, tag, -1, -1, -1 };
 	for (sched_list& sched : sch_list)
 		if (sched.cb == nullptr)
 		{
@@ -91,6 +219,8 @@ void sh4_sched_unregister(int id)
 	if (id == -1)
 		return;
 	verify(id < (int)sch_list.size());
+	sch_list[id].end = -1;
+	heap_update(id);
 	if (id == (int)sch_list.size() - 1)
 		sch_list.resize(sch_list.size() - 1);
 	else
@@ -134,6 +264,7 @@ void sh4_sched_request(int id, int cycles)
 		if (sched.end == -1)
 			sched.end++;
 	}
+	heap_update(id);
 
 	sh4_sched_ffts();
 }
@@ -162,11 +293,41 @@ static void handle_cb(sched_list& sched)
 	int elapsd = sh4_sched_elapsed(sched);
 	int jitter = elapsd - remain;
 
+	// The callback stays in the heap while it runs so that rescheduling it only needs to move it
 	sched.end = -1;
 	int re_sch = sched.cb(sched.tag, remain, jitter, sched.arg);
 
 	if (re_sch > 0)
 		sh4_sched_request(&sched - &sch_list[0], std::max(0, re_sch - jitter));
+	else
+		heap_update(&sched - &sch_list[0]);
+}
+
+static bool is_expired(const sched_list& sched, u32 fztime, int cycles)
+{
+	int remaining = sh4_sched_remaining(sched, fztime);
+	return remaining >= 0 && remaining <= cycles;
+}
+
+// Find the lowest id greater than lastId of the expired callbacks in the heap subtree at pos.
+// Only the nodes that are due are visited.
+static void find_expired(size_t pos, u64 now, int lastId, u32 fztime, int cycles, int& found)
+{
+	if (pos >= sch_heap.size() || sch_heap[pos].deadline > now)
+		return;
+	int id = sch_heap[pos].id;
+	if (id > lastId && (found == -1 || id < found) && is_expired(sch_list[id], fztime, cycles))
+		found = id;
+	find_expired(pos * 2 + 1, now, lastId, fztime, cycles, found);
+	find_expired(pos * 2 + 2, now, lastId, fztime, cycles, found);
+}
+
+// Returns the lowest id greater than lastId of the callbacks expired in the last *cycles*, or -1
+static int find_expired(int lastId, u32 fztime, int cycles)
+{
+	int found = -1;
+	find_expired(0, sh4_sched_now64(), lastId, fztime, cycles, found);
+	return found;
 }
 
 void sh4_sched_tick(int cycles)
@@ -177,12 +338,13 @@ void sh4_sched_tick(int cycles)
 	u32 fztime = sh4_sched_now() - cycles;
 	if (sh4_sched_next_id != -1)
 	{
-		for (sched_list& sched : sch_list)
-		{
-			int remaining = sh4_sched_remaining(sched, fztime);
-			if (remaining >= 0 && remaining <= (int)cycles)
-				handle_cb(sched);
-		}
+		if (sch_heap_dirty)
+			heap_rebuild();
+		// Fire the expired callbacks by increasing id. Callbacks may schedule other callbacks.
+		sch_ticking = true;
+		for (int id = find_expired(-1, fztime, cycles); id != -1; id = find_expired(id, fztime, cycles))
+			handle_cb(sch_list[id]);
+		sch_ticking = false;
 	}
 	sh4_sched_ffts();
 }
@@ -194,7 +356,12 @@ void sh4_sched_reset(bool hard)
 		sh4_sched_ffb = 0;
 		sh4_sched_next_id = -1;
 		for (sched_list& sched : sch_list)
+		{
 			sched.start = sched.end = -1;
+			sched.heapPos = -1;
+		}
+		sch_heap.clear();
+		sch_heap_dirty = false;
 		Sh4cntx.sh4_sched_next = 0;
 	}
 }
@@ -211,6 +378,7 @@ void sh4_sched_deserialize(Deserializer& deser, int id)
 	deser >> sch_list[id].tag;
 	deser >> sch_list[id].start;
 	deser >> sch_list[id].end;
+	sch_heap_dirty = true;
 }
 
 // FIXME modules should save their scheduling data so that it doesn't depend on their scheduler id
@@ -79,7 +79,6 @@ static void getLocalInput(MapleInputState inputState[4])
 #include <chrono>
 #include <thread>
 #include <mutex>
-#include <unordered_map>
 #include <numeric>
 #include "imgui.h"
 #include "miniupnp.h"
@@ -129,21 +128,45 @@ static bool mouseGame;
 static int inputSize;
 static void (*chatCallback)(int playerNum, const std::string& msg);
 
-struct MemPages
+// Rollback snapshot of a frame
+struct Snapshot
 {
-	void load()
+	void loadPages()
 	{
 		memwatch::ramWatcher.getPages(ram);
 		memwatch::vramWatcher.getPages(vram);
 		memwatch::aramWatcher.getPages(aram);
 		memwatch::elanWatcher.getPages(elanram);
 	}
-	memwatch::PageMap ram;
-	memwatch::PageMap vram;
-	memwatch::PageMap aram;
-	memwatch::PageMap elanram;
+
+	void releasePages()
+	{
+		for (memwatch::PageList *list : { &ram, &vram, &aram, &elanram })
+		{
+			for (const memwatch::SavedPage& page : *list)
+				memwatch::pagePool.release(page.slot);
+			list->clear();
+		}
+	}
+
+	int frame = -1;
+	bool used = false;
+	// Device state. Its storage is reused by the next snapshots.
+	std::vector<u8> state;
+	// Original content of the pages written during the next frame
+	memwatch::PageList ram;
+	memwatch::PageList vram;
+	memwatch::PageList aram;
+	memwatch::PageList elanram;
 };
-static std::unordered_map<int, MemPages> deltaStates;
+// GGPO keeps at most GGPO_MAX_PREDICTION_FRAMES + 2 saved states
+static std::array<Snapshot, GGPO_MAX_PREDICTION_FRAMES + 2> snapshots;
+static u32 nextSnapshot;
+// Size of the device state buffers. Grows when the state doesn't fit.
+static size_t stateSize;
+static float saveTimeAvg;
+static size_t snapshotMemory;
+static size_t peakSnapshotMemory;
 static int lastSavedFrame = -1;
 
 static int timesyncOccurred;
@@ -279,6 +302,42 @@ static bool advance_frame(int)
 	return true;
 }
 
+static Snapshot *findSnapshot(int frame)
+{
+	for (Snapshot& snapshot : snapshots)
+		if (snapshot.used && snapshot.frame == frame)
+			return &snapshot;
+	return nullptr;
+}
+
+static void restorePages(const memwatch::PageList& pages, void *(*getMemPage)(u32 addr))
+{
+	for (const memwatch::SavedPage& page : pages)
+		memcpy(getMemPage(page.offset), memwatch::pagePool.get(page.slot).data, PAGE_SIZE);
+}
+
+static void updateSnapshotMemory()
+{
+	snapshotMemory = memwatch::pagePool.memorySize();
+	for (const Snapshot& snapshot : snapshots)
+		snapshotMemory += snapshot.state.capacity();
+	peakSnapshotMemory = std::max(peakSnapshotMemory, snapshotMemory);
+}
+
+static void freeSnapshots()
+{
+	for (Snapshot& snapshot : snapshots)
+	{
+		snapshot.releasePages();
+		snapshot = Snapshot();
+	}
+	nextSnapshot = 0;
+	stateSize = 0;
+	saveTimeAvg = 0.f;
+	snapshotMemory = 0;
+	peakSnapshotMemory = 0;
+}
+
 /*
  * load_game_state - GGPO.net will call this function at the beginning
  * of a rollback.  The buffer and len parameters contain a previously
@@ -298,17 +357,18 @@ static bool load_game_state(unsigned char *buffer, int len)
 	memwatch::unprotect();
 	for (int f = lastSavedFrame - 1; f >= frame; f--)
 	{
-		const MemPages& pages = deltaStates[f];
-		for (const auto& pair : pages.ram)
-			memcpy(memwatch::ramWatcher.getMemPage(pair.first), &pair.second.data[0], PAGE_SIZE);
-		for (const auto& pair : pages.vram)
-			memcpy(memwatch::vramWatcher.getMemPage(pair.first), &pair.second.data[0], PAGE_SIZE);
-		for (const auto& pair : pages.aram)
-			memcpy(memwatch::aramWatcher.getMemPage(pair.first), &pair.second.data[0], PAGE_SIZE);
-		for (const auto& pair : pages.elanram)
-			memcpy(memwatch::elanWatcher.getMemPage(pair.first), &pair.second.data[0], PAGE_SIZE);
-		DEBUG_LOG(NETWORK, "Restored frame %d pages: %d ram, %d vram, %d eram, %d aica ram", f, (u32)pages.ram.size(),
-					(u32)pages.vram.size(), (u32)pages.elanram.size(), (u32)pages.aram.size());
+		const Snapshot *snapshot = findSnapshot(f);
+		if (snapshot == nullptr)
+			continue;
+		restorePages(snapshot->ram, [](u32 addr) { return memwatch::ramWatcher.getMemPage(addr); });
+		restorePages(snapshot->vram, [](u32 addr) { return memwatch::vramWatcher.getMemPage(addr); });
+		// Only the textures in the restored pages need to be updated
+		for (const memwatch::SavedPage& page : snapshot->vram)
+			VramLockedWriteOffset(page.offset, PAGE_SIZE);
+		restorePages(snapshot->aram, [](u32 addr) { return memwatch::aramWatcher.getMemPage(addr); });
+		restorePages(snapshot->elanram, [](u32 addr) { return memwatch::elanWatcher.getMemPage(addr); });
+		DEBUG_LOG(NETWORK, "Restored frame %d pages: %d ram, %d vram, %d eram, %d aica ram", f, (u32)snapshot->ram.size(),
+					(u32)snapshot->vram.size(), (u32)snapshot->elanram.size(), (u32)snapshot->aram.size());
 	}
 	dc_deserialize(deser);
 	if (deser.size() != (u32)len)
@@ -331,76 +391,107 @@ static bool load_game_state(unsigned char *buffer, int len)
 static bool save_game_state(unsigned char **buffer, int *len, int *checksum, int frame)
 {
 	verify(!sh4_cpu.IsCpuRunning());
-	lastSavedFrame = frame;
-	// TODO this is way too much memory
-	size_t allocSize = settings.platform.isNaomi() ? 20_MB : 10_MB;
-	*buffer = (unsigned char *)malloc(allocSize);
-	if (*buffer == nullptr)
+	const auto start = steady_clock::now();
+	Snapshot *snapshot = nullptr;
+	for (size_t i = 0; i < snapshots.size() && snapshot == nullptr; i++)
 	{
-		WARN_LOG(NETWORK, "Memory alloc failed");
+		Snapshot& s = snapshots[(nextSnapshot + i) % snapshots.size()];
+		if (!s.used)
+			snapshot = &s;
+	}
+	if (snapshot == nullptr)
+	{
+		WARN_LOG(NETWORK, "No free snapshot");
 		*len = 0;
 		return false;
 	}
-	Serializer ser(*buffer, allocSize, true);
+	nextSnapshot = (u32)(snapshot - &snapshots[0] + 1) % snapshots.size();
+	lastSavedFrame = frame;
+
+	// The state is serialized once unless it has grown larger than the previous ones,
+	// which mostly happens when more TA contexts are alive
+	std::vector<u8>& state = snapshot->state;
+	if (state.size() < stateSize)
+		state.resize(stateSize);
+	Serializer ser(state.data(), state.size(), true);
 	ser << frame;
 	dc_serialize(ser);
-	verify(ser.size() < allocSize);
+	if (ser.overflow())
+	{
+		stateSize = ser.size() + ser.size() / 4;
+		state.resize(stateSize);
+		ser = Serializer(state.data(), state.size(), true);
+		ser << frame;
+		dc_serialize(ser);
+		verify(!ser.overflow());
+	}
+	snapshot->frame = frame;
+	snapshot->used = true;
+	*buffer = snapshot->state.data();
 	*len = ser.size();
 #ifdef SYNC_TEST
-	*checksum = XXH32(*buffer, usedSize, 7);
+	*checksum = XXH32(*buffer, *len, 7);
 #endif
 	memwatch::protect();
 	if (frame > 0)
 	{
+		// Save the delta to frame-1
+		Snapshot *previous = findSnapshot(frame - 1);
 #ifdef SYNC_TEST
-		if (deltaStates.count(frame - 1) != 0)
+		if (previous != nullptr && !previous->ram.empty())
 		{
-			MemPages memPages;
-			memPages.load();
-			const MemPages& savedPages = deltaStates[frame - 1];
-			//verify(memPages.ram.size() == savedPages.ram.size());
-			if (memPages.ram.size() != savedPages.ram.size())
+			static Snapshot current;
+			current.loadPages();
+			auto compare = [](const char *name, const memwatch::PageList& pages, const memwatch::PageList& savedPages)
 			{
-				ERROR_LOG(NETWORK, "old ram size %d new %d", (u32)savedPages.ram.size(), (u32)memPages.ram.size());
-				if (memPages.ram.size() > savedPages.ram.size())
-					for (const auto& pair : memPages.ram)
+				if (pages.size() != savedPages.size())
+				{
+					ERROR_LOG(NETWORK, "old %s size %d new %d", name, (u32)savedPages.size(), (u32)pages.size());
+					die("fatal");
+				}
+				for (const memwatch::SavedPage& page : pages)
+				{
+					auto it = std::find_if(savedPages.begin(), savedPages.end(), [&page](const memwatch::SavedPage& saved) {
+						return saved.offset == page.offset;
+					});
+					if (it == savedPages.end())
 					{
-						if (savedPages.ram.count(pair.first) == 0)
-							ERROR_LOG(NETWORK, "new page @ %x", pair.first);
-						else
-							DEBUG_LOG(NETWORK, "page ok @ %x", pair.first);
+						ERROR_LOG(NETWORK, "new %s page @ %x", name, page.offset);
+						die("fatal");
 					}
-				die("fatal");
-			}
-			for (const auto& pair : memPages.ram)
-			{
-				verify(savedPages.ram.count(pair.first) == 1);
-				verify(memcmp(&pair.second[0], &savedPages.ram.find(pair.first)->second[0], PAGE_SIZE) == 0);
-			}
-			verify(memPages.vram.size() == savedPages.vram.size());
-			for (const auto& pair : memPages.vram)
-			{
-				verify(savedPages.vram.count(pair.first) == 1);
-				verify(memcmp(&pair.second[0], &savedPages.vram.find(pair.first)->second[0], PAGE_SIZE) == 0);
-			}
-			//verify(memPages.aram.size() == savedPages.aram.size());
-			if (memPages.aram.size() != savedPages.aram.size())
-			{
-				ERROR_LOG(NETWORK, "old aram size %d new %d", (u32)savedPages.aram.size(), (u32)memPages.aram.size());
-				die("fatal");
-			}
-			for (const auto& pair : memPages.aram)
-			{
-				verify(savedPages.aram.count(pair.first) == 1);
-				verify(memcmp(&pair.second[0], &savedPages.aram.find(pair.first)->second[0], PAGE_SIZE) == 0);
-			}
+					verify(memcmp(memwatch::pagePool.get(page.slot).data, memwatch::pagePool.get(it->slot).data, PAGE_SIZE) == 0);
+				}
+			};
+			compare("ram", current.ram, previous->ram);
+			compare("vram", current.vram, previous->vram);
+			compare("aram", current.aram, previous->aram);
+			// put the pages back in place of the saved ones
+			previous->releasePages();
+			std::swap(previous->ram, current.ram);
+			std::swap(previous->vram, current.vram);
+			std::swap(previous->aram, current.aram);
+			std::swap(previous->elanram, current.elanram);
 		}
+		else
 #endif
-		// Save the delta to frame-1
-		deltaStates[frame - 1].load();
-		DEBUG_LOG(NETWORK, "Saved frame %d pages: %d ram, %d vram, %d eram, %d aica ram", frame - 1, (u32)deltaStates[frame - 1].ram.size(),
-				(u32)deltaStates[frame - 1].vram.size(), (u32)deltaStates[frame - 1].elanram.size(), (u32)deltaStates[frame - 1].aram.size());
+		if (previous != nullptr)
+		{
+			previous->releasePages();
+			previous->loadPages();
+			DEBUG_LOG(NETWORK, "Saved frame %d pages: %d ram, %d vram, %d eram, %d aica ram", frame - 1, (u32)previous->ram.size(),
+					(u32)previous->vram.size(), (u32)previous->elanram.size(), (u32)previous->aram.size());
+		}
+		else
+		{
+			// Nothing to roll back to
+			static Snapshot unused;
+			unused.loadPages();
+			unused.releasePages();
+		}
 	}
+	updateSnapshotMemory();
+	const float saveTime = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.f;
+	saveTimeAvg = saveTimeAvg == 0.f ? saveTime : saveTimeAvg * 0.95f + saveTime * 0.05f;
 
 	return true;
 }
@@ -438,14 +529,16 @@ static bool log_game_state(char *filename, unsigned char *buffer, int len)
  */
 static void free_buffer(void *buffer)
 {
-	if (buffer != nullptr)
-	{
-		Deserializer deser(buffer, 1_MB, true);
-		int frame;
-		deser >> frame;
-		deltaStates.erase(frame);
-		free(buffer);
-	}
+	if (buffer == nullptr)
+		return;
+	for (Snapshot& snapshot : snapshots)
+		if (snapshot.used && snapshot.state.data() == buffer)
+		{
+			snapshot.used = false;
+			snapshot.frame = -1;
+			snapshot.releasePages();
+			break;
+		}
 }
 
 static void on_message(u8 *msg, int len)
@@ -613,6 +706,8 @@ void stopSession()
 	emu.setNetworkState(false);
 	memwatch::unprotect();
 	memwatch::reset();
+	freeSnapshots();
+	memwatch::pagePool.clear();
 }
 
 void getInput(MapleInputState inputState[4])
@@ -906,6 +1001,19 @@ void displayStats()
 		timesyncOccurred--;
 	}
 
+	// Rollback snapshot save time
+	ImGui::Text("Save");
+	char saveTime[16];
+	snprintf(saveTime, sizeof(saveTime), "%.1f ms", saveTimeAvg);
+	ImGui::SameLine(ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(saveTime).x);
+	ImGui::Text("%s", saveTime);
+
+	// Rollback snapshot peak memory
+	ImGui::Text("Mem");
+	std::string memory = std::to_string((peakSnapshotMemory + 1_MB - 1) / 1_MB) + " MB";
+	ImGui::SameLine(ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(memory.c_str()).x);
+	ImGui::Text("%s", memory.c_str());
+
 	ImGui::End();
 }
 
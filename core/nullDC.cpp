@@ -11,11 +11,15 @@
 #include "oslib/storage.h"
 #include "debug/gdb_server.h"
 #include "archive/rzip.h"
+#include "archive/zstdchunk.h"
 #include "ui/mainui.h"
 #include "input/gamepad_device.h"
 #include "lua/lua.h"
 #include "stdclass.h"
 #include "serialize.h"
+#include "rend/norend/norend.h"
+#include "hw/mem/mem_watch.h"
+#include <chrono>
 #include <time.h>
 
 static std::string lastStateFile;
@@ -44,6 +48,121 @@ struct SavestateHeader
 	static constexpr const char *MAGIC = "FLYSAVE1";
 };
 
+// Incremental savestates are appended to a delta file next to their base savestate
+struct SavestateDeltaHeader
+{
+	void init(u64 baseDate)
+	{
+		memcpy(magic, MAGIC, sizeof(magic));
+		creationDate = time(nullptr);
+		this->baseDate = baseDate;
+		version = Deserializer::Current;
+		pngSize = 0;
+		dataSize = 0;
+	}
+
+	bool isValid() const {
+		return !memcmp(magic, MAGIC, sizeof(magic));
+	}
+
+	char magic[8];
+	u64 creationDate;
+	u64 baseDate;	// creation date of the base savestate
+	u32 version;
+	u32 pngSize;
+	u64 dataSize;
+	// png data
+	// savestate data: written pages then rollback state
+
+	static constexpr const char *MAGIC = "FLYDELT1";
+};
+
+struct SavestateDelta
+{
+	SavestateDeltaHeader header;
+	long offset;	// png data offset
+};
+
+// Memory pages written since the last savestate
+struct DirtyPages
+{
+	void load()
+	{
+		memwatch::ramWatcher.getDirtyPages(ram);
+		memwatch::vramWatcher.getDirtyPages(vram);
+		memwatch::aramWatcher.getDirtyPages(aram);
+		memwatch::elanWatcher.getDirtyPages(elanram);
+	}
+
+	void serialize(Serializer& ser) const
+	{
+		serialize(ser, ram, memwatch::ramWatcher);
+		serialize(ser, vram, memwatch::vramWatcher);
+		serialize(ser, aram, memwatch::aramWatcher);
+		serialize(ser, elanram, memwatch::elanWatcher);
+	}
+
+	static void deserialize(Deserializer& deser)
+	{
+		deserialize(deser, &mem_b[0], RAM_SIZE);
+		deserialize(deser, &::vram[0], VRAM_SIZE);
+		deserialize(deser, &aica::aica_ram[0], ARAM_SIZE);
+		deserialize(deser, elan::RAM, elan::ERAM_SIZE);
+	}
+
+	size_t size() const {
+		return ram.size() + vram.size() + aram.size() + elanram.size();
+	}
+
+	std::vector<u32> ram;
+	std::vector<u32> vram;
+	std::vector<u32> aram;
+	std::vector<u32> elanram;
+
+private:
+	template<typename T>
+	static void serialize(Serializer& ser, const std::vector<u32>& offsets, T& watcher)
+	{
+		ser << (u32)offsets.size();
+		for (u32 offset : offsets)
+		{
+			ser << offset;
+			ser.serialize((const u8 *)watcher.getMemPage(offset), PAGE_SIZE);
+		}
+	}
+
+	static void deserialize(Deserializer& deser, u8 *mem, u32 size)
+	{
+		u32 count;
+		deser >> count;
+		for (u32 i = 0; i < count; i++)
+		{
+			u32 offset;
+			deser >> offset;
+			if ((offset & PAGE_MASK) != 0 || offset >= size || size - offset < PAGE_SIZE)
+				throw Deserializer::Exception("Invalid savestate page");
+			deser.deserialize(mem + offset, PAGE_SIZE);
+		}
+	}
+};
+
+// Savestate to which deltas are appended while memory writes are tracked
+static struct {
+	std::string path;
+	u64 baseDate;
+	u32 generation;
+	int deltaCount;
+	u64 deltaSize;
+} deltaChain;
+// Full savestates are compressed and written in the background, one at a time
+static WorkerPool savestateQueue("Savestate", 0);
+// Serialized state being written, reused by the next savestate
+static std::vector<u8> savestateData;
+static bool savestateWriteFailed;
+// A new base savestate is written past these limits
+constexpr int MaxSavestateDeltas = 30;
+constexpr u64 MaxSavestateDeltaSize = 64_MB;
+
 int flycast_init(int argc, char* argv[])
 {
 #if defined(TEST_AUTOMATION)
@@ -77,6 +196,13 @@ int flycast_init(int argc, char* argv[])
 		LogManager::Init();
 		config::Settings::instance().load(false);
 	}
+	if (settings.benchmarkFrames > 0)
+	{
+		// Headless: no window or input needed
+		bool success = rend_benchmark(settings.benchmarkFrames);
+		emu.term();
+		exit(success ? 0 : 1);
+	}
 	gui_init();
 	os_CreateWindow();
 	os_SetupInput();
@@ -117,83 +243,264 @@ void flycast_term()
 	gui_cancel_load();
 	lua::term();
 	emu.term();
+	// pending savestate
+	savestateQueue.wait();
 	os_DestroyWindow();
 	gui_term();
 	os_TermInput();
 }
 
-void dc_savestate(int index, const u8 *pngData, u32 pngSize)
+static std::string getDeltaPath(const std::string& statePath) {
+	return statePath + ".delta";
+}
+
+// Tracks memory writes from now on so that the next savestates of this file only contain the written pages
+static void startDeltaChain(const std::string& path, u64 baseDate, int deltaCount, u64 deltaSize)
 {
-	if (settings.network.online)
+	deltaChain.path.clear();
+	if (!config::IncrementalSavestates || baseDate == 0)
 		return;
+	memwatch::reset();
+	memwatch::protect();
+	if (!memwatch::watching)
+		return;
+	deltaChain.path = path;
+	deltaChain.baseDate = baseDate;
+	deltaChain.generation = memwatch::generation;
+	deltaChain.deltaCount = deltaCount;
+	deltaChain.deltaSize = deltaSize;
+}
 
-	lastStateFile.clear();
-
-	Serializer ser;
+// Appends the pages written since the last savestate and the device state to the delta file.
+// Returns false if a full savestate is needed.
+static bool saveDelta(const std::string& filename, const u8 *pngData, u32 pngSize)
+{
+	if (deltaChain.path != filename || !config::IncrementalSavestates || savestateWriteFailed
+			|| !memwatch::watching || deltaChain.generation != memwatch::generation
+			|| deltaChain.deltaCount >= MaxSavestateDeltas || deltaChain.deltaSize >= MaxSavestateDeltaSize)
+		return false;
+	// Memory is being tracked for this file, the delta must be saved or a new base is needed
+	deltaChain.path.clear();
+
+	const auto start = std::chrono::steady_clock::now();
+	// protect the written pages again before getting them
+	memwatch::protect();
+	DirtyPages pages;
+	pages.load();
+
+	Serializer ser(nullptr, std::numeric_limits<size_t>::max(), true);
+	pages.serialize(ser);
+	dc_serialize(ser);
+	std::vector<u8> data(ser.size());
+	ser = Serializer(data.data(), data.size(), true);
+	pages.serialize(ser);
 	dc_serialize(ser);
 
-	void *data = malloc(ser.size());
-	if (data == nullptr)
+	const std::string deltaPath = getDeltaPath(filename);
+	FILE *f = nowide::fopen(deltaPath.c_str(), "ab");
+	if (f == nullptr)
 	{
-		WARN_LOG(SAVESTATE, "Failed to save state - could not malloc %d bytes", (int)ser.size());
-		os_notify("Save state failed - memory full", 5000);
-    	return;
+		WARN_LOG(SAVESTATE, "Failed to save state delta - could not open %s for writing", deltaPath.c_str());
+		return false;
 	}
+	SavestateDeltaHeader header;
+	header.init(deltaChain.baseDate);
+	header.pngSize = pngSize;
+	header.dataSize = data.size();
+	bool success = std::fwrite(&header, sizeof(header), 1, f) == 1
+			&& (pngSize == 0 || std::fwrite(pngData, 1, pngSize, f) == pngSize)
+			&& std::fwrite(data.data(), 1, data.size(), f) == data.size();
+	success = std::fclose(f) == 0 && success;
+	if (!success)
+	{
+		WARN_LOG(SAVESTATE, "Failed to save state delta - error writing %s", deltaPath.c_str());
+		return false;
+	}
+	deltaChain.path = filename;
+	deltaChain.deltaCount++;
+	deltaChain.deltaSize += sizeof(header) + pngSize + data.size();
 
-	ser = Serializer(data, ser.size());
-	dc_serialize(ser);
+	const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	NOTICE_LOG(SAVESTATE, "Saved state delta %d to %s size %d (%d pages) in %.1f ms", deltaChain.deltaCount,
+			deltaPath.c_str(), (int)data.size(), (int)pages.size(), time);
+	os_notify("State saved", 2000);
+	return true;
+}
 
-	std::string filename = hostfs::getSavestatePath(index, true);
+// Returns the valid deltas of the given base savestate.
+// complete is set to false if the file contains anything else.
+static std::vector<SavestateDelta> readDeltas(FILE *f, u64 baseDate, bool& complete)
+{
+	std::fseek(f, 0, SEEK_END);
+	const long fileSize = std::ftell(f);
+	std::fseek(f, 0, SEEK_SET);
+
+	std::vector<SavestateDelta> deltas;
+	long pos = 0;
+	SavestateDeltaHeader header;
+	while (std::fread(&header, sizeof(header), 1, f) == 1 && header.isValid() && header.baseDate == baseDate)
+	{
+		const long offset = pos + sizeof(header);
+		if ((u64)(fileSize - offset) < header.pngSize + header.dataSize)
+			// truncated
+			break;
+		deltas.push_back({ header, offset });
+		pos = offset + header.pngSize + header.dataSize;
+		std::fseek(f, pos, SEEK_SET);
+	}
+	complete = pos == fileSize;
+
+	return deltas;
+}
+
+static bool getLastDelta(const std::string& filename, u64 baseDate, SavestateDelta& lastDelta)
+{
+	FILE *f = hostfs::storage().openFile(getDeltaPath(filename), "rb");
+	if (f == nullptr)
+		return false;
+	bool complete;
+	std::vector<SavestateDelta> deltas = readDeltas(f, baseDate, complete);
+	std::fclose(f);
+	if (deltas.empty())
+		return false;
+	lastDelta = deltas.back();
+	return true;
+}
+
+// Applies the deltas saved after the given base savestate.
+// Memory pages of all deltas are restored in order but only the device state of the last one is loaded.
+static void loadDeltas(int index, const std::string& filename, u64 baseDate)
+{
+	deltaChain.path.clear();
+	const std::string deltaPath = getDeltaPath(filename);
+	std::vector<std::vector<u8>> deltaData;
+	u64 deltaSize = 0;
+	bool complete = true;
+	FILE *f = hostfs::storage().openFile(deltaPath, "rb");
+	if (f != nullptr)
+	{
+		std::vector<SavestateDelta> deltas = readDeltas(f, baseDate, complete);
+		for (const SavestateDelta& delta : deltas)
+		{
+			std::vector<u8>& data = deltaData.emplace_back(delta.header.dataSize);
+			std::fseek(f, delta.offset + delta.header.pngSize, SEEK_SET);
+			if (std::fread(data.data(), 1, data.size(), f) != data.size())
+			{
+				std::fclose(f);
+				throw Deserializer::Exception("I/O error");
+			}
+			deltaSize = delta.offset + delta.header.pngSize + delta.header.dataSize;
+		}
+		std::fclose(f);
+	}
+	for (const std::vector<u8>& data : deltaData)
+	{
+		Deserializer deser(data.data(), data.size(), true);
+		DirtyPages::deserialize(deser);
+		if (&data == &deltaData.back())
+		{
+			dc_loadstate(deser);
+			NOTICE_LOG(SAVESTATE, "Loaded %d state deltas from %s", (int)deltaData.size(), deltaPath.c_str());
+			if (deser.size() != data.size())
+				WARN_LOG(SAVESTATE, "Savestate delta size %d but only %d bytes used", (int)data.size(), (int)deser.size());
+		}
+	}
+	// Later savestates can be appended to this chain unless the file is read-only or contains invalid data
+	if (complete && filename == hostfs::getSavestatePath(index, true))
+		startDeltaChain(filename, baseDate, (int)deltaData.size(), deltaSize);
+}
+
+static void writeSavestate(const std::string& filename, const SavestateHeader& header, const std::vector<u8>& pngData,
+		size_t size, int level)
+{
 	FILE *f = nowide::fopen(filename.c_str(), "wb");
 	if (f == nullptr)
 	{
 		WARN_LOG(SAVESTATE, "Failed to save state - could not open %s for writing", filename.c_str());
 		os_notify("Cannot open save file", 5000);
-		free(data);
-    	return;
+		savestateWriteFailed = true;
+		return;
 	}
 
-	RZipFile zipFile;
-	SavestateHeader header;
-	header.init();
-	header.pngSize = pngSize;
-	if (std::fwrite(&header, sizeof(header), 1, f) != 1)
-		goto fail;
-	if (pngSize > 0 && std::fwrite(pngData, 1, pngSize, f) != pngSize)
-		goto fail;
-
-#if 0
-	// Uncompressed savestate
-	std::fwrite(data, 1, ser.size(), f);
-	std::fclose(f);
-#else
-	if (!zipFile.Open(f, true))
-		goto fail;
-	if (zipFile.Write(data, ser.size()) != ser.size())
-		goto fail;
-	zipFile.Close();
-#endif
+	ZstdChunkFile chunkFile;
+	bool success = std::fwrite(&header, sizeof(header), 1, f) == 1
+			&& (pngData.empty() || std::fwrite(pngData.data(), 1, pngData.size(), f) == pngData.size());
+	if (success && chunkFile.Open(f, true, level))
+	{
+		success = chunkFile.Write(savestateData.data(), size) == size;
+		// also closes f
+		success = chunkFile.Close() && success;
+	}
+	else
+	{
+		std::fclose(f);
+		success = false;
+	}
+	if (!success)
+	{
+		WARN_LOG(SAVESTATE, "Failed to save state - error writing %s", filename.c_str());
+		os_notify("Error saving state", 5000);
+		savestateWriteFailed = true;
+		// delete failed savestate?
+		return;
+	}
 
-	free(data);
-	NOTICE_LOG(SAVESTATE, "Saved state to %s size %d", filename.c_str(), (int)ser.size());
+	NOTICE_LOG(SAVESTATE, "Saved state to %s size %d", filename.c_str(), (int)size);
 	os_notify("State saved", 2000);
-	return;
+	// Deltas of the previous base are obsolete
+	nowide::remove(getDeltaPath(filename).c_str());
+}
 
-fail:
-	WARN_LOG(SAVESTATE, "Failed to save state - error writing %s", filename.c_str());
-	os_notify("Error saving state", 5000);
-	if (zipFile.rawFile() != nullptr)
-		zipFile.Close();
-	else
-		std::fclose(f);
-	free(data);
-	// delete failed savestate?
+void dc_savestate(int index, const u8 *pngData, u32 pngSize)
+{
+	if (settings.network.online)
+		return;
+
+	// The previous savestate buffer and file must not be in use
+	savestateQueue.wait();
+	lastStateFile.clear();
+
+	std::string filename = hostfs::getSavestatePath(index, true);
+	if (saveDelta(filename, pngData, pngSize))
+		return;
+	deltaChain.path.clear();
+
+	const auto start = std::chrono::steady_clock::now();
+	Serializer ser;
+	dc_serialize(ser);
+	try {
+		savestateData.resize(ser.size());
+	} catch (const std::bad_alloc&) {
+		WARN_LOG(SAVESTATE, "Failed to save state - could not malloc %d bytes", (int)ser.size());
+		os_notify("Save state failed - memory full", 5000);
+		return;
+	}
+	ser = Serializer(savestateData.data(), ser.size());
+	dc_serialize(ser);
+
+	SavestateHeader header;
+	header.init();
+	header.pngSize = pngSize;
+	startDeltaChain(filename, header.creationDate, 0, 0);
+	const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	NOTICE_LOG(SAVESTATE, "State snapshot taken in %.1f ms", time);
+
+	// Compress and write the snapshot in the background
+	lastStateFile = filename;
+	lastStateTime = (time_t)header.creationDate;
+	savestateWriteFailed = false;
+	std::vector<u8> png(pngData, pngData + pngSize);
+	const int level = config::CompactSavestates ? ZstdChunkFile::Small : ZstdChunkFile::Fast;
+	savestateQueue.push([filename, header, png = std::move(png), size = ser.size(), level]() {
+		writeSavestate(filename, header, png, size, level);
+	}, 1);
 }
 
 void dc_loadstate(int index)
 {
 	if (settings.raHardcoreMode)
 		return;
+	savestateQueue.wait();
 	u32 total_size = 0;
 
 	std::string filename = hostfs::getSavestatePath(index, false);
@@ -208,14 +515,18 @@ void dc_loadstate(int index)
 	if (std::fread(&header, sizeof(header), 1, f) == 1)
 	{
 		if (!header.isValid())
+		{
+			header.creationDate = 0;
 			// seek to beginning of file if this isn't a valid header (legacy savestate)
 			std::fseek(f, 0, SEEK_SET);
+		}
 		else
 			// skip png data
 			std::fseek(f, header.pngSize, SEEK_CUR);
 	}
 	else {
 		// probably not a valid savestate but we'll fail later
+		header.creationDate = 0;
 		std::fseek(f, 0, SEEK_SET);
 	}
 
@@ -226,8 +537,13 @@ void dc_loadstate(int index)
 				.getDigest(settings.network.md5.savestate);
 		std::fseek(f, pos, SEEK_SET);
 	}
+	ZstdChunkFile chunkFile;
 	RZipFile zipFile;
-	if (zipFile.Open(f, false)) {
+	if (chunkFile.Open(f, false)) {
+		total_size = (u32)chunkFile.Size();
+	}
+	// rzip savestates created by older versions
+	else if (zipFile.Open(f, false)) {
 		total_size = (u32)zipFile.Size();
 	}
 	else
@@ -242,15 +558,23 @@ void dc_loadstate(int index)
 	{
 		WARN_LOG(SAVESTATE, "Failed to load state - could not malloc %d bytes", total_size);
 		os_notify("Failed to load state", 5000, "Not enough memory");
-		if (zipFile.rawFile() == nullptr)
-			std::fclose(f);
-		else
+		if (chunkFile.rawFile() != nullptr)
+			chunkFile.Close();
+		else if (zipFile.rawFile() != nullptr)
 			zipFile.Close();
+		else
+			std::fclose(f);
 		return;
 	}
 
 	size_t read_size;
-	if (zipFile.rawFile() != nullptr)
+	if (chunkFile.rawFile() != nullptr)
+	{
+		// decompressed in parallel
+		read_size = chunkFile.Read(data, total_size);
+		chunkFile.Close();
+	}
+	else if (zipFile.rawFile() != nullptr)
 	{
 		read_size = zipFile.Read(data, total_size);
 		zipFile.Close();
@@ -275,6 +599,8 @@ void dc_loadstate(int index)
 		if (deser.size() != total_size)
 			// Note: this isn't true for RA savestates
 			WARN_LOG(SAVESTATE, "Savestate size %d but only %d bytes used", total_size, (int)deser.size());
+		if (header.creationDate != 0 && index >= 0)
+			loadDeltas(index, filename, header.creationDate);
 	} catch (const Deserializer::Exception& e) {
 		ERROR_LOG(SAVESTATE, "%s", e.what());
 		os_notify("Failed to load state", 5000, e.what());
@@ -309,6 +635,9 @@ time_t dc_getStateCreationDate(int index)
 			else {
 				std::fclose(f);
 				lastStateTime = (time_t)header.creationDate;
+				SavestateDelta delta;
+				if (getLastDelta(filename, header.creationDate, delta))
+					lastStateTime = (time_t)delta.header.creationDate;
 			}
 		}
 	}
@@ -318,16 +647,31 @@ time_t dc_getStateCreationDate(int index)
 void dc_getStateScreenshot(int index, std::vector<u8>& pngData)
 {
 	pngData.clear();
+	savestateQueue.wait();
 	std::string filename = hostfs::getSavestatePath(index, false);
 	FILE *f = hostfs::storage().openFile(filename, "rb");
 	if (f == nullptr)
 		return;
 	SavestateHeader header;
-	if (std::fread(&header, sizeof(header), 1, f) == 1 && header.isValid() && header.pngSize != 0)
+	if (std::fread(&header, sizeof(header), 1, f) == 1 && header.isValid())
 	{
-		pngData.resize(header.pngSize);
-		if (std::fread(pngData.data(), 1, pngData.size(), f) != pngData.size())
-			pngData.clear();
+		SavestateDelta delta;
+		if (getLastDelta(filename, header.creationDate, delta) && delta.header.pngSize != 0)
+		{
+			// Use the screenshot of the last delta
+			std::fclose(f);
+			f = hostfs::storage().openFile(getDeltaPath(filename), "rb");
+			if (f == nullptr)
+				return;
+			std::fseek(f, delta.offset, SEEK_SET);
+			header.pngSize = delta.header.pngSize;
+		}
+		if (header.pngSize != 0)
+		{
+			pngData.resize(header.pngSize);
+			if (std::fread(pngData.data(), 1, pngData.size(), f) != pngData.size())
+				pngData.clear();
+		}
 	}
 	std::fclose(f);
 }
@@ -154,6 +154,21 @@ std::string getShaderCachePath(const std::string& filename)
 	return get_writable_data_path(filename);
 }
 
+std::string getBlockCachePath(const std::string& gameId)
+{
+	return get_writable_data_path(gameId + ".sh4cache");
+}
+
+std::string getTextureCachePath(const std::string& gameId)
+{
+	return get_writable_data_path(gameId + ".texcache");
+}
+
+std::string getTexturePackPath(const std::string& gameId)
+{
+	return get_writable_data_path(gameId + ".texpack");
+}
+
 std::string getTextureLoadPath(const std::string& gameId)
 {
 	if (gameId.length() > 0)
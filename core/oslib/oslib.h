@@ -61,6 +61,9 @@ namespace hostfs
 	std::string getTextureDumpPath();
 
 	std::string getShaderCachePath(const std::string& filename);
+	std::string getBlockCachePath(const std::string& gameId);
+	std::string getTextureCachePath(const std::string& gameId);
+	std::string getTexturePackPath(const std::string& gameId);
 	void saveScreenshot(const std::string& name, const std::vector<u8>& data);
 
 #ifdef __ANDROID__
@@ -2327,6 +2327,8 @@ public:
 		if ((u8 *)code_ptr < (u8 *)codeBuffer->getBase()
 				|| (u8 *)code_ptr >= (u8 *)codeBuffer->getBase() + codeBuffer->getSize())
 			return false;
+		// The background compiler may be writing to the code buffer
+		std::lock_guard<std::recursive_mutex> _(rdv_CompileMutex());
 		jitWriteProtect(*codeBuffer, false);
 		u32 armv8_op = *code_ptr;
 		bool is_read = false;
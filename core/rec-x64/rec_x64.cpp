@@ -289,6 +289,26 @@ public:
 				genBaseOpcode(op);
 				break;
 
+			case shop_cond_exit:
+				if (op.rs1.is_imm())
+				{
+					// condition is known at compile time
+					if (op.rs1.imm_value() != op.size)
+						break;
+				}
+				else
+				{
+					Xbyak::Label no_exit;
+					mov(rax, (uintptr_t)op.rs1.reg_ptr());
+					cmp(dword[rax], op.size);
+					jne(no_exit, T_NEAR);
+					genSideExit(op);
+					L(no_exit);
+					break;
+				}
+				genSideExit(op);
+				break;
+
 #ifndef CANONICAL_TEST
 			case shop_sync_sr:
 				GenCall(UpdateSR);
@@ -331,7 +351,7 @@ public:
 				if (op.rs2.is_reg())
 					movsxd(rcx, regalloc.MapRegister(op.rs2));
 				else
-					mov(rcx, (s64)(s32)op.rs2._imm);
+					movConst(rcx, (s64)(s32)op.rs2._imm);
 				mul(rcx);
 				mov(regalloc.MapRegister(op.rd), eax);
 				shr(rax, 32);
@@ -694,6 +714,10 @@ public:
 		mov(rax, (size_t)&p_sh4rcb->cntx.pc);
 		mov(call_regs[0], dword[rax]);
 		call(bm_GetCodeByVAddr);
+#if !defined(NDEBUG) || defined(DEBUGFAST)
+		mov(rcx, (uintptr_t)&rdv_blockDispatches);
+		add(dword[rcx], 1);
+#endif
 		call(rax);
 		mov(rax, (uintptr_t)&p_sh4rcb->cntx.cycle_counter);
 		mov(ecx, dword[rax]);
@@ -1045,6 +1069,19 @@ private:
 		return true;
 	}
 
+	// Leave the block to the branch target and give back the cycles of the remaining ops
+	void genSideExit(const shil_opcode& op)
+	{
+		mov(rax, (uintptr_t)&next_pc);
+		mov(dword[rax], op.rs2.imm_value());
+		if (op.rs3.imm_value() != 0)
+		{
+			mov(rax, (uintptr_t)&p_sh4rcb->cntx.cycle_counter);
+			add(dword[rax], op.rs3.imm_value());
+		}
+		jmp(exit_block, T_NEAR);
+	}
+
 	void CheckBlock(bool force_checks, RuntimeBlockInfo* block)
 	{
 		if (mmu_enabled() || force_checks)
@@ -1076,7 +1113,7 @@ private:
 				mov(rax, uintptr);
 
 				if (sz >= 8 && !(uintptr & 7)) {
-					mov(rdx, *(u64*)ptr);
+					movConst(rdx, *(u64*)ptr);
 					cmp(qword[rax], rdx);
 					sz -= 8;
 					sa += 8;
@@ -1322,6 +1359,7 @@ public:
 		} catch (const Xbyak::Error& e) {
 			ERROR_LOG(DYNAREC, "Fatal xbyak error: %s", e.what());
 		}
+		relocatable = ccCompiler->getRelocations(relocations);
 		delete ccCompiler;
 		ccCompiler = nullptr;
 		virtmem::jit_set_exec(protStart, protSize, true);
@@ -1332,6 +1370,32 @@ public:
 		this->codeBuffer = &codeBuffer;
 	}
 
+	bool supportsSideExits() override {
+		return true;
+	}
+
+	bool getRelocations(const RuntimeBlockInfo *block, std::vector<CodeRelocation>& relocations) override
+	{
+		if (!relocatable)
+			return false;
+		relocations = this->relocations;
+		return true;
+	}
+
+	bool relocate(void *code, u32 size, const std::vector<CodeRelocation>& relocations, const RelocationDeltas& deltas) override
+	{
+		for (const CodeRelocation& reloc : relocations)
+		{
+			if (reloc.offset + sizeof(u64) > size)
+				return false;
+			u64 address;
+			memcpy(&address, (u8 *)code + reloc.offset, sizeof(address));
+			address += deltas.get(reloc.type);
+			memcpy((u8 *)code + reloc.offset, &address, sizeof(address));
+		}
+		return true;
+	}
+
 	void mainloop(void *) override
 	{
 		verify(::mainloop != nullptr);
@@ -1363,6 +1427,8 @@ public:
 		if (codeBuffer == nullptr)
 			// init() not called yet
 			return false;
+		// The background compiler may be writing to the code buffer
+		std::lock_guard<std::recursive_mutex> _(rdv_CompileMutex());
 		void* protStart = codeBuffer->get();
 		size_t protSize = codeBuffer->getFreeSpace();
 		virtmem::jit_set_exec(protStart, protSize, false);
@@ -1407,6 +1473,9 @@ public:
 private:
 	Sh4CodeBuffer *codeBuffer = nullptr;
 	BlockCompiler *ccCompiler = nullptr;
+	// relocations of the last compiled block
+	std::vector<CodeRelocation> relocations;
+	bool relocatable = false;
 };
 
 static X64Dynarec instance;
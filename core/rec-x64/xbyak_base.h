@@ -19,6 +19,7 @@
 #pragma once
 #include "types.h"
 #include "hw/sh4/dyna/ngen.h"
+#include "hw/sh4/dyna/blockcache.h"
 #include "hw/sh4/sh4_rom.h"
 
 #include <xbyak/xbyak.h>
@@ -27,10 +28,50 @@
 template<typename T, bool ArchX64>
 class BaseXbyakRec : public Xbyak::CodeGenerator
 {
+public:
+	// Retrieve the host address relocations of the generated code.
+	// Returns false if the code can't be relocated.
+	bool getRelocations(std::vector<CodeRelocation>& relocations)
+	{
+		if (!relocatable)
+			return false;
+		relocations = std::move(this->relocations);
+		return true;
+	}
+
 protected:
 	BaseXbyakRec(Sh4CodeBuffer& codeBuffer) : BaseXbyakRec(codeBuffer, (u8 *)codeBuffer.get()) { }
 	BaseXbyakRec(Sh4CodeBuffer& codeBuffer, u8 *code_ptr) : Xbyak::CodeGenerator(codeBuffer.getFreeSpace(), code_ptr), codeBuffer(codeBuffer) { }
 
+	using Xbyak::CodeGenerator::mov;
+#ifndef XBYAK32
+	// Keep track of the host addresses loaded in registers so that the code can be relocated
+	// by the persistent block cache
+	void mov(const Xbyak::Reg64& reg, uintptr_t imm)
+	{
+		size_t start = getSize();
+		Xbyak::CodeGenerator::mov(reg, (uint64_t)imm);
+		if (!relocatable)
+			return;
+		CodeRelocation::Type type;
+		if (!blockcache::classifyAddress(imm, type))
+		{
+			// Unknown host pointer. Constants must be loaded with movConst()
+			if (imm >= 0x10000)
+				relocatable = false;
+		}
+		else if (getSize() - start != 10)
+			// 32-bit encoding
+			relocatable = false;
+		else
+			relocations.push_back({ (u32)(getSize() - 8), type });
+	}
+	// Load a constant that isn't a host address
+	void movConst(const Xbyak::Reg64& reg, u64 imm) {
+		Xbyak::CodeGenerator::mov(reg, imm);
+	}
+#endif
+
 	using BinaryOp = void (BaseXbyakRec::*)(const Xbyak::Operand&, const Xbyak::Operand&);
 	using BinaryFOp = void (BaseXbyakRec::*)(const Xbyak::Xmm&, const Xbyak::Operand&);
 
@@ -774,6 +815,8 @@ protected:
 	}
 
 	Sh4CodeBuffer& codeBuffer;
+	std::vector<CodeRelocation> relocations;
+	bool relocatable = true;
 
 private:
 	Xbyak::Reg32 mapRegister(const shil_param& param) {
@@ -23,7 +23,9 @@
 #include "cfg/option.h"
 #include "oslib/oslib.h"
 
+#include <algorithm>
 #include <sstream>
+#include <nowide/cstdio.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ONLY_JPEG
 #define STBI_ONLY_PNG
@@ -33,54 +35,59 @@
 
 CustomTexture custom_texture;
 
+constexpr u32 PACK_MAGIC = 0x4b505854;	// TXPK
+constexpr u32 PACK_VERSION = 1;
+// Offsets are passed to fseek
+constexpr u64 MAX_PACK_SIZE = 2_GB - 1;
+
 void CustomTexture::LoaderThread()
 {
-	LoadMap();
-	while (initialized)
+	ThreadName _("CustomTexLoader");
 	{
-		BaseTextureCacheData *texture;
-		
-		do {
-			texture = nullptr;
-			{
-				std::unique_lock<std::mutex> lock(work_queue_mutex);
-				if (!work_queue.empty())
-				{
-					texture = work_queue.back();
-					work_queue.pop_back();
-				}
-			}
-			
-			if (texture != nullptr)
-			{
-				texture->ComputeHash();
-				if (texture->custom_image_data != nullptr)
-				{
-					free(texture->custom_image_data);
-					texture->custom_image_data = nullptr;
-				}
-				if (!texture->dirty)
-				{
-					int width, height;
-					u8 *image_data = LoadCustomTexture(texture->texture_hash, width, height);
-					if (image_data == nullptr && texture->old_vqtexture_hash != 0)
-						image_data = LoadCustomTexture(texture->old_vqtexture_hash, width, height);
-					if (image_data == nullptr)
-						image_data = LoadCustomTexture(texture->old_texture_hash, width, height);
-					if (image_data != nullptr)
-					{
-						texture->custom_width = width;
-						texture->custom_height = height;
-						texture->custom_image_data = image_data;
-					}
-				}
-				texture->custom_load_in_progress--;
-			}
+		std::lock_guard<std::mutex> lock(map_mutex);
+		if (!map_loaded)
+		{
+			LoadMap();
+			OpenPack();
+			map_loaded = true;
+		}
+	}
+	std::unique_lock<std::mutex> lock(work_queue_mutex);
+	while (true)
+	{
+		work_available.wait(lock, [this]() { return !initialized || !work_queue.empty(); });
+		if (!initialized)
+			break;
+		std::pop_heap(work_queue.begin(), work_queue.end());
+		Request request = work_queue.back();
+		work_queue.pop_back();
+		lock.unlock();
 
-		} while (texture != nullptr);
-		
-		wakeup_thread.Wait();
+		LoadTexture(request);
+
+		lock.lock();
+	}
+}
+
+void CustomTexture::LoadTexture(const Request& request)
+{
+	BaseTextureCacheData *texture = request.texture;
+	// Requests superseded by a newer one are skipped
+	const bool latest = request.sequence == texture->custom_request;
+	u8 *image_data = nullptr;
+	int width = 0, height = 0;
+	if (latest && !texture->dirty)
+	{
+		image_data = LoadCustomTexture(request.hashes[0], width, height);
+		if (image_data == nullptr && request.hashes[1] != 0)
+			image_data = LoadCustomTexture(request.hashes[1], width, height);
+		if (image_data == nullptr)
+			image_data = LoadCustomTexture(request.hashes[2], width, height);
 	}
+	if (latest && texture->setAsyncImage(request.sequence, image_data, width, height, false))
+		image_data = nullptr;
+	free(image_data);
+	texture->custom_load_in_progress--;
 }
 
 std::string CustomTexture::GetGameId()
@@ -113,7 +120,11 @@ bool CustomTexture::Init()
 					{
 						NOTICE_LOG(RENDERER, "Found custom textures directory: %s", textures_path.c_str());
 						custom_textures_available = true;
-						loader_thread.Start();
+						map_loaded = false;
+						stbi_set_flip_vertically_on_load(1);
+						const u32 threadCount = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4u);
+						for (u32 i = 0; i < threadCount; i++)
+							loader_threads.emplace_back(&CustomTexture::LoaderThread, this);
 					}
 				} catch (const FlycastException& e) {
 				}
@@ -127,14 +138,25 @@ void CustomTexture::Terminate()
 {
 	if (initialized)
 	{
-		initialized = false;
 		{
 			std::unique_lock<std::mutex> lock(work_queue_mutex);
+			initialized = false;
+			for (const Request& request : work_queue)
+				request.texture->custom_load_in_progress--;
 			work_queue.clear();
 		}
-		wakeup_thread.Set();
-		loader_thread.WaitToEnd();
+		work_available.notify_all();
+		for (std::thread& thread : loader_threads)
+			thread.join();
+		loader_threads.clear();
 		texture_map.clear();
+		custom_textures_available = false;
+		if (pack_file != nullptr)
+		{
+			std::fclose(pack_file);
+			pack_file = nullptr;
+		}
+		pack_index.clear();
 	}
 }
 
@@ -144,13 +166,18 @@ u8* CustomTexture::LoadCustomTexture(u32 hash, int& width, int& height)
 	if (it == texture_map.end())
 		return nullptr;
 
-	FILE *file = hostfs::storage().openFile(it->second, "rb");
+	u8 *imgData = LoadFromPack(hash, it->second, width, height);
+	if (imgData != nullptr)
+		return imgData;
+
+	FILE *file = hostfs::storage().openFile(it->second.path, "rb");
 	if (file == nullptr)
 		return nullptr;
 	int n;
-	stbi_set_flip_vertically_on_load(1);
-	u8 *imgData = stbi_load_from_file(file, &width, &height, &n, STBI_rgb_alpha);
+	imgData = stbi_load_from_file(file, &width, &height, &n, STBI_rgb_alpha);
 	std::fclose(file);
+	if (imgData != nullptr)
+		AddToPack(hash, it->second, width, height, imgData);
 	return imgData;
 }
 
@@ -159,12 +186,38 @@ void CustomTexture::LoadCustomTextureAsync(BaseTextureCacheData *texture_data)
 	if (!Init())
 		return;
 
+	// Hash the texture now since vram may have changed by the time it's loaded
+	texture_data->ComputeHash();
 	texture_data->custom_load_in_progress++;
+	texture_data->custom_frame = FrameCount;
 	{
 		std::unique_lock<std::mutex> lock(work_queue_mutex);
-		work_queue.insert(work_queue.begin(), texture_data);
+		Request request{ texture_data,
+			{ texture_data->texture_hash, texture_data->old_vqtexture_hash, texture_data->old_texture_hash },
+			FrameCount, texture_data->newAsyncRequest() };
+		work_queue.push_back(request);
+		std::push_heap(work_queue.begin(), work_queue.end());
+	}
+	work_available.notify_one();
+}
+
+void CustomTexture::UpdateRequestFrame(BaseTextureCacheData *texture_data)
+{
+	if (texture_data->custom_frame == FrameCount)
+		return;
+	texture_data->custom_frame = FrameCount;
+	std::unique_lock<std::mutex> lock(work_queue_mutex);
+	const u32 sequence = texture_data->custom_request;
+	for (size_t i = 0; i < work_queue.size(); i++)
+	{
+		if (work_queue[i].texture == texture_data && work_queue[i].sequence == sequence)
+		{
+			// The frame can only increase so the request only needs to be sifted up
+			work_queue[i].frame = FrameCount;
+			std::push_heap(work_queue.begin(), work_queue.begin() + i + 1);
+			break;
+		}
 	}
-	wakeup_thread.Set();
 }
 
 void CustomTexture::DumpTexture(u32 hash, int w, int h, TextureType textype, void *src_buffer)
@@ -317,7 +370,108 @@ void CustomTexture::LoadMap()
 			INFO_LOG(RENDERER, "Invalid hash %s", basename.c_str());
 			continue;
 		}
-		texture_map[hash] = item.path;
+		texture_map[hash] = { item.path, item.size, item.updateTime };
 	}
 	custom_textures_available = !texture_map.empty();
 }
+
+// The texture pack holds the decoded images of the custom textures loaded so far so that
+// they can be loaded again without decoding them. Entries are appended as images are decoded.
+void CustomTexture::OpenPack()
+{
+	pack_index.clear();
+	pack_end = 0;
+	if (texture_map.empty() || config::CustomTexturePackSize <= 0)
+		return;
+	std::string path = hostfs::getTexturePackPath(GetGameId());
+	pack_file = nowide::fopen(path.c_str(), "r+b");
+	if (pack_file != nullptr)
+	{
+		u32 header[2];
+		if (std::fread(header, sizeof(header), 1, pack_file) != 1 || header[0] != PACK_MAGIC || header[1] != PACK_VERSION)
+		{
+			WARN_LOG(RENDERER, "Texture pack %s is invalid or outdated", path.c_str());
+			std::fclose(pack_file);
+			pack_file = nullptr;
+		}
+	}
+	if (pack_file == nullptr)
+	{
+		pack_file = nowide::fopen(path.c_str(), "w+b");
+		if (pack_file == nullptr)
+		{
+			WARN_LOG(RENDERER, "Can't create texture pack %s", path.c_str());
+			return;
+		}
+		const u32 header[] { PACK_MAGIC, PACK_VERSION };
+		std::fwrite(header, sizeof(header), 1, pack_file);
+		pack_end = sizeof(header);
+		return;
+	}
+	std::fseek(pack_file, 0, SEEK_END);
+	const u64 fileSize = std::ftell(pack_file);
+	pack_end = sizeof(u32) * 2;
+	std::fseek(pack_file, (long)pack_end, SEEK_SET);
+	PackEntry entry;
+	while (std::fread(&entry, sizeof(entry), 1, pack_file) == 1)
+	{
+		const u64 size = (u64)entry.width * entry.height * 4;
+		// Ignore a truncated last entry. It will be overwritten.
+		if (pack_end + sizeof(entry) + size > fileSize)
+			break;
+		// Later entries replace earlier ones
+		pack_index[entry.hash] = pack_end;
+		pack_end += sizeof(entry) + size;
+		std::fseek(pack_file, (long)pack_end, SEEK_SET);
+	}
+	INFO_LOG(RENDERER, "Texture pack %s: %d textures", path.c_str(), (int)pack_index.size());
+}
+
+u8 *CustomTexture::LoadFromPack(u32 hash, const SourceFile& source, int& width, int& height)
+{
+	std::lock_guard<std::mutex> _(pack_mutex);
+	auto it = pack_index.find(hash);
+	if (it == pack_index.end())
+		return nullptr;
+	PackEntry entry;
+	if (std::fseek(pack_file, (long)it->second, SEEK_SET) != 0
+			|| std::fread(&entry, sizeof(entry), 1, pack_file) != 1)
+		return nullptr;
+	// The image file has been replaced
+	if (entry.sourceSize != (u32)source.size || entry.sourceTime != source.updateTime)
+		return nullptr;
+	const size_t size = (size_t)entry.width * entry.height * 4;
+	u8 *data = (u8 *)malloc(size);
+	if (data == nullptr)
+		return nullptr;
+	if (std::fread(data, 1, size, pack_file) != size)
+	{
+		free(data);
+		return nullptr;
+	}
+	width = entry.width;
+	height = entry.height;
+	return data;
+}
+
+void CustomTexture::AddToPack(u32 hash, const SourceFile& source, int width, int height, const u8 *data)
+{
+	std::lock_guard<std::mutex> _(pack_mutex);
+	const size_t size = (size_t)width * height * 4;
+	const u64 maxSize = std::min<u64>((u64)std::max(0, (int)config::CustomTexturePackSize) * 1_MB, MAX_PACK_SIZE);
+	if (pack_file == nullptr || pack_end + sizeof(PackEntry) + size > maxSize)
+		return;
+	PackEntry entry{ hash, (u32)width, (u32)height, (u32)source.size, source.updateTime };
+	if (std::fseek(pack_file, (long)pack_end, SEEK_SET) != 0
+			|| std::fwrite(&entry, sizeof(entry), 1, pack_file) != 1
+			|| std::fwrite(data, 1, size, pack_file) != size)
+	{
+		WARN_LOG(RENDERER, "Texture pack write failed");
+		std::fclose(pack_file);
+		pack_file = nullptr;
+		pack_index.clear();
+		return;
+	}
+	pack_index[hash] = pack_end;
+	pack_end += sizeof(entry) + size;
+}
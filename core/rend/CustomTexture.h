@@ -21,36 +21,81 @@
 #include "TexCache.h"
 #include "stdclass.h"
 
+#include <condition_variable>
+#include <cstdio>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <map>
 #include <mutex>
 
 class CustomTexture {
 public:
-	CustomTexture() : loader_thread(loader_thread_func, this, "CustomTexLoader") {}
 	~CustomTexture() { Terminate(); }
 	u8* LoadCustomTexture(u32 hash, int& width, int& height);
 	void LoadCustomTextureAsync(BaseTextureCacheData *texture_data);
+	// Moves the pending request of a texture used by the current frame up the queue
+	void UpdateRequestFrame(BaseTextureCacheData *texture_data);
 	void DumpTexture(u32 hash, int w, int h, TextureType textype, void *src_buffer);
 	void Terminate();
 
 private:
+	struct Request
+	{
+		BaseTextureCacheData *texture;
+		u32 hashes[3];		// new, legacy vq and legacy hashes, in lookup order
+		u32 frame;
+		u32 sequence;
+
+		// Textures needed by the most recent frame first, then in request order
+		bool operator<(const Request& other) const {
+			if (frame != other.frame)
+				return frame < other.frame;
+			return sequence > other.sequence;
+		}
+	};
+	struct SourceFile
+	{
+		std::string path;
+		size_t size;
+		u64 updateTime;
+	};
+	// Pack entries are preceded by this header
+	struct PackEntry
+	{
+		u32 hash;
+		u32 width;
+		u32 height;
+		u32 sourceSize;		// size and time of the image file it was decoded from
+		u64 sourceTime;
+	};
+
 	bool Init();
 	void LoaderThread();
+	void LoadTexture(const Request& request);
 	std::string GetGameId();
 	void LoadMap();
-	
-	static void *loader_thread_func(void *param) { ((CustomTexture *)param)->LoaderThread(); return NULL; }
+	void OpenPack();
+	u8 *LoadFromPack(u32 hash, const SourceFile& source, int& width, int& height);
+	void AddToPack(u32 hash, const SourceFile& source, int width, int height, const u8 *data);
 	
 	bool initialized = false;
 	bool custom_textures_available = false;
+	bool map_loaded = false;
 	std::string textures_path;
-	cThread loader_thread;
-	cResetEvent wakeup_thread;
-	std::vector<BaseTextureCacheData *> work_queue;
+	std::mutex map_mutex;
+	std::vector<std::thread> loader_threads;
+	std::condition_variable work_available;
+	std::vector<Request> work_queue;	// heap
 	std::mutex work_queue_mutex;
-	std::map<u32, std::string> texture_map;
+	std::map<u32, SourceFile> texture_map;
+
+	// Decoded images of the game's custom textures
+	FILE *pack_file = nullptr;
+	std::unordered_map<u32, u64> pack_index;	// hash -> entry offset
+	u64 pack_end = 0;
+	std::mutex pack_mutex;
 };
 
 extern CustomTexture custom_texture;
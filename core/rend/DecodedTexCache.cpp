@@ -0,0 +1,248 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "DecodedTexCache.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include "emulator.h"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <nowide/cstdio.hpp>
+
+namespace texcache
+{
+
+constexpr u32 MAGIC = 0x43584554;	// TEXC
+constexpr u32 VERSION = 1;
+
+// 1024 x 1024 upscaled x8
+constexpr u32 MaxTextureSize = 8192;
+
+struct FileHeader
+{
+	u32 magic;
+	u32 version;
+	u32 entryCount;
+};
+
+struct EntryHeader
+{
+	u64 key;
+	u32 width;
+	u32 height;
+	u8 type;
+	u8 mipmaps;
+	u16 padding;
+	u32 size;
+};
+
+struct Stats
+{
+	u32 hits;
+	u32 misses;
+	u32 evictions;
+};
+
+using EntryPtr = std::shared_ptr<const Entry>;
+using LruList = std::list<std::pair<u64, EntryPtr>>;
+
+// Most recently used first
+static LruList lru;
+static std::unordered_map<u64, LruList::iterator> index;
+static size_t memoryUsed;
+static Stats stats;
+// Textures are decoded by the render thread but the cache is loaded and saved by the UI thread
+static std::mutex mutex;
+static bool diskCache;
+static std::string cachePath;
+
+static size_t budget() {
+	return (size_t)std::max(0, (int)config::DecodedTextureCacheSize) * 1_MB;
+}
+
+bool enabled() {
+	return config::DecodedTextureCacheSize > 0;
+}
+
+size_t dataSize(TextureType type, u32 width, u32 height, bool mipmaps)
+{
+	switch (type)
+	{
+	case TextureType::_8888:
+		return PixelBuffer<u32>::size(width, height, mipmaps);
+	case TextureType::_8:
+		return PixelBuffer<u8>::size(width, height, mipmaps);
+	default:
+		return PixelBuffer<u16>::size(width, height, mipmaps);
+	}
+}
+
+static void evict(size_t limit)
+{
+	while (memoryUsed > limit && !lru.empty())
+	{
+		memoryUsed -= lru.back().second->data.size();
+		index.erase(lru.back().first);
+		lru.pop_back();
+		stats.evictions++;
+	}
+}
+
+std::shared_ptr<const Entry> lookup(u64 key)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	auto it = index.find(key);
+	if (it == index.end())
+	{
+		stats.misses++;
+		return nullptr;
+	}
+	stats.hits++;
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->second;
+}
+
+void add(u64 key, std::shared_ptr<const Entry> entry)
+{
+	const size_t size = entry->data.size();
+	std::lock_guard<std::mutex> _(mutex);
+	// Don't let a single texture flush most of the cache
+	if (size > budget() / 4 || index.count(key) != 0)
+		return;
+	lru.emplace_front(key, std::move(entry));
+	index[key] = lru.begin();
+	memoryUsed += size;
+	evict(budget());
+}
+
+static void clear()
+{
+	if (stats.hits != 0 || stats.misses != 0)
+		INFO_LOG(RENDERER, "Decoded texture cache: %d hits, %d misses, %d evictions", stats.hits, stats.misses, stats.evictions);
+	lru.clear();
+	index.clear();
+	memoryUsed = 0;
+	stats = {};
+}
+
+static void load()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	clear();
+	diskCache = config::DecodedTextureDiskCache && enabled() && !settings.content.gameId.empty();
+	if (!diskCache)
+		return;
+	cachePath = hostfs::getTextureCachePath(settings.content.gameId);
+	FILE *f = nowide::fopen(cachePath.c_str(), "rb");
+	if (f == nullptr)
+		return;
+	FileHeader header;
+	if (std::fread(&header, sizeof(header), 1, f) != 1 || header.magic != MAGIC || header.version != VERSION)
+	{
+		WARN_LOG(RENDERER, "Texture cache %s is invalid or outdated", cachePath.c_str());
+		std::fclose(f);
+		return;
+	}
+	const size_t limit = budget();
+	for (u32 i = 0; i < header.entryCount; i++)
+	{
+		EntryHeader entryHeader;
+		if (std::fread(&entryHeader, sizeof(entryHeader), 1, f) != 1
+				|| entryHeader.type > (u8)TextureType::_8
+				|| entryHeader.width == 0 || entryHeader.width > MaxTextureSize
+				|| entryHeader.height == 0 || entryHeader.height > MaxTextureSize
+				|| entryHeader.mipmaps > 1
+				|| entryHeader.size != dataSize((TextureType)entryHeader.type, entryHeader.width, entryHeader.height, entryHeader.mipmaps)
+				|| memoryUsed + entryHeader.size > limit)
+			break;
+		auto entry = std::make_shared<Entry>();
+		entry->type = (TextureType)entryHeader.type;
+		entry->width = entryHeader.width;
+		entry->height = entryHeader.height;
+		entry->mipmaps = entryHeader.mipmaps;
+		entry->data.resize(entryHeader.size);
+		if (std::fread(entry->data.data(), 1, entry->data.size(), f) != entry->data.size())
+			break;
+		// Entries are saved most recently used first
+		lru.emplace_back(entryHeader.key, std::move(entry));
+		index[entryHeader.key] = std::prev(lru.end());
+		memoryUsed += entryHeader.size;
+	}
+	std::fclose(f);
+	INFO_LOG(RENDERER, "Texture cache loaded from %s: %d textures, %d KB", cachePath.c_str(), (int)lru.size(), (int)(memoryUsed / 1024));
+}
+
+static void save()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	if (diskCache && !lru.empty())
+	{
+		FILE *f = nowide::fopen(cachePath.c_str(), "wb");
+		if (f == nullptr)
+		{
+			WARN_LOG(RENDERER, "Can't save texture cache to %s", cachePath.c_str());
+		}
+		else
+		{
+			FileHeader header{ MAGIC, VERSION, (u32)lru.size() };
+			std::fwrite(&header, sizeof(header), 1, f);
+			for (const auto& [key, entry] : lru)
+			{
+				EntryHeader entryHeader{ key, entry->width, entry->height, (u8)entry->type, entry->mipmaps, 0, (u32)entry->data.size() };
+				std::fwrite(&entryHeader, sizeof(entryHeader), 1, f);
+				std::fwrite(entry->data.data(), 1, entry->data.size(), f);
+			}
+			std::fclose(f);
+			INFO_LOG(RENDERER, "Texture cache saved to %s: %d textures", cachePath.c_str(), (int)lru.size());
+		}
+	}
+	diskCache = false;
+	clear();
+}
+
+static void eventCallback(Event event, void *)
+{
+	switch (event)
+	{
+	case Event::Start:
+		load();
+		break;
+	case Event::Terminate:
+		save();
+		break;
+	default:
+		break;
+	}
+}
+
+void init()
+{
+	EventManager::listen(Event::Start, eventCallback);
+	EventManager::listen(Event::Terminate, eventCallback);
+}
+
+void term()
+{
+	EventManager::unlisten(Event::Start, eventCallback);
+	EventManager::unlisten(Event::Terminate, eventCallback);
+	save();
+}
+
+}
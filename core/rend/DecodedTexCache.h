@@ -0,0 +1,55 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// Second-level cache of decoded textures.
+//
+// Decoded pixel buffers are indexed by a hash of the texture data, palette and decoding parameters,
+// so that textures loaded again with the same contents, at the same or another vram address,
+// can be uploaded without being decoded. The least recently used textures are evicted when
+// the memory budget is exceeded.
+// Optionally the cache is saved when the game is unloaded and loaded back on the next launch.
+#pragma once
+#include "TexCache.h"
+#include <memory>
+#include <vector>
+
+namespace texcache
+{
+
+struct Entry
+{
+	TextureType type;
+	u32 width;
+	u32 height;
+	bool mipmaps;
+	std::vector<u8> data;
+};
+
+// Size in bytes of the decoded data of a texture
+size_t dataSize(TextureType type, u32 width, u32 height, bool mipmaps);
+
+void init();
+void term();
+
+// True if decoded textures should be looked up and added
+bool enabled();
+// Returns the decoded texture with the given key, or nullptr if not found
+std::shared_ptr<const Entry> lookup(u64 key);
+void add(u64 key, std::shared_ptr<const Entry> entry);
+
+}
@@ -1,17 +1,15 @@
 #include "TexCache.h"
 #include "CustomTexture.h"
+#include "DecodedTexCache.h"
 #include "deps/xbrz/xbrz.h"
 #include "hw/pvr/pvr_mem.h"
 #include "hw/mem/addrspace.h"
+#include "stdclass.h"
 
 #include <algorithm>
-#include <mutex>
+#include <chrono>
 #include <xxhash.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 const u8 *vq_codebook;
 u32 palette_index;
 bool KillTex=false;
@@ -164,7 +162,30 @@ void palette_update()
 		pal_hash_256[i] = XXH32(&PALETTE_RAM[i << 8], 256 * 4, 7);
 }
 
-static std::vector<vram_block*> VramLocks[VRAM_SIZE_MAX / PAGE_SIZE];
+/*
+	Vram write tracking
+
+	Pages containing textures are write-protected. When a protected page is written by the emulator,
+	the fault handler records the written range, unprotects the page and bumps the page epoch.
+	It never blocks and never touches the texture cache.
+	The render thread owns the page lists and the page protection state. It processes the recorded writes
+	before looking up textures: the textures overlapping the written range are invalidated and the other ones
+	in the page are checked against their hash when next used.
+*/
+constexpr u32 VRAM_PAGES = VRAM_SIZE_MAX / PAGE_SIZE;
+
+// Render thread only
+static std::vector<vram_block*> VramLocks[VRAM_PAGES];
+static bool pageProtected[VRAM_PAGES];
+static u32 pageEpochSeen[VRAM_PAGES];
+
+// Written by the fault handler
+static std::atomic<u32> pageEpoch[VRAM_PAGES];
+// Written range in the page: first offset in the upper 16 bits, last offset + 1 in the lower 16 bits
+static std::atomic<u32> pageWrites[VRAM_PAGES];
+static std::atomic<bool> vramWritesPending;
+
+static_assert(PAGE_SIZE <= 0x8000, "Page size too large");
 
 //List functions
 //
@@ -192,9 +213,12 @@ static void vramlock_list_add(vram_block* block)
 	for (u32 i = base; i <= end; i++)
 	{
 		std::vector<vram_block*>& list = VramLocks[i];
-		// If the list is empty then we need to protect vram, otherwise it's already been done
-		if (list.empty() || std::all_of(list.begin(), list.end(), [](vram_block *block) { return block == nullptr; }))
+		// Protect the page if a write unprotected it or if it has no texture left
+		if (!pageProtected[i] || std::all_of(list.begin(), list.end(), [](vram_block *block) { return block == nullptr; }))
+		{
+			pageProtected[i] = true;
 			addrspace::protectVram(i * PAGE_SIZE, PAGE_SIZE);
+		}
 		auto it = std::find(list.begin(), list.end(), nullptr);
 		if (it != list.end())
 			*it = block;
@@ -202,25 +226,68 @@ static void vramlock_list_add(vram_block* block)
 			list.push_back(block);
 	}
 }
- 
-static std::mutex vramlist_lock;
 
-bool VramLockedWriteOffset(size_t offset)
+bool VramLockedWriteOffset(size_t offset, size_t length)
 {
 	if (offset >= VRAM_SIZE)
 		return false;
 
-	size_t addr_hash = offset / PAGE_SIZE;
-	std::vector<vram_block *>& list = VramLocks[addr_hash];
+	const u32 page = offset / PAGE_SIZE;
+	const u32 first = offset & PAGE_MASK;
+	const u32 last = std::min<u32>(first + length, PAGE_SIZE);
+	u32 range = pageWrites[page].load(std::memory_order_relaxed);
+	u32 newRange;
+	do {
+		if (range == 0)
+			newRange = (first << 16) | last;
+		else
+			newRange = (std::min(range >> 16, first) << 16) | std::max(range & 0xffff, last);
+	} while (!pageWrites[page].compare_exchange_weak(range, newRange, std::memory_order_relaxed));
 
-	{
-		std::lock_guard<std::mutex> lockguard(vramlist_lock);
+	addrspace::unprotectVram((u32)(offset & ~PAGE_MASK), PAGE_SIZE);
+	// The epoch must change after the page is unprotected so that the render thread
+	// doesn't miss the unprotection if it was protecting the page concurrently
+	pageEpoch[page].fetch_add(1, std::memory_order_release);
+	vramWritesPending.store(true, std::memory_order_release);
 
-		for (auto& lock : list)
+	return true;
+}
+
+bool VramLockedWrite(u8* address)
+{
+	u32 offset = addrspace::getVramOffset(address);
+	if (offset == (u32)-1)
+		return false;
+	return VramLockedWriteOffset(offset);
+}
+
+void processVramWrites()
+{
+	if (!vramWritesPending.exchange(false, std::memory_order_acquire))
+		return;
+	const u32 pages = VRAM_SIZE / PAGE_SIZE;
+	for (u32 page = 0; page < pages; page++)
+	{
+		const u32 epoch = pageEpoch[page].load(std::memory_order_acquire);
+		if (epoch == pageEpochSeen[page])
+			continue;
+		pageEpochSeen[page] = epoch;
+		// The page is now unprotected
+		pageProtected[page] = false;
+		const u32 range = pageWrites[page].exchange(0, std::memory_order_relaxed);
+		const u32 start = page * PAGE_SIZE + (range >> 16);
+		const u32 end = page * PAGE_SIZE + (range & 0xffff);	// exclusive
+
+		for (auto& lock : VramLocks[page])
 		{
 			if (lock != nullptr)
 			{
-				lock->texture->invalidate();
+				// Textures sharing the page but not overlapping the written range are checked
+				// when next used instead of being decoded again.
+				if (end > lock->start && start <= lock->end)
+					lock->texture->invalidate();
+				else
+					lock->texture->verifyLater();
 
 				if (lock != nullptr)
 				{
@@ -229,20 +296,8 @@ bool VramLockedWriteOffset(size_t offset)
 				}
 			}
 		}
-		list.clear();
-
-		addrspace::unprotectVram((u32)(offset & ~PAGE_MASK), PAGE_SIZE);
+		VramLocks[page].clear();
 	}
-
-	return true;
-}
-
-bool VramLockedWrite(u8* address)
-{
-	u32 offset = addrspace::getVramOffset(address);
-	if (offset == (u32)-1)
-		return false;
-	return VramLockedWriteOffset(offset);
 }
 
 //unlocks mem
@@ -253,43 +308,57 @@ static void libCore_vramlock_Unlock_block_wb(vram_block* block)
 	delete block;
 }
 
-#ifdef _OPENMP
-static inline int getThreadCount()
+static struct xbrz::ScalerCfg xbrz_cfg;
+static WorkerPool upscaleQueue("xBRZ", 0);
+// Number of source rows upscaled by each job
+constexpr int UpscaleSliceHeight = 16;
+
+static u32 getUpscaleThreadCount()
 {
-	int tcount = omp_get_num_procs() - 1;
+	int tcount = (int)std::thread::hardware_concurrency() - 1;
 	if (tcount < 1)
 		tcount = 1;
 	return std::min(tcount, (int)config::MaxThreads);
 }
 
-template<typename Func>
-void parallelize(Func func, int start, int end)
+// Splits the texture into slices of rows upscaled by the job queue.
+// onDone is called by the job completing the last slice.
+static void queueUpscale(int factor, const u32 *source, u32 *dest, int width, int height, bool has_alpha, bool urgent,
+		std::function<void()>&& onDone)
 {
-	int tcount = getThreadCount();
-#pragma omp parallel num_threads(tcount)
+	const int slices = std::max(1, height / UpscaleSliceHeight);
+	auto remaining = std::make_shared<std::atomic<int>>(slices);
+	auto done = std::make_shared<std::function<void()>>(std::move(onDone));
+	const u32 threadCount = getUpscaleThreadCount();
+	for (int i = 0; i < slices; i++)
 	{
-		int num_threads = omp_get_num_threads();
-		int thread = omp_get_thread_num();
-		int chunk = (end - start) / num_threads;
-		func(start + chunk * thread,
-				num_threads == thread + 1 ? end
-						: (start + chunk * (thread + 1)));
+		const int start = height * i / slices;
+		const int end = height * (i + 1) / slices;
+		upscaleQueue.push([=]() {
+			xbrz::scale(factor, source, dest, width, height, has_alpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB,
+					xbrz_cfg, start, end);
+			if (--*remaining == 0)
+				(*done)();
+		}, threadCount, urgent);
 	}
 }
-#endif
-
-static struct xbrz::ScalerCfg xbrz_cfg;
 
 void UpscalexBRZ(int factor, u32* source, u32* dest, int width, int height, bool has_alpha)
 {
-#ifdef _OPENMP
-	parallelize([=](int start, int end) {
-		xbrz::scale(factor, source, dest, width, height, has_alpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB,
-				xbrz_cfg, start, end);
-	}, 0, height);
-#else
-	xbrz::scale(factor, source, dest, width, height, has_alpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB, xbrz_cfg);
-#endif
+	if (height < UpscaleSliceHeight * 2)
+	{
+		// Not worth splitting
+		xbrz::scale(factor, source, dest, width, height, has_alpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB, xbrz_cfg);
+		return;
+	}
+	std::atomic<bool> done{ false };
+	// Help with the slices of this texture instead of waiting
+	queueUpscale(factor, source, dest, width, height, has_alpha, true, [&done]() { done = true; });
+	upscaleQueue.runUntil([&done]() { return done.load(); });
+}
+
+void waitForUpscaling() {
+	upscaleQueue.wait();
 }
 
 struct PvrTexInfo
@@ -388,8 +457,62 @@ void BaseTextureCacheData::PrintTextureName()
 #endif
 }
 
+static TextureStats frameStats;
+static TextureStats lastFrameStats;
+static u32 statsFrame;
+static TextureStats periodStats;
+static u32 periodMaxDecoded;
+
+static void updateStats()
+{
+	if (statsFrame == FrameCount)
+		return;
+	lastFrameStats = frameStats;
+	periodStats.decoded += frameStats.decoded;
+	periodStats.verified += frameStats.verified;
+	periodMaxDecoded = std::max(periodMaxDecoded, frameStats.decoded);
+	frameStats = {};
+	statsFrame = FrameCount;
+	if (FrameCount % 60 == 0)
+	{
+		DEBUG_LOG(RENDERER, "Textures per frame: %.1f decoded (max %d), %.1f verified",
+				periodStats.decoded / 60.f, periodMaxDecoded, periodStats.verified / 60.f);
+		periodStats = {};
+		periodMaxDecoded = 0;
+	}
+}
+
+TextureStats getTextureStats() {
+	return lastFrameStats;
+}
+
+u64 BaseTextureCacheData::hashVRam()
+{
+	if (startAddress >= VRAM_SIZE)
+		return 0;
+	const u32 end = std::min<u32>(mmStartAddress + size, VRAM_SIZE);
+	return XXH64(&vram[startAddress], end - startAddress, 7);
+}
+
 //true if : dirty or paletted texture and hashes don't match
-bool BaseTextureCacheData::NeedsUpdate() {
+bool BaseTextureCacheData::NeedsUpdate()
+{
+	updateStats();
+	if (unprotected != 0 && dirty == 0)
+	{
+		// Protect the texture again first so that no write is missed
+		unprotected = 0;
+		protectVRam();
+		if (hashVRam() == vramHash)
+		{
+			frameStats.verified++;
+		}
+		else
+		{
+			dirty = FrameCount;
+			unprotectVRam();
+		}
+	}
 	bool rc = dirty != 0;
 	if (tex_type != TextureType::_8)
 	{
@@ -417,28 +540,21 @@ void BaseTextureCacheData::protectVRam()
 		return;
 	}
 
-	vram_block *block = new vram_block();
-	block->end = end;
-	block->start = startAddress;
-	block->texture = this;
-
+	if (lock_block == nullptr)
 	{
-		std::lock_guard<std::mutex> lock(vramlist_lock);
-
-		if (lock_block == nullptr)
-		{
-			// This also protects vram if needed
-			vramlock_list_add(block);
-			lock_block = block;
-		}
-		else
-			delete block;
+		vram_block *block = new vram_block();
+		block->end = end;
+		block->start = startAddress;
+		block->texture = this;
+		// This also protects vram if needed
+		vramlock_list_add(block);
+		lock_block = block;
 	}
 }
 
 void BaseTextureCacheData::unprotectVRam()
 {
-	std::lock_guard<std::mutex> lock(vramlist_lock);
+	unprotected = 0;
 	if (lock_block)
 		libCore_vramlock_Unlock_block_wb(lock_block);
 	lock_block = nullptr;
@@ -468,9 +584,14 @@ BaseTextureCacheData::BaseTextureCacheData(TSP tsp, TCW tcw)
 	//Reset state info ..
 	Updates = 0;
 	dirty = FrameCount;
+	unprotected = 0;
+	vramHash = 0;
 	lock_block = nullptr;
 	custom_image_data = nullptr;
+	custom_upscaled = false;
 	custom_load_in_progress = 0;
+	custom_request = 0;
+	custom_frame = 0;
 	gpuPalette = false;
 
 	//decode info from tsp/tcw into the texture struct
@@ -587,11 +708,95 @@ void BaseTextureCacheData::ComputeHash()
 	}
 }
 
+// Unlike ComputeHash(), the key covers all mipmap levels, the vq codebook, the palette colors
+// and all the parameters affecting the decoded texture, so that it can be reused as is.
+u64 BaseTextureCacheData::ComputeDecodedKey(u32 stride, u32 heightLimit, bool textureUpscaling, bool need_32bit_buffer, bool mipmapped)
+{
+	struct {
+		u32 tcw;
+		u32 width;
+		u32 height;
+		u32 stride;
+		u32 heightLimit;
+		u32 upscale;
+		u8 texType;
+		u8 need32bit;
+		u8 mipmapped;
+		u8 gpuPalette;
+		u8 directXOrder;
+		u8 padding[3];
+	} params{};
+	// Everything but the texture address and palette selection
+	params.tcw = tcw.full & 0xFC000000;
+	params.width = width;
+	params.height = height;
+	params.stride = stride;
+	params.heightLimit = heightLimit;
+	params.upscale = textureUpscaling ? (int)config::TextureUpscale : 1;
+	params.texType = (u8)tex_type;
+	params.need32bit = need_32bit_buffer;
+	params.mipmapped = mipmapped;
+	params.gpuPalette = gpuPalette;
+	params.directXOrder = pvrTexInfo == directx::pvrTexInfo;
+
+	XXH64_state_t *state = XXH64_createState();
+	XXH64_reset(state, 7);
+	XXH64_update(state, &params, sizeof(params));
+	// vq codebook and mipmaps are stored before mmStartAddress
+	XXH64_update(state, &vram[startAddress], mmStartAddress + size - startAddress);
+	if (IsPaletted() && !gpuPalette)
+	{
+		const u32 colors = tcw.PixelFmt == PixelPal4 ? 16 : 256;
+		XXH64_update(state, &palette16_ram[palette_index], colors * sizeof(u32));
+		XXH64_update(state, &palette32_ram[palette_index], colors * sizeof(u32));
+	}
+	u64 key = XXH64_digest(state);
+	XXH64_freeState(state);
+
+	return key;
+}
+
+// Textures are upscaled right away until this time has been spent upscaling during the current frame.
+// The following ones are first shown unscaled and replaced when the background upscaling completes.
+constexpr int64_t UpscaleFrameBudget = 2000;	// us
+static u32 upscaleFrame;
+static int64_t upscaleFrameTime;
+
+static void upscaleAsync(BaseTextureCacheData *texture, const u32 *data, int width, int height, bool has_alpha, u64 decodedKey)
+{
+	const int factor = config::TextureUpscale;
+	const u32 request = texture->newAsyncRequest();
+	texture->custom_load_in_progress++;
+	// The pixel buffer is freed once the unscaled texture is uploaded
+	u32 *source = (u32 *)malloc(width * height * sizeof(u32));
+	memcpy(source, data, width * height * sizeof(u32));
+	u32 *dest = (u32 *)malloc(width * factor * height * factor * sizeof(u32));
+	queueUpscale(factor, source, dest, width, height, has_alpha, false, [=]() {
+		free(source);
+		const int upscaledWidth = width * factor;
+		const int upscaledHeight = height * factor;
+		if (decodedKey != 0)
+		{
+			auto entry = std::make_shared<texcache::Entry>();
+			entry->type = TextureType::_8888;
+			entry->width = upscaledWidth;
+			entry->height = upscaledHeight;
+			entry->mipmaps = false;
+			entry->data.assign((const u8 *)dest, (const u8 *)(dest + upscaledWidth * upscaledHeight));
+			texcache::add(decodedKey, std::move(entry));
+		}
+		if (!texture->setAsyncImage(request, (u8 *)dest, upscaledWidth, upscaledHeight, true))
+			free(dest);
+		texture->custom_load_in_progress--;
+	});
+}
+
 bool BaseTextureCacheData::Update()
 {
 	//texture state tracking stuff
 	Updates++;
 	dirty = 0;
+	unprotected = 0;
 	gpuPalette = false;
 	tex_type = tex->type;
 
@@ -658,8 +863,18 @@ bool BaseTextureCacheData::Update()
 			return false;
 		}
 	}
+	// Lock the texture to detect changes in it, then hash the data before decoding it
+	// so that no write is missed
+	protectVRam();
+	vramHash = hashVRam();
+	updateStats();
+	frameStats.decoded++;
+
 	if (config::CustomTextures)
 		custom_texture.LoadCustomTextureAsync(this);
+	else if (custom_request != 0)
+		// Discard the result of a pending upscaling
+		setAsyncImage(newAsyncRequest(), nullptr, 0, 0, false);
 
 	void *temp_tex_buffer = NULL;
 	u32 upscaled_w = width;
@@ -685,7 +900,25 @@ bool BaseTextureCacheData::Update()
 
 	bool mipmapped = IsMipmapped() && !config::DumpTextures;
 
-	if (texconv32 != NULL && need_32bit_buffer)
+	const bool useDecodedCache = texcache::enabled();
+	bool upscalingLater = false;
+	u64 decodedKey = 0;
+	std::shared_ptr<const texcache::Entry> decoded;
+	if (useDecodedCache)
+	{
+		decodedKey = ComputeDecodedKey(stride, heightLimit, textureUpscaling, need_32bit_buffer, mipmapped);
+		decoded = texcache::lookup(decodedKey);
+	}
+
+	if (decoded != nullptr)
+	{
+		tex_type = decoded->type;
+		upscaled_w = decoded->width;
+		upscaled_h = decoded->height;
+		mipmapped = decoded->mipmaps;
+		temp_tex_buffer = (void *)decoded->data.data();
+	}
+	else if (texconv32 != NULL && need_32bit_buffer)
 	{
 		if (textureUpscaling)
 			// don't use mipmaps if upscaling
@@ -730,16 +963,31 @@ bool BaseTextureCacheData::Update()
 			// xBRZ scaling
 			if (textureUpscaling)
 			{
-				PixelBuffer<u32> tmp_buf;
-				tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
-
 				if (tcw.PixelFmt == Pixel1555 || tcw.PixelFmt == Pixel4444)
 					// Alpha channel formats. Palettes with alpha are already handled
 					has_alpha = true;
-				UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
-				pb32.steal_data(tmp_buf);
-				upscaled_w *= config::TextureUpscale;
-				upscaled_h *= config::TextureUpscale;
+				if (upscaleFrame != FrameCount)
+				{
+					upscaleFrame = FrameCount;
+					upscaleFrameTime = 0;
+				}
+				// The upscaled image is passed as a custom image, which custom textures would override
+				if (upscaleFrameTime < UpscaleFrameBudget || config::CustomTextures)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					PixelBuffer<u32> tmp_buf;
+					tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
+					UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
+					pb32.steal_data(tmp_buf);
+					upscaled_w *= config::TextureUpscale;
+					upscaled_h *= config::TextureUpscale;
+					upscaleFrameTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+				}
+				else
+				{
+					upscaleAsync(this, pb32.data(), width, height, has_alpha, decodedKey);
+					upscalingLater = true;
+				}
 			}
 		}
 		temp_tex_buffer = pb32.data();
@@ -808,9 +1056,18 @@ bool BaseTextureCacheData::Update()
 		temp_tex_buffer = pb16.data();
 		mipmapped = false;
 	}
-	//lock the texture to detect changes in it
-	protectVRam();
-
+	// The upscaled texture is added once ready
+	if (useDecodedCache && decoded == nullptr && !upscalingLater)
+	{
+		const size_t bufferSize = texcache::dataSize(tex_type, upscaled_w, upscaled_h, mipmapped);
+		auto entry = std::make_shared<texcache::Entry>();
+		entry->type = tex_type;
+		entry->width = upscaled_w;
+		entry->height = upscaled_h;
+		entry->mipmaps = mipmapped;
+		entry->data.assign((const u8 *)temp_tex_buffer, (const u8 *)temp_tex_buffer + bufferSize);
+		texcache::add(decodedKey, std::move(entry));
+	}
 	UploadToGPU(upscaled_w, upscaled_h, (const u8 *)temp_tex_buffer, IsMipmapped(), mipmapped);
 	if (config::DumpTextures)
 	{
@@ -837,6 +1094,30 @@ void BaseTextureCacheData::CheckCustomTexture()
 	}
 }
 
+static std::atomic<u32> lastAsyncRequest;
+static std::mutex asyncImageMutex;
+
+u32 BaseTextureCacheData::newAsyncRequest()
+{
+	const u32 request = ++lastAsyncRequest;
+	custom_request = request;
+	return request;
+}
+
+bool BaseTextureCacheData::setAsyncImage(u32 request, u8 *data, int width, int height, bool upscaled)
+{
+	// Serialize with other workers completing a request for the same texture
+	std::lock_guard<std::mutex> _(asyncImageMutex);
+	if (request != custom_request)
+		return false;
+	free(custom_image_data);
+	custom_image_data = data;
+	custom_width = width;
+	custom_height = height;
+	custom_upscaled = upscaled;
+	return true;
+}
+
 void BaseTextureCacheData::SetDirectXColorOrder(bool enabled) {
 	pvrTexInfo = enabled ? directx::pvrTexInfo : opengl::pvrTexInfo;
 	pal_needs_update = true;
@@ -1359,6 +1640,16 @@ template void WriteFramebuffer<2, 1, 0, 3>(u32 width, u32 height, const u8 *data
 void BaseTextureCacheData::invalidate()
 {
 	dirty = FrameCount;
+	unprotected = 0;
+
+	libCore_vramlock_Unlock_block_wb(lock_block);
+	lock_block = nullptr;
+}
+
+// The vram lock is removed but the texture data is compared with its hash when next used
+void BaseTextureCacheData::verifyLater()
+{
+	unprotected = FrameCount;
 
 	libCore_vramlock_Unlock_block_wb(lock_block);
 	lock_block = nullptr;
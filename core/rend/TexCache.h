@@ -2,6 +2,7 @@
 #include "oslib/oslib.h"
 #include "hw/pvr/Renderer_if.h"
 #include "cfg/option.h"
+#include "TexConvSimd.h"
 
 #include <algorithm>
 #include <array>
@@ -42,9 +43,9 @@ public:
 		deinit();
 	}
 
-	void init(u32 width, u32 height, bool mipmapped)
+	// Size in bytes of a buffer, including all mipmap levels if mipmapped
+	static size_t size(u32 width, u32 height, bool mipmapped)
 	{
-		deinit();
 		size_t size = width * height * sizeof(pixel_type);
 		if (mipmapped)
 		{
@@ -56,7 +57,13 @@ public:
 			}
 			while (width != 0 && height != 0);
 		}
-		p_buffer_start = p_current_line = p_current_pixel = p_current_mipmap = (pixel_type *)malloc(size);
+		return size;
+	}
+
+	void init(u32 width, u32 height, bool mipmapped)
+	{
+		deinit();
+		p_buffer_start = p_current_line = p_current_pixel = p_current_mipmap = (pixel_type *)malloc(size(width, height, mipmapped));
 		this->pixels_per_line = 1;
 	}
 
@@ -228,6 +235,102 @@ struct Unpacker8888 {
 	}
 };
 
+#ifdef TEXCONV_SIMD
+// Vector versions of the 16-bit unpackers
+template<typename Unpacker>
+struct SimdUnpacker;
+
+template<>
+struct SimdUnpacker<UnpackerNop<u16>> {
+	static simd::u16x8 unpack(simd::u16x8 words) {
+		return words;
+	}
+};
+
+template<>
+struct SimdUnpacker<Unpacker1555> {
+	static simd::u16x8 unpack(simd::u16x8 words) {
+		return simd::or16(simd::sll16<1>(words), simd::srl16<15>(words));
+	}
+};
+
+template<>
+struct SimdUnpacker<Unpacker4444> {
+	static simd::u16x8 unpack(simd::u16x8 words) {
+		return simd::or16(simd::sll16<4>(words), simd::srl16<12>(words));
+	}
+};
+
+template<typename Packer>
+inline static simd::u32x4 simdPack(simd::u32x4 r, simd::u32x4 g, simd::u32x4 b, simd::u32x4 a)
+{
+	if constexpr (std::is_same_v<Packer, BGRAPacker>)
+		std::swap(r, b);
+	return simd::or32(simd::or32(r, simd::sll32<8>(g)), simd::or32(simd::sll32<16>(b), simd::sll32<24>(a)));
+}
+
+template <typename Packer>
+struct SimdUnpacker<Unpacker1555_32<Packer>> {
+	static simd::u32x4 unpack(simd::u32x4 words)
+	{
+		simd::u32x4 a = simd::srl32<15>(words);
+		return simdPack<Packer>(
+				simd::expand8<5>(simd::and32(simd::srl32<10>(words), 0x1F)),
+				simd::expand8<5>(simd::and32(simd::srl32<5>(words), 0x1F)),
+				simd::expand8<5>(simd::and32(words, 0x1F)),
+				simd::sub32(simd::sll32<8>(a), a));
+	}
+};
+
+template <typename Packer>
+struct SimdUnpacker<Unpacker565_32<Packer>> {
+	static simd::u32x4 unpack(simd::u32x4 words)
+	{
+		return simdPack<Packer>(
+				simd::expand8<5>(simd::srl32<11>(words)),
+				simd::expand8<6>(simd::and32(simd::srl32<5>(words), 0x3F)),
+				simd::expand8<5>(simd::and32(words, 0x1F)),
+				simd::set32(0xFF));
+	}
+};
+
+template <typename Packer>
+struct SimdUnpacker<Unpacker4444_32<Packer>> {
+	static simd::u32x4 unpack(simd::u32x4 words)
+	{
+		return simdPack<Packer>(
+				simd::expand8<4>(simd::and32(simd::srl32<8>(words), 0xF)),
+				simd::expand8<4>(simd::and32(simd::srl32<4>(words), 0xF)),
+				simd::expand8<4>(simd::and32(words, 0xF)),
+				simd::expand8<4>(simd::srl32<12>(words)));
+	}
+};
+#endif
+
+// Converts a line of 16-bit pixels. count must be a multiple of 8.
+template<typename Unpacker>
+inline static void unpackLine(const u16 *in, typename Unpacker::unpacked_type *out, u32 count)
+{
+#ifdef TEXCONV_SIMD
+	for (u32 i = 0; i < count; i += 8)
+	{
+		simd::u16x8 words = simd::load16(&in[i]);
+		if constexpr (sizeof(typename Unpacker::unpacked_type) == 2)
+		{
+			simd::store16(&out[i], SimdUnpacker<Unpacker>::unpack(words));
+		}
+		else
+		{
+			simd::store32(&out[i], SimdUnpacker<Unpacker>::unpack(simd::widenLo(words)));
+			simd::store32(&out[i + 4], SimdUnpacker<Unpacker>::unpack(simd::widenHi(words)));
+		}
+	}
+#else
+	for (u32 i = 0; i < count; i++)
+		out[i] = Unpacker::unpack(in[i]);
+#endif
+}
+
 template<typename Unpacker>
 struct ConvertPlanar
 {
@@ -465,12 +568,111 @@ void texture_VQ(PixelBuffer<typename PixelConvertor::unpacked_type>* pb, const u
 	}
 }
 
+// Twiddled pixels of a 4x4 tile, in row order
+constexpr u8 TwiddledTileOrder[16] = {
+		0, 2, 8, 10,
+		1, 3, 9, 11,
+		4, 6, 12, 14,
+		5, 7, 13, 15
+};
+
+// Planar textures with 16-bit pixels, converted a line at a time
+template<typename Unpacker>
+void texture_PL_lines(PixelBuffer<typename Unpacker::unpacked_type>* pb, const u8* p_in, u32 Width, u32 Height)
+{
+	const u16 *in = (const u16 *)p_in;
+	for (u32 y = 0; y < Height; y++)
+	{
+		unpackLine<Unpacker>(in, pb->data(0, y), Width);
+		in += Width;
+	}
+}
+
+// Twiddled textures with 16-bit pixels.
+// When both dimensions are at least 4, each 4x4 tile is stored contiguously and is converted at once.
+template<typename Unpacker>
+void texture_TW_tiled(PixelBuffer<typename Unpacker::unpacked_type>* pb, const u8* p_in, u32 Width, u32 Height)
+{
+	if (Width < 4 || Height < 4)
+	{
+		texture_TW<ConvertTwiddle<Unpacker>>(pb, p_in, Width, Height);
+		return;
+	}
+	const u32 bcx = bitscanrev(Width);
+	const u32 bcy = bitscanrev(Height);
+
+	for (u32 y = 0; y < Height; y += 4)
+	{
+		for (u32 x = 0; x < Width; x += 4)
+		{
+			const u16 *tile = (const u16 *)p_in + twop(x, y, bcx, bcy);
+#ifdef TEXCONV_SIMD
+			simd::u16x8 rows02, rows13;
+			simd::deinterleave(simd::load16(tile), simd::load16(tile + 8), rows02, rows13);
+			if constexpr (sizeof(typename Unpacker::unpacked_type) == 2)
+			{
+				rows02 = SimdUnpacker<Unpacker>::unpack(rows02);
+				rows13 = SimdUnpacker<Unpacker>::unpack(rows13);
+				simd::storeLo16(pb->data(x, y), rows02);
+				simd::storeLo16(pb->data(x, y + 1), rows13);
+				simd::storeHi16(pb->data(x, y + 2), rows02);
+				simd::storeHi16(pb->data(x, y + 3), rows13);
+			}
+			else
+			{
+				simd::store32(pb->data(x, y), SimdUnpacker<Unpacker>::unpack(simd::widenLo(rows02)));
+				simd::store32(pb->data(x, y + 1), SimdUnpacker<Unpacker>::unpack(simd::widenLo(rows13)));
+				simd::store32(pb->data(x, y + 2), SimdUnpacker<Unpacker>::unpack(simd::widenHi(rows02)));
+				simd::store32(pb->data(x, y + 3), SimdUnpacker<Unpacker>::unpack(simd::widenHi(rows13)));
+			}
+#else
+			for (u32 i = 0; i < 16; i++)
+				*pb->data(x + i % 4, y + i / 4) = Unpacker::unpack(tile[TwiddledTileOrder[i]]);
+#endif
+		}
+	}
+}
+
+// VQ textures with 16-bit pixels.
+// The 256 codebook entries are converted first, then copied to each 2x2 block.
+template<typename Unpacker>
+void texture_VQ_codebook(PixelBuffer<typename Unpacker::unpacked_type>* pb, const u8* p_in, u32 Width, u32 Height)
+{
+	using Pixel = typename Unpacker::unpacked_type;
+	// Not worth it for small mipmaps
+	if (Width * Height < 256 * 4)
+	{
+		texture_VQ<ConvertTwiddle<Unpacker>>(pb, p_in, Width, Height);
+		return;
+	}
+	// Each entry is a twiddled 2x2 block
+	alignas(16) Pixel codebook[256 * 4];
+	unpackLine<Unpacker>((const u16 *)vq_codebook, codebook, 256 * 4);
+
+	const u32 bcx = bitscanrev(Width);
+	const u32 bcy = bitscanrev(Height);
+
+	for (u32 y = 0; y < Height; y += 2)
+	{
+		Pixel *row0 = pb->data(0, y);
+		Pixel *row1 = pb->data(0, y + 1);
+		for (u32 x = 0; x < Width; x += 2)
+		{
+			const Pixel *block = &codebook[p_in[twop(x, y, bcx, bcy) / 4] * 4];
+			row0[x] = block[0];
+			row1[x] = block[1];
+			row0[x + 1] = block[2];
+			row1[x + 1] = block[3];
+		}
+	}
+}
+
 typedef void (*TexConvFP)(PixelBuffer<u16> *pb, const u8 *p_in, u32 width, u32 height);
 typedef void (*TexConvFP8)(PixelBuffer<u8> *pb, const u8 *p_in, u32 width, u32 height);
 typedef void (*TexConvFP32)(PixelBuffer<u32> *pb, const u8 *p_in, u32 width, u32 height);
 
 //Twiddle
-constexpr TexConvFP tex565_TW = texture_TW<ConvertTwiddle<UnpackerNop<u16>>>;
+constexpr TexConvFP tex565_TW = texture_TW_tiled<UnpackerNop<u16>>;
 // Palette
 constexpr TexConvFP texPAL4_TW = texture_TW<ConvertTwiddlePal4<UnpackerPalToRgb<u16>>>;
 constexpr TexConvFP texPAL8_TW = texture_TW<ConvertTwiddlePal8<UnpackerPalToRgb<u16>>>;
@@ -479,7 +681,7 @@ constexpr TexConvFP32 texPAL8_TW32 = texture_TW<ConvertTwiddlePal8<UnpackerPalTo
 constexpr TexConvFP8 texPAL4PT_TW = texture_TW<ConvertTwiddlePal4<UnpackerNop<u8>>>;
 constexpr TexConvFP8 texPAL8PT_TW = texture_TW<ConvertTwiddlePal8<UnpackerNop<u8>>>;
 //VQ
-constexpr TexConvFP tex565_VQ = texture_VQ<ConvertTwiddle<UnpackerNop<u16>>>;
+constexpr TexConvFP tex565_VQ = texture_VQ_codebook<UnpackerNop<u16>>;
 // According to the documentation, a texture cannot be compressed and use
 // a palette at the same time. However the hardware displays them
 // just fine.
@@ -493,29 +695,29 @@ namespace opengl {
 
 //Planar
 constexpr TexConvFP32 texYUV422_PL = texture_PL<ConvertPlanarYUV<RGBAPacker>>;
-constexpr TexConvFP32 tex565_PL32 = texture_PL<ConvertPlanar<Unpacker565_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex1555_PL32 = texture_PL<ConvertPlanar<Unpacker1555_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex4444_PL32 = texture_PL<ConvertPlanar<Unpacker4444_32<RGBAPacker>>>;
+constexpr TexConvFP32 tex565_PL32 = texture_PL_lines<Unpacker565_32<RGBAPacker>>;
+constexpr TexConvFP32 tex1555_PL32 = texture_PL_lines<Unpacker1555_32<RGBAPacker>>;
+constexpr TexConvFP32 tex4444_PL32 = texture_PL_lines<Unpacker4444_32<RGBAPacker>>;
 
 //Twiddle
-constexpr TexConvFP tex1555_TW = texture_TW<ConvertTwiddle<Unpacker1555>>;
-constexpr TexConvFP tex4444_TW = texture_TW<ConvertTwiddle<Unpacker4444>>;
+constexpr TexConvFP tex1555_TW = texture_TW_tiled<Unpacker1555>;
+constexpr TexConvFP tex4444_TW = texture_TW_tiled<Unpacker4444>;
 constexpr TexConvFP texBMP_TW = tex4444_TW;
 constexpr TexConvFP32 texYUV422_TW = texture_TW<ConvertTwiddleYUV<RGBAPacker>>;
 
-constexpr TexConvFP32 tex565_TW32 = texture_TW<ConvertTwiddle<Unpacker565_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex1555_TW32 = texture_TW<ConvertTwiddle<Unpacker1555_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex4444_TW32 = texture_TW<ConvertTwiddle<Unpacker4444_32<RGBAPacker>>>;
+constexpr TexConvFP32 tex565_TW32 = texture_TW_tiled<Unpacker565_32<RGBAPacker>>;
+constexpr TexConvFP32 tex1555_TW32 = texture_TW_tiled<Unpacker1555_32<RGBAPacker>>;
+constexpr TexConvFP32 tex4444_TW32 = texture_TW_tiled<Unpacker4444_32<RGBAPacker>>;
 
 //VQ
-constexpr TexConvFP tex1555_VQ = texture_VQ<ConvertTwiddle<Unpacker1555>>;
-constexpr TexConvFP tex4444_VQ = texture_VQ<ConvertTwiddle<Unpacker4444>>;
+constexpr TexConvFP tex1555_VQ = texture_VQ_codebook<Unpacker1555>;
+constexpr TexConvFP tex4444_VQ = texture_VQ_codebook<Unpacker4444>;
 constexpr TexConvFP texBMP_VQ = tex4444_VQ;
 constexpr TexConvFP32 texYUV422_VQ = texture_VQ<ConvertTwiddleYUV<RGBAPacker>>;
 
-constexpr TexConvFP32 tex565_VQ32 = texture_VQ<ConvertTwiddle<Unpacker565_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex1555_VQ32 = texture_VQ<ConvertTwiddle<Unpacker1555_32<RGBAPacker>>>;
-constexpr TexConvFP32 tex4444_VQ32 = texture_VQ<ConvertTwiddle<Unpacker4444_32<RGBAPacker>>>;
+constexpr TexConvFP32 tex565_VQ32 = texture_VQ_codebook<Unpacker565_32<RGBAPacker>>;
+constexpr TexConvFP32 tex1555_VQ32 = texture_VQ_codebook<Unpacker1555_32<RGBAPacker>>;
+constexpr TexConvFP32 tex4444_VQ32 = texture_VQ_codebook<Unpacker4444_32<RGBAPacker>>;
 }
 
 namespace directx {
@@ -523,29 +725,29 @@ namespace directx {
 
 //Planar
 constexpr TexConvFP32 texYUV422_PL = texture_PL<ConvertPlanarYUV<BGRAPacker>>;
-constexpr TexConvFP32 tex565_PL32 = texture_PL<ConvertPlanar<Unpacker565_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex1555_PL32 = texture_PL<ConvertPlanar<Unpacker1555_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex4444_PL32 = texture_PL<ConvertPlanar<Unpacker4444_32<BGRAPacker>>>;
+constexpr TexConvFP32 tex565_PL32 = texture_PL_lines<Unpacker565_32<BGRAPacker>>;
+constexpr TexConvFP32 tex1555_PL32 = texture_PL_lines<Unpacker1555_32<BGRAPacker>>;
+constexpr TexConvFP32 tex4444_PL32 = texture_PL_lines<Unpacker4444_32<BGRAPacker>>;
 
 //Twiddle
-constexpr TexConvFP tex1555_TW = texture_TW<ConvertTwiddle<UnpackerNop<u16>>>;
-constexpr TexConvFP tex4444_TW = texture_TW<ConvertTwiddle<UnpackerNop<u16>>>;
+constexpr TexConvFP tex1555_TW = texture_TW_tiled<UnpackerNop<u16>>;
+constexpr TexConvFP tex4444_TW = texture_TW_tiled<UnpackerNop<u16>>;
 constexpr TexConvFP texBMP_TW = tex4444_TW;
 constexpr TexConvFP32 texYUV422_TW = texture_TW<ConvertTwiddleYUV<BGRAPacker>>;
 
-constexpr TexConvFP32 tex565_TW32 = texture_TW<ConvertTwiddle<Unpacker565_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex1555_TW32 = texture_TW<ConvertTwiddle<Unpacker1555_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex4444_TW32 = texture_TW<ConvertTwiddle<Unpacker4444_32<BGRAPacker>>>;
+constexpr TexConvFP32 tex565_TW32 = texture_TW_tiled<Unpacker565_32<BGRAPacker>>;
+constexpr TexConvFP32 tex1555_TW32 = texture_TW_tiled<Unpacker1555_32<BGRAPacker>>;
+constexpr TexConvFP32 tex4444_TW32 = texture_TW_tiled<Unpacker4444_32<BGRAPacker>>;
 
 //VQ
-constexpr TexConvFP tex1555_VQ = texture_VQ<ConvertTwiddle<UnpackerNop<u16>>>;
-constexpr TexConvFP tex4444_VQ = texture_VQ<ConvertTwiddle<UnpackerNop<u16>>>;
+constexpr TexConvFP tex1555_VQ = texture_VQ_codebook<UnpackerNop<u16>>;
+constexpr TexConvFP tex4444_VQ = texture_VQ_codebook<UnpackerNop<u16>>;
 constexpr TexConvFP texBMP_VQ = tex4444_VQ;
 constexpr TexConvFP32 texYUV422_VQ = texture_VQ<ConvertTwiddleYUV<BGRAPacker>>;
 
-constexpr TexConvFP32 tex565_VQ32 = texture_VQ<ConvertTwiddle<Unpacker565_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex1555_VQ32 = texture_VQ<ConvertTwiddle<Unpacker1555_32<BGRAPacker>>>;
-constexpr TexConvFP32 tex4444_VQ32 = texture_VQ<ConvertTwiddle<Unpacker4444_32<BGRAPacker>>>;
+constexpr TexConvFP32 tex565_VQ32 = texture_VQ_codebook<Unpacker565_32<BGRAPacker>>;
+constexpr TexConvFP32 tex1555_VQ32 = texture_VQ_codebook<Unpacker1555_32<BGRAPacker>>;
+constexpr TexConvFP32 tex4444_VQ32 = texture_VQ_codebook<Unpacker4444_32<BGRAPacker>>;
 }
 
 class BaseTextureCacheData;
@@ -558,10 +760,14 @@ struct vram_block
 	BaseTextureCacheData *texture;
 };
 
-bool VramLockedWriteOffset(size_t offset);
+bool VramLockedWriteOffset(size_t offset, size_t length = 1);
 bool VramLockedWrite(u8* address);
+// Invalidates the textures written since the last call. Must be called by the render thread.
+void processVramWrites();
 
 void UpscalexBRZ(int factor, u32* source, u32* dest, int width, int height, bool has_alpha);
+// Waits for the background upscaling jobs to complete
+void waitForUpscaling();
 
 struct PvrTexInfo;
 enum class TextureType { _565, _5551, _4444, _8888, _8 };
@@ -579,6 +785,8 @@ public:
 		tex_type = other.tex_type;
 		startAddress = other.startAddress;
 		dirty = other.dirty;
+		unprotected = other.unprotected;
+		vramHash = other.vramHash;
 		std::swap(lock_block, other.lock_block);
 		mmStartAddress = other.mmStartAddress;
 		width = other.width;
@@ -596,7 +804,10 @@ public:
 		std::swap(custom_image_data, other.custom_image_data);
 		custom_width = other.custom_width;
 		custom_height = other.custom_height;
+		custom_upscaled = other.custom_upscaled;
 		custom_load_in_progress = 0;
+		custom_request = 0;
+		custom_frame = 0;
 		gpuPalette = other.gpuPalette;
 	}
 
@@ -608,6 +819,8 @@ public:
 	u32 startAddress;	// texture data start address in vram
 
 	u32 dirty;			// frame number at which texture was overwritten
+	u32 unprotected;	// frame number at which a write near the texture removed its protection
+	u64 vramHash;		// hash of the texture data in vram at the last update
 	vram_block* lock_block;
 
 	u32 mmStartAddress; // pixel data start address of max level mipmap
@@ -629,7 +842,10 @@ public:
 	u8* custom_image_data;		// loaded custom image data
 	u32 custom_width;
 	u32 custom_height;
+	bool custom_upscaled;		// custom image is the upscaled texture, already in the renderer color order
 	std::atomic_int custom_load_in_progress;
+	std::atomic<u32> custom_request;	// sequence number of the latest custom image request
+	u32 custom_frame;			// last frame the pending custom image request was needed
 	bool gpuPalette;
 
 	void PrintTextureName();
@@ -666,10 +882,15 @@ public:
 	}
 
 	void ComputeHash();
+	u64 ComputeDecodedKey(u32 stride, u32 heightLimit, bool textureUpscaling, bool need_32bit_buffer, bool mipmapped);
 	bool Update();
 	virtual void UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded = false) = 0;
 	virtual bool Force32BitTexture(TextureType type) const { return false; }
 	void CheckCustomTexture();
+	// Starts a new custom image request, superseding the pending ones
+	u32 newAsyncRequest();
+	// Sets the custom image if the request is the latest one. Takes ownership of data if successful.
+	bool setAsyncImage(u32 request, u8 *data, int width, int height, bool upscaled);
 	//true if : dirty or paletted texture and hashes don't match
 	bool NeedsUpdate();
 	virtual bool Delete();
@@ -677,6 +898,13 @@ public:
 	void protectVRam();
 	void unprotectVRam();
 	void invalidate();
+	void verifyLater();
+	u64 hashVRam();
+
+	// true if the texture has been overwritten or has lost its protection since targetFrame
+	bool IsStale(u32 targetFrame) const {
+		return (dirty != 0 && dirty < targetFrame) || (unprotected != 0 && unprotected < targetFrame);
+	}
 
 	static bool IsGpuHandledPaletted(TSP tsp, TCW tcw)
 	{
@@ -702,6 +930,7 @@ class BaseTextureCache
 public:
 	Texture *getTextureCacheData(TSP tsp, TCW tcw)
 	{
+		processVramWrites();
 		u64 key = tsp.full & TSPTextureCacheMask.full;
 		if (tcw.PixelFmt == PixelPal4 || tcw.PixelFmt == PixelPal8)
 		{
@@ -726,6 +955,8 @@ public:
 			texture = &it->second;
 			// Needed if the texture is updated
 			texture->tcw.StrideSel = tcw.StrideSel;
+			if (texture->custom_load_in_progress > 0)
+				custom_texture.UpdateRequestFrame(texture);
 		}
 		else //create if not existing
 		{
@@ -767,7 +998,7 @@ public:
 
 		for (const auto& [id, texture] : cache)
 		{
-			if (texture.dirty && texture.dirty < TargetFrame)
+			if (texture.IsStale(TargetFrame))
 				list.push_back(id);
 
 			if (list.size() > 5)
@@ -784,6 +1015,7 @@ public:
 	void Clear()
 	{
 		custom_texture.Terminate();
+		waitForUpscaling();
 		for (auto& [id, texture] : cache)
 			texture.Delete();
 
@@ -815,6 +1047,14 @@ template<int Red = 0, int Green = 1, int Blue = 2, int Alpha = 3>
 void WriteTextureToVRam(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride);
 void getRenderToTextureDimensions(u32& width, u32& height, u32& pow2Width, u32& pow2Height);
 
+struct TextureStats
+{
+	u32 decoded;	// textures decoded
+	u32 verified;	// unprotected textures found unchanged
+};
+// Texture cache activity during the last rendered frame
+TextureStats getTextureStats();
+
 static inline void MakeFogTexture(u8 *tex_data)
 {
 	u8 *fog_table = (u8 *)FOG_TABLE;
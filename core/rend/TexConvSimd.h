@@ -0,0 +1,200 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// Minimal set of 128-bit vector operations used by the texture converters.
+// SSE2 is used on x86 and NEON on arm. TEXCONV_SIMD isn't defined on other architectures
+// and the converters use their scalar version.
+#pragma once
+#include "types.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXCONV_SIMD
+#define TEXCONV_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TEXCONV_SIMD
+#define TEXCONV_NEON
+#endif
+
+#ifdef TEXCONV_SIMD
+namespace simd
+{
+
+#ifdef TEXCONV_SSE2
+
+using u16x8 = __m128i;
+using u32x4 = __m128i;
+
+inline static u16x8 load16(const u16 *p) {
+	return _mm_loadu_si128((const __m128i *)p);
+}
+inline static void store16(u16 *p, u16x8 v) {
+	_mm_storeu_si128((__m128i *)p, v);
+}
+// Stores the 4 lower pixels
+inline static void storeLo16(u16 *p, u16x8 v) {
+	_mm_storel_epi64((__m128i *)p, v);
+}
+// Stores the 4 upper pixels
+inline static void storeHi16(u16 *p, u16x8 v) {
+	_mm_storel_epi64((__m128i *)p, _mm_unpackhi_epi64(v, v));
+}
+inline static void store32(u32 *p, u32x4 v) {
+	_mm_storeu_si128((__m128i *)p, v);
+}
+
+template<int n>
+inline static u16x8 sll16(u16x8 v) {
+	return _mm_slli_epi16(v, n);
+}
+template<int n>
+inline static u16x8 srl16(u16x8 v) {
+	return _mm_srli_epi16(v, n);
+}
+inline static u16x8 or16(u16x8 a, u16x8 b) {
+	return _mm_or_si128(a, b);
+}
+
+inline static u32x4 widenLo(u16x8 v) {
+	return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+inline static u32x4 widenHi(u16x8 v) {
+	return _mm_unpackhi_epi16(v, _mm_setzero_si128());
+}
+
+inline static u32x4 set32(u32 v) {
+	return _mm_set1_epi32((int)v);
+}
+template<int n>
+inline static u32x4 sll32(u32x4 v) {
+	return _mm_slli_epi32(v, n);
+}
+template<int n>
+inline static u32x4 srl32(u32x4 v) {
+	return _mm_srli_epi32(v, n);
+}
+inline static u32x4 and32(u32x4 v, u32 mask) {
+	return _mm_and_si128(v, set32(mask));
+}
+inline static u32x4 or32(u32x4 a, u32x4 b) {
+	return _mm_or_si128(a, b);
+}
+inline static u32x4 sub32(u32x4 a, u32x4 b) {
+	return _mm_sub_epi32(a, b);
+}
+
+// Splits a 4x4 twiddled tile of 16-bit pixels into rows 0 and 2, and rows 1 and 3.
+// Twiddled pixels of a 4x4 tile are ordered y0 x0 y1 x1 (lsb first):
+// row 0 is 0 2 8 10, row 1 is 1 3 9 11, row 2 is 4 6 12 14 and row 3 is 5 7 13 15.
+inline static void deinterleave(u16x8 a, u16x8 b, u16x8& rows02, u16x8& rows13)
+{
+	// Values are sign-extended so that the saturated packing is exact
+	__m128i even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+	__m128i odd = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+	rows02 = _mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+	rows13 = _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+#else // TEXCONV_NEON
+
+using u16x8 = uint16x8_t;
+using u32x4 = uint32x4_t;
+
+inline static u16x8 load16(const u16 *p) {
+	return vld1q_u16(p);
+}
+inline static void store16(u16 *p, u16x8 v) {
+	vst1q_u16(p, v);
+}
+inline static void storeLo16(u16 *p, u16x8 v) {
+	vst1_u16(p, vget_low_u16(v));
+}
+inline static void storeHi16(u16 *p, u16x8 v) {
+	vst1_u16(p, vget_high_u16(v));
+}
+inline static void store32(u32 *p, u32x4 v) {
+	vst1q_u32(p, v);
+}
+
+template<int n>
+inline static u16x8 sll16(u16x8 v) {
+	return vshlq_n_u16(v, n);
+}
+template<int n>
+inline static u16x8 srl16(u16x8 v) {
+	return vshrq_n_u16(v, n);
+}
+inline static u16x8 or16(u16x8 a, u16x8 b) {
+	return vorrq_u16(a, b);
+}
+
+inline static u32x4 widenLo(u16x8 v) {
+	return vmovl_u16(vget_low_u16(v));
+}
+inline static u32x4 widenHi(u16x8 v) {
+	return vmovl_u16(vget_high_u16(v));
+}
+
+inline static u32x4 set32(u32 v) {
+	return vdupq_n_u32(v);
+}
+template<int n>
+inline static u32x4 sll32(u32x4 v) {
+	return vshlq_n_u32(v, n);
+}
+template<int n>
+inline static u32x4 srl32(u32x4 v) {
+	return vshrq_n_u32(v, n);
+}
+inline static u32x4 and32(u32x4 v, u32 mask) {
+	return vandq_u32(v, vdupq_n_u32(mask));
+}
+inline static u32x4 or32(u32x4 a, u32x4 b) {
+	return vorrq_u32(a, b);
+}
+inline static u32x4 sub32(u32x4 a, u32x4 b) {
+	return vsubq_u32(a, b);
+}
+
+// See the SSE2 version
+inline static void deinterleave(u16x8 a, u16x8 b, u16x8& rows02, u16x8& rows13)
+{
+	uint16x8x2_t split = vuzpq_u16(a, b);
+	uint32x4x2_t even = vuzpq_u32(vreinterpretq_u32_u16(split.val[0]), vreinterpretq_u32_u16(split.val[0]));
+	uint32x4x2_t odd = vuzpq_u32(vreinterpretq_u32_u16(split.val[1]), vreinterpretq_u32_u16(split.val[1]));
+	rows02 = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(even.val[0]), vget_low_u32(even.val[1])));
+	rows13 = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(odd.val[0]), vget_low_u32(odd.val[1])));
+}
+
+#endif
+
+// Replicates the upper bits of a color component in its lower bits
+template<int bits>
+inline static u32x4 expand8(u32x4 v)
+{
+	static_assert(bits >= 4 && bits < 8, "Invalid component size");
+	return or32(sll32<8 - bits>(v), srl32<2 * bits - 8>(v));
+}
+template<>
+inline u32x4 expand8<4>(u32x4 v) {
+	return or32(sll32<4>(v), v);
+}
+
+} // namespace simd
+#endif // TEXCONV_SIMD
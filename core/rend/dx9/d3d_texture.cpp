@@ -117,7 +117,8 @@ bool D3DTexture::Delete()
 
 void D3DTexture::loadCustomTexture()
 {
-	u32 size = custom_width * custom_height;
+	// Upscaled textures are already in BGRA order
+	u32 size = custom_upscaled ? 0 : custom_width * custom_height;
 	u8 *p = custom_image_data;
 	while (size--)
 	{
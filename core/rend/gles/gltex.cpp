@@ -226,7 +226,7 @@ void ReadRTTBuffer()
 		u32 page_size = size + tex_addr - page_tex_addr;
 		page_size = ((page_size - 1) / PAGE_SIZE + 1) * PAGE_SIZE;
 		for (u32 page = page_tex_addr; page < page_tex_addr + page_size; page += PAGE_SIZE)
-			VramLockedWriteOffset(page);
+			VramLockedWriteOffset(page, PAGE_SIZE);
 #endif
 
 		glPixelStorei(GL_PACK_ALIGNMENT, 1);
@@ -1,6 +1,13 @@
+#include "norend.h"
 #include "hw/pvr/ta.h"
 #include "hw/pvr/ta_ctx.h"
 #include "hw/pvr/Renderer_if.h"
+#include "hw/pvr/pvr_mem.h"
+#include "rend/TexCache.h"
+#include "cfg/option.h"
+#include "emulator.h"
+
+#include <chrono>
 
 struct norend : Renderer
 {
@@ -22,3 +29,195 @@ struct norend : Renderer
 Renderer *rend_norend() {
 	return new norend();
 }
+
+#ifndef LIBRETRO
+namespace
+{
+
+// Texture decoded in memory only
+class CpuTexture final : public BaseTextureCacheData
+{
+public:
+	CpuTexture(TSP tsp, TCW tcw) : BaseTextureCacheData(tsp, tcw) {
+	}
+	CpuTexture(CpuTexture&& other) : BaseTextureCacheData(std::move(other)) {
+	}
+
+	std::string GetId() override { return std::to_string(startAddress); }
+	void UploadToGPU(int width, int height, const u8 *buffer, bool mipmapped, bool mipmapsIncluded = false) override {
+	}
+};
+
+class CpuTextureCache final : public BaseTextureCache<CpuTexture>
+{
+};
+
+enum Stage { Parsing, Sorting, Textures, Writeback, StageCount };
+const char * const StageNames[StageCount] { "TA parsing", "Sorting", "Textures", "Writeback" };
+
+u64 nanosSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs the CPU side of the render pipeline and measures the time spent in each stage
+struct BenchmarkRenderer : norend
+{
+	void Term() override {
+		textureCache.Clear();
+	}
+
+	void Process(TA_context *ctx) override
+	{
+		times[Textures] = 0;
+		textureCount = 0;
+		const u64 sortTime = ta_sortTime;
+		const auto start = std::chrono::steady_clock::now();
+		ta_parse(ctx, true);
+		const u64 time = nanosSince(start);
+		// Sorting and texture decoding are done while parsing
+		times[Sorting] = ta_sortTime - sortTime;
+		times[Parsing] = time - times[Sorting] - times[Textures];
+	}
+
+	// Writes an empty image where the rendered frame would go
+	bool Render() override
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const u32 width = pvrrc.getFramebufferWidth();
+		const u32 height = pvrrc.getFramebufferHeight();
+		const u32 texAddr = pvrrc.fb_W_SOF1 & VRAM_MASK;
+		u32 linestride = pvrrc.fb_W_LINESTRIDE * 8;
+		image.resize(width * height * 4);
+		if (pvrrc.isRTT)
+		{
+			if (linestride == 0)
+				linestride = width * 2;
+			if (texAddr + linestride * height <= VRAM_SIZE)
+				WriteTextureToVRam(width, height, image.data(), (u16 *)&vram[texAddr], pvrrc.fb_W_CTRL, linestride);
+		}
+		else if (width > 0 && height > 0)
+		{
+			FB_X_CLIP_type xClip = pvrrc.fb_X_CLIP;
+			FB_Y_CLIP_type yClip = pvrrc.fb_Y_CLIP;
+			xClip.min = std::min(xClip.min, width - 1);
+			xClip.max = std::min(xClip.max, width - 1);
+			yClip.min = std::min(yClip.min, height - 1);
+			yClip.max = std::min(yClip.max, height - 1);
+			WriteFramebuffer(width, height, image.data(), texAddr, pvrrc.fb_W_CTRL, linestride, xClip, yClip);
+		}
+		times[Writeback] = nanosSince(start);
+
+		return !pvrrc.isRTT;
+	}
+
+	BaseTextureCacheData *GetTexture(TSP tsp, TCW tcw) override
+	{
+		const auto start = std::chrono::steady_clock::now();
+		CpuTexture *texture = textureCache.getTextureCacheData(tsp, tcw);
+		if (texture->NeedsUpdate())
+		{
+			if (!texture->Update())
+				texture = nullptr;
+			textureCount++;
+		}
+		times[Textures] += nanosSince(start);
+		return texture;
+	}
+
+	CpuTextureCache textureCache;
+	std::vector<u8> image;
+	u64 times[StageCount] {};
+	u32 textureCount = 0;
+};
+
+struct StageStats
+{
+	u64 total = 0;
+	u64 min = ~0ull;
+	u64 max = 0;
+
+	void add(u64 time) {
+		total += time;
+		min = std::min(min, time);
+		max = std::max(max, time);
+	}
+};
+
+}
+
+bool rend_benchmark(int frames)
+{
+	try {
+		emu.loadGame(settings.content.path.c_str());
+	} catch (const FlycastException& e) {
+		ERROR_LOG(RENDERER, "Benchmark: %s", e.what());
+		return false;
+	}
+	dc_loadstate(config::SavestateSlot);
+
+	// Same contexts as rend_start_render() would use
+	u32 addresses[MAX_PASSES];
+	const int count = getTAContextAddresses(addresses);
+	TA_context *ctx = count > 0 ? tactx_Pop(addresses[0]) : nullptr;
+	if (ctx == nullptr)
+	{
+		ERROR_LOG(RENDERER, "Benchmark: no frame found in savestate %d", (int)config::SavestateSlot);
+		emu.unloadGame();
+		return false;
+	}
+	TA_context *linkedCtx = ctx;
+	for (int i = 1; i < count && linkedCtx != nullptr; i++)
+	{
+		linkedCtx->nextContext = tactx_Pop(addresses[i]);
+		linkedCtx = linkedCtx->nextContext;
+	}
+	palette_update();
+
+	BenchmarkRenderer benchmarkRenderer;
+	renderer = &benchmarkRenderer;
+	_pvrrc = ctx;
+	StageStats stats[StageCount];
+	StageStats frameStats;
+	for (int i = 0; i < frames; i++)
+	{
+		// Textures are decoded every frame
+		benchmarkRenderer.textureCache.Clear();
+		ctx->rend.Clear();
+		rend_set_render_params(ctx);
+
+		benchmarkRenderer.Process(ctx);
+		benchmarkRenderer.Render();
+		FrameCount++;
+
+		u64 frameTime = 0;
+		for (int stage = 0; stage < StageCount; stage++)
+		{
+			stats[stage].add(benchmarkRenderer.times[stage]);
+			frameTime += benchmarkRenderer.times[stage];
+		}
+		frameStats.add(frameTime);
+	}
+	printf("%d frames, %d vertices, %d polygons, %d textures, %s\n", frames, (int)ctx->rend.verts.size(),
+			(int)(ctx->rend.global_param_op.size() + ctx->rend.global_param_pt.size() + ctx->rend.global_param_tr.size()),
+			benchmarkRenderer.textureCount, ctx->rend.isRTT ? "render to texture" : "framebuffer");
+	printf("%-12s %10s %10s %10s\n", "Stage (us)", "Average", "Min", "Max");
+	for (int stage = 0; stage < StageCount; stage++)
+		printf("%-12s %10.1f %10.1f %10.1f\n", StageNames[stage], stats[stage].total / 1000.0 / frames,
+				stats[stage].min / 1000.0, stats[stage].max / 1000.0);
+	printf("%-12s %10.1f %10.1f %10.1f\n", "Frame", frameStats.total / 1000.0 / frames,
+			frameStats.min / 1000.0, frameStats.max / 1000.0);
+
+	_pvrrc = nullptr;
+	renderer = nullptr;
+	benchmarkRenderer.Term();
+	while (ctx != nullptr)
+	{
+		TA_context *next = ctx->nextContext;
+		delete ctx;
+		ctx = next;
+	}
+	emu.unloadGame();
+
+	return true;
+}
+#endif
@@ -0,0 +1,32 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+
+struct Renderer;
+
+Renderer *rend_norend();
+
+#ifndef LIBRETRO
+// Loads the current game and its savestate, then replays the frame found in the savestate through
+// the CPU side of the render pipeline: TA parsing, sorting, texture decoding and framebuffer writeback.
+// No GPU is needed. The time spent in each stage is printed once done.
+// Returns false if the game or the frame can't be loaded.
+bool rend_benchmark(int frames);
+#endif
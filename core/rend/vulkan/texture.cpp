@@ -492,7 +492,7 @@ void TextureCache::Cleanup()
 
 	for (const auto& [id, texture] : cache)
 	{
-		if (texture.dirty && texture.dirty < TargetFrame)
+		if (texture.IsStale(TargetFrame))
 			list.push_back(id);
 
 		if (list.size() > 5)
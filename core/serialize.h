@@ -119,6 +119,31 @@ public:
 		this->_size += size;
 	}
 
+	// Rollback only: skips the next object if it's equal to the current one, meaning that
+	// it hasn't changed since the snapshot. Returns true if skipped.
+	template<typename T>
+	bool skipUnchanged(const T& obj) {
+		return skipUnchanged(&obj, sizeof(T));
+	}
+	bool skipUnchanged(const void *obj, size_t size)
+	{
+		if (!_rollback || this->_size + size > limit || memcmp(data, obj, size) != 0)
+			return false;
+		data += size;
+		this->_size += size;
+		return true;
+	}
+	// Deserializes the object unless it's unchanged since the rollback snapshot.
+	// Returns true if the object has been deserialized.
+	template<typename T>
+	bool deserializeChanged(T& obj)
+	{
+		if (skipUnchanged(obj))
+			return false;
+		deserialize(obj);
+		return true;
+	}
+
 	Version version() const { return _version; }
 
 private:
@@ -164,20 +189,17 @@ public:
 	}
 	void skip(size_t size)
 	{
-		if (data != nullptr)
-			data += size;
 		this->_size += size;
 	}
 	bool dryrun() const { return data == nullptr; }
+	// True if the data didn't fit within the limit. Only the size is updated past the limit.
+	bool overflow() const { return this->_size > limit; }
 
 private:
 	void doSerialize(const void *src, size_t size)
 	{
-		if (data != nullptr)
-		{
-			memcpy(data, src, size);
-			data += size;
-		}
+		if (data != nullptr && this->_size + size <= limit)
+			memcpy(data + this->_size, src, size);
 		this->_size += size;
 	}
 
@@ -189,6 +189,127 @@ void cResetEvent::Wait()
     state = false;
 }
 
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		stopping = true;
+	}
+	startCond.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void WorkerPool::run(u32 count, const std::function<void(u32)>& job)
+{
+	const u32 workers = std::min(maxThreads, count > 0 ? count - 1 : 0);
+	if (workers == 0)
+	{
+		for (u32 i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		while (threads.size() < workers)
+			threads.emplace_back(&WorkerPool::workerLoop, this, generation);
+		this->job = &job;
+		jobCount = count;
+		nextJob = 0;
+		// Only the threads that aren't running a queued job take part in the batch.
+		// Each one claims a slot so that a thread that misses the batch
+		// can't start working on it once it's over.
+		batchSlots = std::min(workers, (u32)threads.size() - busyWorkers);
+		activeWorkers = batchSlots;
+		generation++;
+	}
+	startCond.notify_all();
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCond.wait(lock, [this]() { return activeWorkers == 0; });
+	this->job = nullptr;
+}
+
+void WorkerPool::runJobs()
+{
+	for (u32 i = nextJob++; i < jobCount; i = nextJob++)
+		(*job)(i);
+}
+
+void WorkerPool::push(std::function<void()>&& job, u32 threadCount, bool urgent)
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		(urgent ? urgentJobs : jobs).push_back(std::move(job));
+		if (threads.size() < threadCount)
+			threads.emplace_back(&WorkerPool::workerLoop, this, generation);
+	}
+	startCond.notify_one();
+}
+
+// Runs the next queued job if any. The lock is released while the job runs.
+bool WorkerPool::runNext(std::unique_lock<std::mutex>& lock, bool urgentOnly)
+{
+	auto& queue = !urgentJobs.empty() || urgentOnly ? urgentJobs : jobs;
+	if (queue.empty())
+		return false;
+	std::function<void()> job = std::move(queue.front());
+	queue.pop_front();
+	runningJobs++;
+	lock.unlock();
+	job();
+	lock.lock();
+	runningJobs--;
+	doneCond.notify_all();
+	return true;
+}
+
+void WorkerPool::runUntil(const std::function<bool()>& done)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!done())
+		if (!runNext(lock, true))
+			doneCond.wait(lock);
+}
+
+void WorkerPool::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCond.wait(lock, [this]() { return urgentJobs.empty() && jobs.empty() && runningJobs == 0; });
+}
+
+void WorkerPool::workerLoop(u32 lastGeneration)
+{
+	ThreadName _(name);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		startCond.wait(lock, [&]() {
+			return stopping || generation != lastGeneration || !urgentJobs.empty() || !jobs.empty();
+		});
+		if (stopping)
+			return;
+		if (generation != lastGeneration)
+		{
+			lastGeneration = generation;
+			if (batchSlots > 0)
+			{
+				batchSlots--;
+				lock.unlock();
+				runJobs();
+				lock.lock();
+				if (--activeWorkers == 0)
+					doneCond.notify_all();
+			}
+			continue;
+		}
+		busyWorkers++;
+		runNext(lock, false);
+		busyWorkers--;
+	}
+}
+
 void RamRegion::serialize(Serializer &ser) const {
 	ser.serialize(data, size);
 }
@@ -3,9 +3,11 @@
 #include "md5/md5.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -59,6 +61,54 @@ public :
 	void Wait();	//Wait for signal , then reset[if auto]
 };
 
+// Runs batches of independent jobs, or queued background jobs, on a set of worker threads
+class WorkerPool
+{
+public:
+	// Up to threadCount worker threads are started when first needed by run()
+	WorkerPool(const char *name, u32 threadCount)
+		: name(name), maxThreads(threadCount) {}
+	~WorkerPool();
+
+	// Calls job(i) for each i in [0, count[ on the idle worker threads and the calling thread.
+	// Returns when all jobs are done.
+	void run(u32 count, const std::function<void(u32)>& job);
+
+	// Queues a background job. Urgent jobs run before the others.
+	// Up to threadCount worker threads are started when needed.
+	void push(std::function<void()>&& job, u32 threadCount, bool urgent = false);
+	// Runs urgent jobs on the calling thread until done() returns true.
+	// done() is called with the pool locked, after each job and whenever a worker completes one.
+	void runUntil(const std::function<bool()>& done);
+	// Waits until all the queued jobs have run
+	void wait();
+
+private:
+	void workerLoop(u32 generation);
+	void runJobs();
+	bool runNext(std::unique_lock<std::mutex>& lock, bool urgentOnly);
+
+	const char *name;
+	u32 maxThreads;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable startCond;
+	std::condition_variable doneCond;
+	// Batch
+	const std::function<void(u32)> *job = nullptr;
+	u32 jobCount = 0;
+	std::atomic<u32> nextJob{};
+	u32 generation = 0;
+	u32 batchSlots = 0;
+	u32 activeWorkers = 0;
+	// Queued jobs
+	std::deque<std::function<void()>> urgentJobs;
+	std::deque<std::function<void()>> jobs;
+	u32 runningJobs = 0;
+	u32 busyWorkers = 0;
+	bool stopping = false;
+};
+
 void set_user_config_dir(const std::string& dir);
 void set_user_data_dir(const std::string& dir);
 void add_system_config_dir(const std::string& dir);
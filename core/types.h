@@ -211,6 +211,8 @@ struct settings_t
 	} naomi;
 
 	bool raHardcoreMode;
+	// Number of frames to replay in headless benchmark mode
+	int benchmarkFrames;
 };
 
 extern settings_t settings;
@@ -606,7 +606,7 @@ static void getScreenshot(std::vector<u8>& data, int width = 0)
 
 static void savestate()
 {
-	// TODO save state async: png compression, savestate file compression/write
+	// TODO save state async: png compression
 	std::vector<u8> pngData;
 	getScreenshot(pngData, 640);
 	dc_savestate(config::SavestateSlot, pngData.empty() ? nullptr : &pngData[0], pngData.size());
@@ -1827,6 +1827,10 @@ static void gui_settings_general()
 	ImGui::SameLine();
 	OptionCheckbox("Save", config::AutoSaveState,
 			"Save the state of the game when stopping");
+	OptionCheckbox("Incremental Savestates", config::IncrementalSavestates,
+			"Only save the memory changed since the last save state. Faster but uses more disk space.");
+	OptionCheckbox("Compact Savestates", config::CompactSavestates,
+			"Compress save states more. Saving takes longer.");
 	OptionCheckbox("Naomi Free Play", config::ForceFreePlay, "Configure Naomi games in Free Play mode.");
 #if USE_DISCORD
 	OptionCheckbox("Discord Presence", config::DiscordPresence, "Show which game you are playing on Discord");
@@ -2294,6 +2298,12 @@ static void gui_settings_video()
     			"Very slow and incompatible with upscaling and wide screen.");
     	OptionCheckbox("Load Custom Textures", config::CustomTextures,
     			"Load custom/high-res textures from data/textures/<game id>");
+    	OptionSlider("Custom Texture Cache", config::CustomTexturePackSize, 0, 2047,
+    			"Maximum size of the file keeping decoded custom textures to load them faster. 0 to disable", "%d MB");
+    	OptionSlider("Decoded Texture Cache", config::DecodedTextureCacheSize, 0, 512,
+    			"Memory used to keep decoded textures and avoid decoding them again. 0 to disable", "%d MB");
+    	OptionCheckbox("Save Decoded Textures", config::DecodedTextureDiskCache,
+    			"Save the decoded texture cache when the game is stopped and reload it on the next launch");
     }
 	ImGui::Spacing();
     header("Aspect Ratio");
@@ -2450,14 +2460,12 @@ static void gui_settings_video()
 	ImGui::Spacing();
     header("Texture Upscaling");
     {
-#ifdef _OPENMP
     	OptionArrowButtons("Texture Upscaling", config::TextureUpscale, 1, 8,
     			"Upscale textures with the xBRZ algorithm. Only on fast platforms and for certain 2D games", "x%d");
     	OptionSlider("Texture Max Size", config::MaxFilteredTextureSize, 8, 1024,
     			"Textures larger than this dimension squared will not be upscaled");
     	OptionArrowButtons("Max Threads", config::MaxThreads, 1, 8,
     			"Maximum number of threads to use for texture upscaling. Recommended: number of physical cores minus one");
-#endif
     }
 #ifdef VIDEO_ROUTING
 #ifdef __APPLE__
@@ -2510,6 +2518,8 @@ static void gui_settings_audio()
 	OptionCheckbox("Enable DSP", config::DSPEnabled,
 			"Enable the Dreamcast Digital Sound Processor. Only recommended on fast platforms");
     OptionCheckbox("Enable VMU Sounds", config::VmuSound, "Play VMU beeps when enabled.");
+	OptionCheckbox("Threaded Sound CPU", config::ThreadedArm7,
+			"Run the ARM7 sound CPU on a separate thread. Sound CPU interrupts are delivered one sample late");
 
 	if (OptionSlider("Volume Level", config::AudioVolume, 0, 100, "Adjust the emulator's audio level", "%d%%"))
 	{
@@ -2771,6 +2781,15 @@ static void gui_settings_advanced()
 		OptionSlider("SH4 Clock", config::Sh4Clock, 100, 300,
 				"Over/Underclock the main SH4 CPU. Default is 200 MHz. Other values may crash, freeze or trigger unexpected nuclear reactions.",
 				"%d MHz");
+		{
+			DisabledScope scope(game_started || !config::DynarecEnabled);
+			OptionCheckbox("Persistent Dynarec Cache", config::DynarecPersistentCache,
+					"Save the recompiled code on disk to reduce stuttering the next time the game is started");
+			OptionCheckbox("Background Compilation", config::DynarecAsyncCompile,
+					"Compile new code on a separate thread and interpret it in the meantime. Ignored when playing online");
+			OptionCheckbox("Trace Compilation", config::DynarecTraces,
+					"Don't end blocks at conditional forward branches to reduce the number of block dispatches");
+		}
     }
 	ImGui::Spacing();
     header("Other");
@@ -2778,6 +2797,8 @@ static void gui_settings_advanced()
     	OptionCheckbox("HLE BIOS", config::UseReios, "Force high-level BIOS emulation");
         OptionCheckbox("Multi-threaded emulation", config::ThreadedRendering,
         		"Run the emulated CPU and GPU on different threads");
+        OptionCheckbox("Parallel Display List Parsing", config::ParallelTAParsing,
+        		"Parse large display lists on several threads");
 #ifndef __ANDROID
         OptionCheckbox("Serial Console", config::SerialConsole,
         		"Dump the Dreamcast serial console to stdout");
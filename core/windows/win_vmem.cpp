@@ -32,6 +32,16 @@ bool region_unlock(void *start, size_t len)
 	return true;
 }
 
+bool region_set_noaccess(void *start, size_t len)
+{
+	DWORD old;
+	if (!VirtualProtect(start, len, PAGE_NOACCESS, &old)) {
+		ERROR_LOG(VMEM, "VirtualProtect(%p, %x, NA) failed: %d", start, (u32)len, GetLastError());
+		die("VirtualProtect(na) failed");
+	}
+	return true;
+}
+
 static void *mem_region_reserve(void *start, size_t len)
 {
 	DWORD type = MEM_RESERVE;
@@ -790,6 +790,24 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      CORE_OPTION_NAME "_decoded_texture_cache_size",
+      "Decoded Texture Cache",
+      NULL,
+      "Memory used to keep decoded textures and avoid decoding them again.",
+      NULL,
+      "hacks",
+      {
+         { "0",   "disabled" },
+         { "32",  "32 MB" },
+         { "64",  "64 MB" },
+         { "128", "128 MB" },
+         { "256", "256 MB" },
+         { "512", "512 MB" },
+         { NULL, NULL },
+      },
+      "0",
+   },
    {
       CORE_OPTION_NAME "_analog_stick_deadzone",
       "Analog Stick Deadzone",
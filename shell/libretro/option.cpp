@@ -24,6 +24,9 @@ namespace config {
 // Dynarec
 
 Option<bool> DynarecEnabled("", true);
+Option<bool> DynarecPersistentCache("");
+Option<bool> DynarecAsyncCompile("");
+Option<bool> DynarecTraces("");
 IntOption Sh4Clock(CORE_OPTION_NAME "_sh4clock", 200);
 
 // General
@@ -34,6 +37,8 @@ Option<int> Broadcast(CORE_OPTION_NAME "_broadcast", 0);	// NTSC
 Option<int> Language(CORE_OPTION_NAME "_language", 1);		// English
 Option<bool> AutoLoadState("");
 Option<bool> AutoSaveState("");
+Option<bool> IncrementalSavestates("");
+Option<bool> CompactSavestates("");
 Option<int, false> SavestateSlot("");
 Option<bool> ForceFreePlay(CORE_OPTION_NAME "_force_freeplay", true);
 
@@ -49,6 +54,8 @@ Option<bool> AutoLatency("");
 
 OptionString AudioBackend("", "auto");
 Option<bool> VmuSound(CORE_OPTION_NAME "_vmu_sound", false);
+Option<bool> ThreadedArm7("", false);
+Option<bool> Arm7DeterminismCheck("", false);
 
 // Rendering
 
@@ -64,7 +71,10 @@ IntOption TextureUpscale(CORE_OPTION_NAME "_texupscale", 1);
 IntOption MaxFilteredTextureSize(CORE_OPTION_NAME "_texupscale_max_filtered_texture_size", 256);
 Option<float> ExtraDepthScale("", 1.f);
 Option<bool> CustomTextures(CORE_OPTION_NAME "_custom_textures");
+Option<int> CustomTexturePackSize("", 256);
 Option<bool> DumpTextures(CORE_OPTION_NAME "_dump_textures");
+IntOption DecodedTextureCacheSize(CORE_OPTION_NAME "_decoded_texture_cache_size");
+Option<bool> DecodedTextureDiskCache("");
 Option<int> ScreenStretching("", 100);
 Option<bool> Fog(CORE_OPTION_NAME "_fog", true);
 Option<bool> FloatVMUs("");
@@ -84,6 +94,7 @@ Option<int> AutoSkipFrame(CORE_OPTION_NAME "_auto_skip_frame", 0);
 Option<int> RenderResolution("", 480);
 Option<bool> VSync("", true);
 Option<bool> ThreadedRendering(CORE_OPTION_NAME "_threaded_rendering", true);
+Option<bool> ParallelTAParsing("");
 Option<int> AnisotropicFiltering(CORE_OPTION_NAME "_anisotropic_filtering");
 Option<int> TextureFiltering(CORE_OPTION_NAME "_texture_filtering");
 Option<bool> PowerVR2Filter(CORE_OPTION_NAME "_pvr2_filtering");
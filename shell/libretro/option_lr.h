@@ -208,4 +208,5 @@ extern Option<bool> PowerVR2Filter;
 extern IntOption TextureUpscale;
 extern IntOption MaxFilteredTextureSize;
 extern IntOption PerPixelLayers;
+extern IntOption DecodedTextureCacheSize;	// in MB
 extern IntOption Sh4Clock;
@@ -124,6 +124,16 @@ std::string getShaderCachePath(const std::string& filename)
 	return std::string(game_dir_no_slash) + std::string(path_default_slash()) + filename;
 }
 
+std::string getBlockCachePath(const std::string& gameId)
+{
+	return std::string(game_dir_no_slash) + std::string(path_default_slash()) + gameId + ".sh4cache";
+}
+
+std::string getTextureCachePath(const std::string& gameId)
+{
+	return std::string(game_dir_no_slash) + std::string(path_default_slash()) + gameId + ".texcache";
+}
+
 std::string getTextureLoadPath(const std::string& gameId)
 {
 	return std::string(retro_get_system_directory()) + "/dc/textures/"
@@ -61,6 +61,23 @@ bool region_unlock(void *start, size_t len)
 	return true;
 }
 
+bool region_set_noaccess(void *start, size_t len)
+{
+	const size_t inpage = (uintptr_t)start & PAGE_MASK;
+	len = (len + inpage + PAGE_SIZE - 1) & ~PAGE_MASK;
+
+	Result rc;
+	uintptr_t start_addr = (uintptr_t)start - inpage;
+	for (uintptr_t addr = start_addr; addr < (start_addr + len); addr += PAGE_SIZE)
+	{
+		rc = svcSetMemoryPermission((void *)addr, PAGE_SIZE, Perm_None);
+		if (R_FAILED(rc))
+			ERROR_LOG(VMEM, "Failed to SetPerm Perm_None on %p len 0x%x rc 0x%x", (void*)addr, PAGE_SIZE, rc);
+	}
+
+	return true;
+}
+
 // Implement vmem initialization for RAM, ARAM, VRAM and SH4 context, fpcb etc.
 
 // vmem_base_addr points to an address space of 512MB that can be used for fast memory ops.
@@ -0,0 +1,167 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "emulator.h"
+#include "hw/aica/aica.h"
+#include "hw/aica/aica_if.h"
+#include "hw/aica/dsp.h"
+#include <chrono>
+#include <random>
+
+namespace aica::dsp
+{
+
+class AicaDspTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		dc_reset(true);
+	}
+
+	// Random program with empty instructions and memory accesses on odd steps, like reverb effects
+	void generateProgram(u32 seed, int nopPercent)
+	{
+		std::mt19937 rng(seed);
+		for (u32 i = 0; i < 128; i++)
+		{
+			u32 *IPtr = &DSPData->MPRO[i * 4];
+			if ((int)(rng() % 100) < nopPercent)
+			{
+				IPtr[0] = IPtr[1] = IPtr[2] = IPtr[3] = 0;
+				continue;
+			}
+			IPtr[0] = rng() & 0xffff;
+			IPtr[1] = rng() & 0xffff;
+			IPtr[2] = rng() & 0x1fff;
+			IPtr[3] = rng() & 0xff80;
+			if (i & 1)
+				// MRD or MWT, TABLE
+				IPtr[2] |= rng() & 0xe000;
+		}
+		for (u32& coef : DSPData->COEF)
+			coef = rng() & 0xfff8;
+		for (u32& madrs : DSPData->MADRS)
+			madrs = rng() & 0xffff;
+		for (s32& mems : state.MEMS)
+			mems = (s32)(rng() << 8) >> 8;
+		for (s32& temp : state.TEMP)
+			temp = (s32)(rng() << 8) >> 8;
+		state.RBL = 0x8000 - 1;
+		state.RBP = 0x100000;
+		state.MDEC_CT = 1;
+	}
+
+	void setInputs(u32 sample)
+	{
+		for (int i = 0; i < 16; i++)
+			state.MIXS[i] = (s32)((sample * 2654435761u + i * 40503u) << 12) >> 12;
+		DSPData->EXTS[0] = (sample * 7919) & 0xffff;
+		DSPData->EXTS[1] = (sample * 104729) & 0xffff;
+	}
+
+	struct Snapshot
+	{
+		DSPState state;
+		u32 EFREG[16];
+		std::vector<u8> ram;
+
+		void save()
+		{
+			state = dsp::state;
+			memcpy(EFREG, DSPData->EFREG, sizeof(EFREG));
+			ram.assign(&aica_ram[0x100000], &aica_ram[0x100000] + 0x10000 * 2);
+		}
+		void restore()
+		{
+			dsp::state = state;
+			memcpy(DSPData->EFREG, EFREG, sizeof(EFREG));
+			memcpy(&aica_ram[0x100000], ram.data(), ram.size());
+		}
+	};
+
+	static void assertEqual(const Snapshot& expected, const Snapshot& actual)
+	{
+		ASSERT_EQ(0, memcmp(expected.state.TEMP, actual.state.TEMP, sizeof(expected.state.TEMP)));
+		ASSERT_EQ(0, memcmp(expected.state.MEMS, actual.state.MEMS, sizeof(expected.state.MEMS)));
+		ASSERT_EQ(expected.state.MDEC_CT, actual.state.MDEC_CT);
+		ASSERT_EQ(0, memcmp(expected.EFREG, actual.EFREG, sizeof(expected.EFREG)));
+		ASSERT_EQ(expected.ram, actual.ram);
+	}
+
+	template<typename F>
+	double run(F stepFunction, u32 samples)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < samples; i++)
+		{
+			setInputs(i);
+			stepFunction();
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+TEST_F(AicaDspTest, Decoded)
+{
+	for (u32 seed = 0; seed < 20; seed++)
+	{
+		generateProgram(seed, seed % 4 * 25);
+		decodeProgram();
+		Snapshot initial;
+		initial.save();
+
+		run(interpStep, 1000);
+		Snapshot expected;
+		expected.save();
+
+		initial.restore();
+		run(decodedStep, 1000);
+		Snapshot actual;
+		actual.save();
+		assertEqual(expected, actual);
+	}
+}
+
+TEST_F(AicaDspTest, DISABLED_Benchmark)
+{
+	constexpr u32 Samples = 44100;
+	generateProgram(42, 40);
+	Snapshot initial;
+	initial.save();
+
+	double interpTime = run(interpStep, Samples);
+
+	initial.restore();
+	decodeProgram();
+	double decodedTime = run(decodedStep, Samples);
+
+	initial.restore();
+	recompile();
+	double recTime = run(runStep, Samples);
+
+	printf("DSP step for 1 second of audio: interpreter %.1f ms, decoded %.1f ms, runStep (%s) %.1f ms\n",
+			interpTime, decodedTime, FEAT_DSPREC == DYNAREC_JIT ? "jit" : "decoded", recTime);
+}
+
+} // namespace aica::dsp
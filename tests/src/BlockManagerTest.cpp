@@ -0,0 +1,152 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "emulator.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include <chrono>
+#include <random>
+
+class BlockManagerTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		dc_reset(true);
+		bm_Reset();
+	}
+
+	void TearDown() override
+	{
+		bm_ResetCache();
+		bm_Reset();
+	}
+
+	static constexpr u32 BaseAddress = 0x8c010000;
+	static constexpr u32 GuestSize = 128;
+	static constexpr u32 HostSize = 64;
+
+	void addBlock(u32 addr, u8 *hostCode, u32 hostSize)
+	{
+		RuntimeBlockInfo *block = new RuntimeBlockInfo();
+		block->vaddr = block->addr = addr;
+		block->sh4_code_size = GuestSize;
+		block->host_code_size = hostSize;
+		block->code = (DynarecCodeEntryPtr)hostCode;
+		block->temp_block = false;
+		block->pBranchBlock = block->pNextBlock = nullptr;
+		block->relink_data = 0;
+		block->SetProtectedFlags();
+		bm_AddBlock(block);
+	}
+
+	// Add fake blocks with contiguous host code
+	void addBlocks(u32 count)
+	{
+		code.resize((size_t)count * HostSize);
+		for (u32 i = 0; i < count; i++)
+			addBlock(BaseAddress + i * GuestSize, &code[(size_t)i * HostSize], HostSize);
+	}
+
+	std::vector<u8> code;
+};
+
+TEST_F(BlockManagerTest, Lookup)
+{
+	addBlocks(16);
+	for (u32 i = 0; i < 16; i++)
+	{
+		RuntimeBlockInfoPtr block = bm_GetBlock(&code[i * HostSize + HostSize / 2]);
+		ASSERT_NE(nullptr, block);
+		ASSERT_EQ(BaseAddress + i * GuestSize, block->vaddr);
+	}
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[0] - 1));
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[0] + code.size()));
+
+	bm_DiscardBlock(bm_GetBlock(&code[3 * HostSize]).get());
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[3 * HostSize]));
+	ASSERT_NE(nullptr, bm_GetBlock(&code[2 * HostSize]));
+	ASSERT_NE(nullptr, bm_GetBlock(&code[4 * HostSize]));
+}
+
+// The code of discarded blocks can be reused by a new block of a different size
+TEST_F(BlockManagerTest, ReuseCode)
+{
+	addBlocks(16);
+	bm_DiscardBlock(bm_GetBlock(&code[3 * HostSize]).get());
+	bm_DiscardBlock(bm_GetBlock(&code[4 * HostSize]).get());
+	addBlock(BaseAddress + 32 * GuestSize, &code[3 * HostSize], HostSize * 2);
+	for (u32 i = 3; i <= 4; i++)
+	{
+		RuntimeBlockInfoPtr block = bm_GetBlock(&code[i * HostSize + HostSize / 2]);
+		ASSERT_NE(nullptr, block);
+		ASSERT_EQ(BaseAddress + 32 * GuestSize, block->vaddr);
+	}
+}
+
+TEST_F(BlockManagerTest, RamWriteAccess)
+{
+	// 32 blocks per page
+	addBlocks(96);
+	// Writing to the second page discards the blocks it contains
+	bm_RamWriteAccess(BaseAddress + PAGE_SIZE);
+	ASSERT_NE(nullptr, bm_GetBlock(&code[31 * HostSize]));
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[32 * HostSize]));
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[63 * HostSize]));
+	ASSERT_NE(nullptr, bm_GetBlock(&code[64 * HostSize]));
+
+	bm_RamWriteAccess(BaseAddress);
+	bm_RamWriteAccess(BaseAddress + 2 * PAGE_SIZE);
+	for (u32 i = 0; i < 96; i++)
+		ASSERT_EQ(nullptr, bm_GetBlock(&code[i * HostSize]));
+}
+
+TEST_F(BlockManagerTest, DISABLED_Benchmark)
+{
+	constexpr u32 BlockCount = 100'000;
+	constexpr u32 LookupCount = 1'000'000;
+	addBlocks(BlockCount);
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<size_t> dist(0, code.size() - 1);
+	std::vector<void *> lookups(LookupCount);
+	for (void *&p : lookups)
+		p = &code[dist(rng)];
+
+	auto start = std::chrono::steady_clock::now();
+	u32 found = 0;
+	for (void *p : lookups)
+		found += bm_GetBlock(p) != nullptr;
+	auto lookupTime = std::chrono::steady_clock::now() - start;
+	ASSERT_EQ(LookupCount, found);
+
+	start = std::chrono::steady_clock::now();
+	for (u32 addr = BaseAddress; addr < BaseAddress + BlockCount * GuestSize; addr += PAGE_SIZE)
+		bm_RamWriteAccess(addr);
+	auto writeTime = std::chrono::steady_clock::now() - start;
+	ASSERT_EQ(nullptr, bm_GetBlock(&code[0]));
+
+	printf("%u bm_GetBlock(void*) lookups: %.1f ns/lookup\n", LookupCount,
+			std::chrono::duration<double, std::nano>(lookupTime).count() / LookupCount);
+	printf("bm_RamWriteAccess on %u blocks: %.2f ms\n", BlockCount,
+			std::chrono::duration<double, std::milli>(writeTime).count());
+}
@@ -0,0 +1,371 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "emulator.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/sh4_interpreter.h"
+#include "serialize.h"
+#include <chrono>
+#include <functional>
+#include <random>
+
+// Linear scan scheduler used as a reference. Same algorithm as the original sh4_sched implementation.
+class LinearScheduler
+{
+public:
+	using Callback = std::function<int(int id, int remain, int jitter)>;
+
+	void resize(size_t size) {
+		list.resize(size);
+	}
+	void setCallback(int id, Callback cb) {
+		list[id].cb = cb;
+	}
+	u64 now64() const {
+		return ffb - next;
+	}
+
+	void request(int id, int cycles)
+	{
+		Entry& e = list[id];
+		e.start = now();
+		if (cycles == -1)
+			e.end = -1;
+		else
+		{
+			e.end = e.start + cycles;
+			if (e.end == -1)
+				e.end++;
+		}
+		ffts();
+	}
+
+	void advance(int cycles)
+	{
+		next -= cycles;
+		if (next >= 0)
+			return;
+		u32 fztime = now() - cycles;
+		if (nextId != -1)
+		{
+			for (size_t id = 0; id < list.size(); id++)
+			{
+				int remaining = this->remaining(list[id], fztime);
+				if (remaining >= 0 && remaining <= cycles)
+				{
+					Entry& e = list[id];
+					int remain = e.end - e.start;
+					int elapsed = now() - e.start;
+					int jitter = elapsed - remain;
+					e.start = now();
+					e.end = -1;
+					int re_sch = e.cb(id, remain, jitter);
+					if (re_sch > 0)
+						request(id, std::max(0, re_sch - jitter));
+				}
+			}
+		}
+		ffts();
+	}
+
+private:
+	struct Entry {
+		Callback cb;
+		int start = -1;
+		int end = -1;
+	};
+
+	u32 now() const {
+		return ffb - next;
+	}
+	static u32 remaining(const Entry& e, u32 reference) {
+		return e.end != -1 ? e.end - reference : -1;
+	}
+
+	void ffts()
+	{
+		u32 diff = -1;
+		int slot = -1;
+		for (size_t id = 0; id < list.size(); id++)
+		{
+			u32 remaining = this->remaining(list[id], now());
+			if (remaining < diff)
+			{
+				slot = id;
+				diff = remaining;
+			}
+		}
+		ffb -= next;
+		nextId = slot;
+		next = slot != -1 ? (int)diff : SH4_MAIN_CLOCK;
+		ffb += next;
+	}
+
+	std::vector<Entry> list;
+	u64 ffb = 0;
+	int next = 0;
+	int nextId = -1;
+};
+
+class Sh4SchedTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		// Unschedule all the hardware callbacks
+		sh4_sched_reset(true);
+		sh4_sched_ffts();
+	}
+
+	void TearDown() override
+	{
+		for (int id : ids)
+			sh4_sched_unregister(id);
+		ids.clear();
+		sh4_sched_reset(true);
+	}
+
+	struct Firing
+	{
+		int id;
+		u64 now;
+		int remain;
+		int jitter;
+		bool operator==(const Firing& other) const {
+			return id == other.id && now == other.now && remain == other.remain && jitter == other.jitter;
+		}
+	};
+
+	// Device-like behavior: reschedule itself with a random delay, and sometimes schedule or cancel another callback
+	struct Device
+	{
+		std::function<void(int id, int cycles)> request;
+		std::function<u64()> now;
+		std::vector<Firing> firings;
+		std::mt19937 rng{ 1234 };
+		const std::vector<int> *ids;
+
+		int fire(int id, int remain, int jitter)
+		{
+			firings.push_back({ id, now(), remain, jitter });
+			u32 r = rng();
+			if (r % 8 == 0)
+				request((*ids)[(r >> 3) % ids->size()], (r >> 8) % 3 == 0 ? 0 : (r >> 12) % 5000);
+			else if (r % 16 == 1)
+				request((*ids)[(r >> 4) % ids->size()], -1);
+			return r % 5 == 0 ? 0 : (int)((r >> 4) % 20000) + 1;
+		}
+	};
+
+	static int schedCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		Device *device = (Device *)arg;
+		return device->fire(tag, sch_cycl, jitter);
+	}
+
+	void registerCallbacks(int count, void *arg)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			// use the id as tag
+			int id = sh4_sched_register(0, schedCallback, arg);
+			sh4_sched_unregister(id);
+			ids.push_back(sh4_sched_register(id, schedCallback, arg));
+			ASSERT_EQ(id, ids.back());
+		}
+	}
+
+	static void advance(int cycles)
+	{
+		Sh4cntx.sh4_sched_next -= cycles;
+		if (Sh4cntx.sh4_sched_next < 0)
+			sh4_sched_tick(cycles);
+	}
+
+	std::vector<int> ids;
+};
+
+TEST_F(Sh4SchedTest, FiringOrder)
+{
+	Device device;
+	device.request = sh4_sched_request;
+	device.now = sh4_sched_now64;
+	device.ids = &ids;
+	registerCallbacks(12, &device);
+
+	LinearScheduler linear;
+	Device refDevice;
+	refDevice.request = [&linear](int id, int cycles) { linear.request(id, cycles); };
+	refDevice.now = [&linear]() { return linear.now64(); };
+	refDevice.ids = &ids;
+	linear.resize(*std::max_element(ids.begin(), ids.end()) + 1);
+	for (int id : ids)
+		linear.setCallback(id, [&refDevice](int id, int remain, int jitter) { return refDevice.fire(id, remain, jitter); });
+
+	std::mt19937 rng(42);
+	for (int i = 0; i < 100'000; i++)
+	{
+		// external requests
+		u32 r = rng();
+		if (r % 4 == 0)
+		{
+			int id = ids[(r >> 2) % ids.size()];
+			int cycles = (r >> 8) % 7 == 0 ? -1 : (r >> 8) % 30000;
+			sh4_sched_request(id, cycles);
+			linear.request(id, cycles);
+		}
+		advance(SH4_TIMESLICE);
+		linear.advance(SH4_TIMESLICE);
+		ASSERT_EQ(linear.now64(), sh4_sched_now64());
+	}
+	ASSERT_LT(10'000u, device.firings.size());
+	ASSERT_EQ(refDevice.firings.size(), device.firings.size());
+	for (size_t i = 0; i < device.firings.size(); i++)
+		ASSERT_EQ(refDevice.firings[i], device.firings[i]) << "firing " << i;
+}
+
+TEST_F(Sh4SchedTest, Serialize)
+{
+	Device device;
+	device.request = sh4_sched_request;
+	device.now = sh4_sched_now64;
+	device.ids = &ids;
+	registerCallbacks(4, &device);
+	sh4_sched_request(ids[0], 30000);
+	sh4_sched_request(ids[1], 10000);
+	sh4_sched_request(ids[2], 20000);
+	for (int i = 0; i < 3; i++)
+		advance(SH4_TIMESLICE);
+	ASSERT_EQ(0u, device.firings.size());
+	const int next = Sh4cntx.sh4_sched_next;
+
+	std::vector<u8> data(1024);
+	Serializer ser(data.data(), data.size());
+	for (int id : ids)
+		sh4_sched_serialize(ser, id);
+
+	sh4_sched_request(ids[1], -1);
+	sh4_sched_request(ids[3], 10);
+	ASSERT_FALSE(sh4_sched_is_scheduled(ids[1]));
+
+	Deserializer deser(data.data(), ser.size());
+	for (int id : ids)
+		sh4_sched_deserialize(deser, id);
+	sh4_sched_ffts();
+	ASSERT_EQ(next, Sh4cntx.sh4_sched_next);
+	ASSERT_TRUE(sh4_sched_is_scheduled(ids[1]));
+	ASSERT_FALSE(sh4_sched_is_scheduled(ids[3]));
+
+	advance(next + 1);
+	ASSERT_EQ(1u, device.firings.size());
+	ASSERT_EQ(ids[1], device.firings[0].id);
+}
+
+TEST_F(Sh4SchedTest, DISABLED_Benchmark)
+{
+	// Record a request trace from callbacks with typical hardware periods
+	struct Op {
+		int id;			// -1: advance one time slice
+		int cycles;
+	};
+	std::vector<Op> trace;
+	struct Recorder {
+		std::vector<Op> *trace;
+		std::mt19937 rng{ 5678 };
+	} recorder{ &trace };
+	// aica, rtc, spg line, render end, 3 tmu, gdrom, maple, aica dma, modem, elan
+	static const int periods[] = { 4535, SH4_MAIN_CLOCK, 12675, 250000, 12500, 50000, 1000000, 40000, 3333333, 2000, 100000, 30000 };
+	auto callback = [](int tag, int sch_cycl, int jitter, void *arg) -> int {
+		Recorder *rec = (Recorder *)arg;
+		int cycles = periods[tag];
+		// Random variation for irregular devices
+		if (tag >= 7)
+			cycles = cycles / 2 + rec->rng() % cycles;
+		rec->trace->push_back({ tag, cycles });
+		return cycles;
+	};
+	for (int i = 0; i < (int)std::size(periods); i++)
+	{
+		int id = sh4_sched_register(i, callback, &recorder);
+		ids.push_back(id);
+		sh4_sched_request(id, periods[i]);
+	}
+	// 10 emulated seconds
+	constexpr int TimeSlices = 10 * SH4_MAIN_CLOCK / SH4_TIMESLICE;
+	for (int i = 0; i < TimeSlices; i++)
+	{
+		// cpu-initiated requests (dma, register writes)
+		if (recorder.rng() % 64 == 0)
+		{
+			int tag = 7 + recorder.rng() % 5;
+			int cycles = recorder.rng() % 20000;
+			trace.push_back({ tag, cycles });
+			sh4_sched_request(ids[tag], cycles);
+		}
+		trace.push_back({ -1, SH4_TIMESLICE });
+		advance(SH4_TIMESLICE);
+	}
+	const size_t requests = std::count_if(trace.begin(), trace.end(), [](const Op& op) { return op.id != -1; });
+
+	// Replay it
+	sh4_sched_reset(true);
+	auto replay = [](int tag, int sch_cycl, int jitter, void *arg) { return 0; };
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		sh4_sched_unregister(ids[i]);
+		ASSERT_EQ(ids[i], sh4_sched_register(i, replay));
+		sh4_sched_request(ids[i], periods[i]);
+	}
+	auto start = std::chrono::steady_clock::now();
+	for (const Op& op : trace)
+	{
+		if (op.id == -1)
+			advance(op.cycles);
+		else
+			sh4_sched_request(ids[op.id], op.cycles);
+	}
+	auto heapTime = std::chrono::steady_clock::now() - start;
+
+	LinearScheduler linear;
+	linear.resize(*std::max_element(ids.begin(), ids.end()) + 1);
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		linear.setCallback(ids[i], [](int, int, int) { return 0; });
+		linear.request(ids[i], periods[i]);
+	}
+	start = std::chrono::steady_clock::now();
+	for (const Op& op : trace)
+	{
+		if (op.id == -1)
+			linear.advance(op.cycles);
+		else
+			linear.request(ids[op.id], op.cycles);
+	}
+	auto linearTime = std::chrono::steady_clock::now() - start;
+
+	printf("Replayed %zu requests and %zu time slices: sh4_sched %.1f ms, linear scan %.1f ms\n",
+			requests, trace.size() - requests,
+			std::chrono::duration<double, std::milli>(heapTime).count(),
+			std::chrono::duration<double, std::milli>(linearTime).count());
+}
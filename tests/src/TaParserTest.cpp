@@ -0,0 +1,304 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "emulator.h"
+#include "cfg/option.h"
+#include "hw/pvr/ta.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/Renderer_if.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <random>
+
+namespace
+{
+
+struct TestRenderer : public Renderer
+{
+	bool Init() override { return true; }
+	void Term() override {}
+	void Process(TA_context *ctx) override {}
+	bool Render() override { return true; }
+	void RenderFramebuffer(const FramebufferInfo& info) override {}
+
+	// Fake texture pointer, never dereferenced
+	BaseTextureCacheData *GetTexture(TSP tsp, TCW tcw) override {
+		return (BaseTextureCacheData *)(uintptr_t)((tsp.full * 31 + tcw.full) | 1);
+	}
+};
+
+}
+
+class TaParserTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		dc_reset(true);
+		renderer = &testRenderer;
+	}
+
+	void TearDown() override
+	{
+		renderer = nullptr;
+		config::ParallelTAParsing = false;
+	}
+
+	// Appends a 32-byte TA command
+	u32 *addCommand(u32 paramType, u32 listType = 0)
+	{
+		size_t offset = data.size();
+		data.resize(offset + 8);
+		for (size_t i = offset + 1; i < data.size(); i++)
+			data[i] = rng();
+		PCW pcw{};
+		pcw.ParaType = paramType;
+		pcw.ListType = listType;
+		pcw.User_Clip = rng() & 3;
+		data[offset] = pcw.full;
+		return &data[offset];
+	}
+
+	void addPolyList(u32 listType, u32 polyCount)
+	{
+		for (u32 i = 0; i < polyCount; i++)
+		{
+			const u32 kind = rng() % 64;
+			if (kind == 0)
+			{
+				u32 *tileClip = addCommand(ParamType_User_Tile_Clip);
+				tileClip[3] = rng() & 63;
+				tileClip[5] = tileClip[3] + (rng() & 7);
+				continue;
+			}
+			if (kind == 1)
+			{
+				addCommand(ParamType_Object_List_Set);
+				continue;
+			}
+			if (kind < 8)
+			{
+				// Sprite
+				addCommand(ParamType_Sprite, listType);
+				u32 *vertex = addCommand(ParamType_Vertex_Parameter);
+				((PCW *)vertex)->EndOfStrip = 1;
+				addCommand(rng() & 7);	// random second half
+				continue;
+			}
+			u32 *param = addCommand(ParamType_Polygon_or_Modifier_Volume, listType);
+			PCW& pcw = *(PCW *)param;
+			pcw.obj_ctrl = rng();
+			pcw.Shadow = 0;
+			const u32 uid = TaTypeLut::instance().table[pcw.obj_ctrl];
+			if (uid == TaTypeLut::INVALID_TYPE)
+				continue;
+			if ((uid >> 30) == SZ64)
+				addCommand(rng() & 7);
+			const u32 pdid = (u8)uid;
+			const bool vertex64 = pdid == 5 || pdid == 6 || pdid >= 11;
+			const u32 strips = 1 + rng() % 3;
+			for (u32 strip = 0; strip < strips; strip++)
+			{
+				const u32 vertices = 3 + rng() % 8;
+				for (u32 v = 0; v < vertices; v++)
+				{
+					u32 *vertex = addCommand(ParamType_Vertex_Parameter);
+					((PCW *)vertex)->EndOfStrip = v == vertices - 1;
+					if (vertex64)
+						addCommand(rng() & 7);
+				}
+			}
+		}
+	}
+
+	void addModVolList(u32 listType, u32 volumeCount)
+	{
+		for (u32 i = 0; i < volumeCount; i++)
+		{
+			addCommand(ParamType_Polygon_or_Modifier_Volume, listType);
+			const u32 triangles = 1 + rng() % 8;
+			for (u32 t = 0; t < triangles; t++)
+			{
+				addCommand(ParamType_Vertex_Parameter);
+				addCommand(rng() & 7);
+			}
+		}
+	}
+
+	void generateFrame(u32 seed)
+	{
+		rng.seed(seed);
+		data.clear();
+		constexpr u32 listTypes[] {
+			ListType_Opaque, ListType_Opaque_Modifier_Volume, ListType_Translucent,
+			ListType_Translucent_Modifier_Volume, ListType_Punch_Through
+		};
+		const u32 lists = 3 + rng() % 10;
+		for (u32 i = 0; i < lists; i++)
+		{
+			const u32 listType = listTypes[rng() % std::size(listTypes)];
+			if (IsModVolList(listType))
+				addModVolList(listType, 10 + rng() % 100);
+			else
+				addPolyList(listType, 10 + rng() % 2000);
+			// Last list may not be terminated
+			if (i != lists - 1 || (seed & 3) != 0)
+				addCommand(ParamType_End_Of_List);
+		}
+		if (seed % 8 == 5)
+			// Invalid parameter type
+			data[(rng() % (data.size() / 8)) * 8] = ParamType_Reserved_1 << 29;
+	}
+
+	// Each pass gets part of the data
+	void createContexts(u32 passes)
+	{
+		contexts.clear();
+		for (u32 i = 0; i < passes; i++)
+		{
+			contexts.push_back(std::make_unique<TA_context>());
+			TA_context& ctx = *contexts.back();
+			ctx.Alloc();
+			ctx.tad.reserve(TA_DATA_SIZE);
+			const size_t begin = data.size() / 8 * i / passes * 8;
+			const size_t end = data.size() / 8 * (i + 1) / passes * 8;
+			memcpy(ctx.tad.thd_root, &data[begin], (end - begin) * 4);
+			ctx.tad.thd_data = ctx.tad.thd_root + (end - begin) * 4;
+			if (i > 0)
+				contexts[i - 1]->nextContext = &ctx;
+		}
+	}
+
+	void parse(bool parallel)
+	{
+		config::ParallelTAParsing = parallel;
+		contexts[0]->rend.Clear();
+		ta_parse(contexts[0].get(), false);
+	}
+
+	static void assertEqual(const std::vector<PolyParam>& expected, const std::vector<PolyParam>& actual)
+	{
+		ASSERT_EQ(expected.size(), actual.size());
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			const PolyParam& e = expected[i];
+			const PolyParam& a = actual[i];
+			ASSERT_EQ(e.first, a.first) << "poly " << i;
+			ASSERT_EQ(e.count, a.count) << "poly " << i;
+			ASSERT_EQ(e.texture, a.texture) << "poly " << i;
+			ASSERT_EQ(e.tsp.full, a.tsp.full) << "poly " << i;
+			ASSERT_EQ(e.tcw.full, a.tcw.full) << "poly " << i;
+			ASSERT_EQ(e.pcw.full, a.pcw.full) << "poly " << i;
+			ASSERT_EQ(e.isp.full, a.isp.full) << "poly " << i;
+			ASSERT_EQ(e.tileclip, a.tileclip) << "poly " << i;
+			ASSERT_EQ(e.tsp1.full, a.tsp1.full) << "poly " << i;
+			ASSERT_EQ(e.tcw1.full, a.tcw1.full) << "poly " << i;
+			ASSERT_EQ(e.texture1, a.texture1) << "poly " << i;
+		}
+	}
+
+	static void assertEqual(const std::vector<ModifierVolumeParam>& expected, const std::vector<ModifierVolumeParam>& actual)
+	{
+		ASSERT_EQ(expected.size(), actual.size());
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			ASSERT_EQ(expected[i].first, actual[i].first) << "modvol " << i;
+			ASSERT_EQ(expected[i].count, actual[i].count) << "modvol " << i;
+			ASSERT_EQ(expected[i].isp.full, actual[i].isp.full) << "modvol " << i;
+			ASSERT_EQ(expected[i].tileclip, actual[i].tileclip) << "modvol " << i;
+		}
+	}
+
+	template<typename T>
+	static void assertSameBytes(const std::vector<T>& expected, const std::vector<T>& actual)
+	{
+		ASSERT_EQ(expected.size(), actual.size());
+		if (!expected.empty())
+			ASSERT_EQ(0, memcmp(expected.data(), actual.data(), expected.size() * sizeof(T)));
+	}
+
+	static void assertEqual(const rend_context& expected, const rend_context& actual)
+	{
+		assertSameBytes(expected.verts, actual.verts);
+		ASSERT_EQ(expected.idx, actual.idx);
+		assertSameBytes(expected.modtrig, actual.modtrig);
+		assertEqual(expected.global_param_op, actual.global_param_op);
+		assertEqual(expected.global_param_pt, actual.global_param_pt);
+		assertEqual(expected.global_param_tr, actual.global_param_tr);
+		assertEqual(expected.global_param_mvo, actual.global_param_mvo);
+		assertEqual(expected.global_param_mvo_tr, actual.global_param_mvo_tr);
+		assertSameBytes(expected.sortedTriangles, actual.sortedTriangles);
+		ASSERT_EQ(expected.render_passes.size(), actual.render_passes.size());
+		for (size_t i = 0; i < expected.render_passes.size(); i++)
+		{
+			const RenderPass& e = expected.render_passes[i];
+			const RenderPass& a = actual.render_passes[i];
+			ASSERT_EQ(e.op_count, a.op_count);
+			ASSERT_EQ(e.pt_count, a.pt_count);
+			ASSERT_EQ(e.tr_count, a.tr_count);
+			ASSERT_EQ(e.mvo_count, a.mvo_count);
+			ASSERT_EQ(e.mvo_tr_count, a.mvo_tr_count);
+			ASSERT_EQ(e.sorted_tr_count, a.sorted_tr_count);
+		}
+		float expectedZ = expected.fZ_max;
+		float actualZ = actual.fZ_max;
+		ASSERT_EQ((u32&)expectedZ, (u32&)actualZ);
+	}
+
+	std::mt19937 rng;
+	std::vector<u32> data;
+	std::vector<std::unique_ptr<TA_context>> contexts;
+	TestRenderer testRenderer;
+};
+
+TEST_F(TaParserTest, SameAsSerial)
+{
+	for (u32 seed = 0; seed < 40; seed++)
+	{
+		SCOPED_TRACE("seed " + std::to_string(seed));
+		generateFrame(seed);
+		createContexts(1 + seed % 3);
+		parse(false);
+		rend_context expected = contexts[0]->rend;
+		parse(true);
+		assertEqual(expected, contexts[0]->rend);
+	}
+}
+
+TEST_F(TaParserTest, DISABLED_Benchmark)
+{
+	generateFrame(1001);
+	createContexts(1);
+	for (bool parallel : { false, true })
+	{
+		constexpr int Frames = 50;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Frames; i++)
+			parse(parallel);
+		double time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Frames;
+		printf("%s parsing: %.0f us per frame, %d vertices\n", parallel ? "Parallel" : "Serial", time,
+				(int)contexts[0]->rend.verts.size());
+	}
+}
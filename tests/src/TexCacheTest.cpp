@@ -0,0 +1,179 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "hw/pvr/pvr_mem.h"
+#include "hw/pvr/Renderer_if.h"
+#include "emulator.h"
+#include "oslib/oslib.h"
+#include "rend/TexCache.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace
+{
+
+class TestTexture final : public BaseTextureCacheData
+{
+public:
+	TestTexture(TSP tsp, TCW tcw) : BaseTextureCacheData(tsp, tcw) {
+	}
+	TestTexture(TestTexture&& other) : BaseTextureCacheData(std::move(other)) {
+		std::swap(data, other.data);
+	}
+
+	std::string GetId() override { return std::to_string(startAddress); }
+	void UploadToGPU(int width, int height, const u8 *buffer, bool mipmapped, bool mipmapsIncluded = false) override {
+		// 16-bit textures only
+		data.assign(buffer, buffer + width * height * 2);
+	}
+
+	std::vector<u8> data;
+};
+
+class TestTextureCache final : public BaseTextureCache<TestTexture>
+{
+};
+
+}
+
+class TexCacheTest : public ::testing::Test
+{
+protected:
+	// 32x32 565 twiddled textures. Pages are shared by several textures and contain unused gaps.
+	static constexpr u32 TextureCount = 64;
+	static constexpr u32 TextureSize = 32 * 32 * 2;
+	static constexpr u32 TextureStride = TextureSize + 1024;
+	static constexpr u32 RegionSize = TextureCount * TextureStride;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		dc_reset(true);
+		// Normally installed at startup
+		os_InstallFaultHandler();
+		if (FrameCount == 0)
+			FrameCount = 1;
+		std::mt19937 rng(42);
+		for (u32 i = 0; i < RegionSize; i++)
+			vram[i] = rng();
+	}
+
+	void TearDown() override
+	{
+		cache.Clear();
+		addrspace::unprotectVram(0, VRAM_SIZE);
+		os_UninstallFaultHandler();
+	}
+
+	static TSP getTsp()
+	{
+		TSP tsp{};
+		tsp.TexU = 2;	// 32
+		tsp.TexV = 2;
+		return tsp;
+	}
+
+	static TCW getTcw(u32 index)
+	{
+		TCW tcw{};
+		tcw.TexAddr = index * TextureStride >> 3;
+		tcw.PixelFmt = Pixel565;
+		return tcw;
+	}
+
+	void renderFrame()
+	{
+		for (u32 i = 0; i < TextureCount; i++)
+		{
+			TestTexture *texture = cache.getTextureCacheData(getTsp(), getTcw(i));
+			if (texture->NeedsUpdate())
+				texture->Update();
+		}
+		FrameCount++;
+	}
+
+	TestTextureCache cache;
+};
+
+// Writes to vram from another thread while textures are looked up and decoded.
+// Once all writes are done, the cached textures must match the vram contents.
+TEST_F(TexCacheTest, WriteStress)
+{
+	std::atomic<bool> stop{ false };
+	std::atomic<u32> writes{ 0 };
+	std::thread writer([&]() {
+		std::mt19937 rng(1234);
+		while (!stop)
+		{
+			u32 offset = rng() % RegionSize;
+			*(volatile u8 *)&vram[offset] = rng();
+			writes++;
+			if ((writes & 0xff) == 0)
+				std::this_thread::yield();
+		}
+	});
+
+	const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+	while (std::chrono::steady_clock::now() < end)
+		renderFrame();
+	stop = true;
+	writer.join();
+	renderFrame();
+
+	for (u32 i = 0; i < TextureCount; i++)
+	{
+		TestTexture *texture = cache.getTextureCacheData(getTsp(), getTcw(i));
+		ASSERT_FALSE(texture->NeedsUpdate()) << "texture " << i;
+		TestTexture expected{ getTsp(), getTcw(i) };
+		expected.Update();
+		expected.Delete();
+		ASSERT_EQ(expected.data, texture->data) << "texture " << i;
+	}
+	ASSERT_NE(0u, writes.load());
+}
+
+// Writing between textures mustn't invalidate them
+TEST_F(TexCacheTest, WriteOutsideTextures)
+{
+	renderFrame();
+	std::vector<std::vector<u8>> initial;
+	for (u32 i = 0; i < TextureCount; i++)
+		initial.push_back(cache.getTextureCacheData(getTsp(), getTcw(i))->data);
+
+	for (u32 i = 0; i < TextureCount; i++)
+		vram[i * TextureStride + TextureSize + 512] ^= 0xff;
+	processVramWrites();
+	for (u32 i = 0; i < TextureCount; i++)
+	{
+		TestTexture *texture = cache.getTextureCacheData(getTsp(), getTcw(i));
+		ASSERT_FALSE(texture->NeedsUpdate()) << "texture " << i;
+		ASSERT_EQ(initial[i], texture->data) << "texture " << i;
+	}
+
+	vram[5 * TextureStride] ^= 0xff;
+	ASSERT_TRUE(cache.getTextureCacheData(getTsp(), getTcw(5))->NeedsUpdate());
+	ASSERT_FALSE(cache.getTextureCacheData(getTsp(), getTcw(4))->NeedsUpdate());
+	ASSERT_FALSE(cache.getTextureCacheData(getTsp(), getTcw(6))->NeedsUpdate());
+}
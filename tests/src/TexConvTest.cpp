@@ -0,0 +1,170 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/TexCache.h"
+#include <chrono>
+#include <random>
+
+class TexConvTest : public ::testing::Test
+{
+protected:
+	template<typename Pixel>
+	using ConvFP = void (*)(PixelBuffer<Pixel> *pb, const u8 *p_in, u32 width, u32 height);
+
+	template<typename Pixel>
+	struct Converter
+	{
+		const char *name;
+		ConvFP<Pixel> reference;
+		ConvFP<Pixel> converter;
+		bool mipmaps;
+	};
+
+	void SetUp() override
+	{
+		std::mt19937 rng(42);
+		input.resize(1024 * 1024 * 2);
+		for (u8& b : input)
+			b = rng();
+		for (u8& b : codebook)
+			b = rng();
+		vq_codebook = codebook;
+	}
+
+	template<typename Pixel>
+	void checkConverter(const Converter<Pixel>& conv, u32 width, u32 height, bool mipmapped = false)
+	{
+		PixelBuffer<Pixel> expected;
+		PixelBuffer<Pixel> actual;
+		const size_t size = PixelBuffer<Pixel>::size(width, height, mipmapped);
+		if (mipmapped)
+		{
+			// Mipmap levels are converted separately in a single buffer
+			expected.init(width, height, true);
+			actual.init(width, height, true);
+			memset(expected.data(), 0, size);
+			memset(actual.data(), 0, size);
+			for (u32 i = 0; (1u << i) <= width; i++)
+			{
+				expected.set_mipmap(i);
+				actual.set_mipmap(i);
+				conv.reference(&expected, input.data(), 1 << i, 1 << i);
+				conv.converter(&actual, input.data(), 1 << i, 1 << i);
+			}
+			expected.set_mipmap(0);
+			actual.set_mipmap(0);
+		}
+		else
+		{
+			expected.init(width, height);
+			actual.init(width, height);
+			memset(expected.data(), 0, size);
+			memset(actual.data(), 0, size);
+			conv.reference(&expected, input.data(), width, height);
+			conv.converter(&actual, input.data(), width, height);
+		}
+		ASSERT_EQ(0, memcmp(expected.data(), actual.data(), size))
+				<< conv.name << " " << width << "x" << height << (mipmapped ? " mipmapped" : "");
+	}
+
+	template<typename Pixel>
+	void checkAll(const std::vector<Converter<Pixel>>& converters)
+	{
+		for (const auto& conv : converters)
+		{
+			for (u32 width = 8; width <= 1024; width *= 2)
+				for (u32 height = 8; height <= 1024; height *= 2)
+					checkConverter(conv, width, height);
+			// Mipmap levels go down to 1x1
+			if (conv.mipmaps)
+				for (u32 size = 8; size <= 512; size *= 2)
+					checkConverter(conv, size, size, true);
+		}
+	}
+
+	template<typename Pixel>
+	double benchmark(ConvFP<Pixel> converter, u32 size)
+	{
+		PixelBuffer<Pixel> pb;
+		pb.init(size, size);
+		// Convert about 4M pixels
+		const u32 iterations = std::max(1u, 4 * 1024 * 1024 / (size * size));
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < iterations; i++)
+			converter(&pb, input.data(), size, size);
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations / (size * size);
+	}
+
+	template<typename Pixel>
+	void benchmarkAll(const std::vector<Converter<Pixel>>& converters)
+	{
+		for (const auto& conv : converters)
+		{
+			printf("%-14s", conv.name);
+			for (u32 size = 8; size <= 1024; size *= 2)
+			{
+				double refTime = benchmark(conv.reference, size);
+				double time = benchmark(conv.converter, size);
+				printf(" %4d: %.2f/%.2f", size, refTime, time);
+			}
+			printf(" ns/pixel\n");
+		}
+	}
+
+	std::vector<Converter<u16>> converters16 {
+		{ "565 TW", texture_TW<ConvertTwiddle<UnpackerNop<u16>>>, tex565_TW, true },
+		{ "1555 TW", texture_TW<ConvertTwiddle<Unpacker1555>>, opengl::tex1555_TW, true },
+		{ "4444 TW", texture_TW<ConvertTwiddle<Unpacker4444>>, opengl::tex4444_TW, true },
+		{ "565 VQ", texture_VQ<ConvertTwiddle<UnpackerNop<u16>>>, tex565_VQ, true },
+		{ "1555 VQ", texture_VQ<ConvertTwiddle<Unpacker1555>>, opengl::tex1555_VQ, true },
+		{ "4444 VQ", texture_VQ<ConvertTwiddle<Unpacker4444>>, opengl::tex4444_VQ, true },
+	};
+	std::vector<Converter<u32>> converters32 {
+		{ "565 PL32", texture_PL<ConvertPlanar<Unpacker565_32<RGBAPacker>>>, opengl::tex565_PL32, false },
+		{ "1555 PL32", texture_PL<ConvertPlanar<Unpacker1555_32<RGBAPacker>>>, opengl::tex1555_PL32, false },
+		{ "4444 PL32", texture_PL<ConvertPlanar<Unpacker4444_32<RGBAPacker>>>, opengl::tex4444_PL32, false },
+		{ "565 TW32", texture_TW<ConvertTwiddle<Unpacker565_32<RGBAPacker>>>, opengl::tex565_TW32, true },
+		{ "1555 TW32", texture_TW<ConvertTwiddle<Unpacker1555_32<RGBAPacker>>>, opengl::tex1555_TW32, true },
+		{ "4444 TW32", texture_TW<ConvertTwiddle<Unpacker4444_32<RGBAPacker>>>, opengl::tex4444_TW32, true },
+		{ "565 TW32 DX", texture_TW<ConvertTwiddle<Unpacker565_32<BGRAPacker>>>, directx::tex565_TW32, true },
+		{ "1555 TW32 DX", texture_TW<ConvertTwiddle<Unpacker1555_32<BGRAPacker>>>, directx::tex1555_TW32, true },
+		{ "4444 TW32 DX", texture_TW<ConvertTwiddle<Unpacker4444_32<BGRAPacker>>>, directx::tex4444_TW32, true },
+		{ "565 VQ32", texture_VQ<ConvertTwiddle<Unpacker565_32<RGBAPacker>>>, opengl::tex565_VQ32, true },
+		{ "1555 VQ32", texture_VQ<ConvertTwiddle<Unpacker1555_32<RGBAPacker>>>, opengl::tex1555_VQ32, true },
+		{ "4444 VQ32", texture_VQ<ConvertTwiddle<Unpacker4444_32<RGBAPacker>>>, opengl::tex4444_VQ32, true },
+		{ "1555 VQ32 DX", texture_VQ<ConvertTwiddle<Unpacker1555_32<BGRAPacker>>>, directx::tex1555_VQ32, true },
+	};
+
+	std::vector<u8> input;
+	u8 codebook[VQ_CODEBOOK_SIZE];
+};
+
+TEST_F(TexConvTest, BitExact)
+{
+	checkAll(converters16);
+	checkAll(converters32);
+}
+
+TEST_F(TexConvTest, DISABLED_Benchmark)
+{
+	printf("Scalar/optimized conversion time\n");
+	benchmarkAll(converters16);
+	benchmarkAll(converters32);
+}
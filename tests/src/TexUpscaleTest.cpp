@@ -0,0 +1,85 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/TexCache.h"
+#include "deps/xbrz/xbrz.h"
+#include <chrono>
+#include <random>
+
+class TexUpscaleTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// Flat areas with some noise, closer to actual textures than random pixels
+		std::mt19937 rng(42);
+		source.resize(512 * 512);
+		for (size_t i = 0; i < source.size(); i++)
+			source[i] = (rng() % 8) == 0 || i == 0 ? rng() : source[i - 1];
+	}
+
+	static void reference(int factor, const u32 *src, u32 *dest, int width, int height, bool hasAlpha)
+	{
+		xbrz::ScalerCfg cfg;
+		xbrz::scale(factor, src, dest, width, height, hasAlpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB, cfg);
+	}
+
+	std::vector<u32> source;
+};
+
+// Upscaling in slices must give the same result as a single pass
+TEST_F(TexUpscaleTest, SameAsSinglePass)
+{
+	for (int factor = 2; factor <= 6; factor++)
+		for (int width = 8; width <= 256; width *= 2)
+			for (int height = 8; height <= 256; height *= 4)
+				for (bool hasAlpha : { false, true })
+				{
+					std::vector<u32> single(width * height * factor * factor);
+					std::vector<u32> sliced(single.size());
+					reference(factor, source.data(), single.data(), width, height, hasAlpha);
+					UpscalexBRZ(factor, source.data(), sliced.data(), width, height, hasAlpha);
+					ASSERT_EQ(single, sliced) << "x" << factor << " " << width << "x" << height << (hasAlpha ? " alpha" : "");
+				}
+}
+
+TEST_F(TexUpscaleTest, DISABLED_Benchmark)
+{
+	printf("Single pass/job queue upscaling x2\n");
+	for (int size = 8; size <= 512; size *= 2)
+	{
+		std::vector<u32> dest(size * size * 4);
+		// Upscale about 1M pixels
+		const int iterations = std::max(1, 1024 * 1024 / (size * size));
+		double times[2];
+		for (int sliced = 0; sliced < 2; sliced++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++)
+				if (sliced)
+					UpscalexBRZ(2, source.data(), dest.data(), size, size, true);
+				else
+					reference(2, source.data(), dest.data(), size, size, true);
+			times[sliced] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		const double pixels = (double)iterations * size * size / 1000000.0;
+		printf("%4d: %.1f/%.1f Mpixels/s\n", size, pixels / times[0], pixels / times[1]);
+	}
+}
@@ -0,0 +1,180 @@
+/*
+	Copyright 2026 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+#include "types.h"
+#include "archive/rzip.h"
+#include "archive/zstdchunk.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+class ZstdChunkTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// About the size of a Dreamcast savestate. Runs of bytes with some noise.
+		std::mt19937 rng(42);
+		data.resize(28_MB + 1234);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = (rng() % 16) == 0 || i == 0 ? rng() : data[i - 1];
+		path = ::testing::TempDir() + "zstdchunk.bin";
+	}
+
+	void TearDown() override {
+		std::remove(path.c_str());
+	}
+
+	// Writes a prefix then the stream
+	void write(int level)
+	{
+		FILE *f = std::fopen(path.c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		std::fputs("prefix", f);
+		ZstdChunkFile file;
+		ASSERT_TRUE(file.Open(f, true, level));
+		ASSERT_EQ(1000u, file.Write(data.data(), 1000));
+		ASSERT_EQ(data.size() - 1000, file.Write(&data[1000], data.size() - 1000));
+		ASSERT_TRUE(file.Close());
+	}
+
+	void open(ZstdChunkFile& file)
+	{
+		FILE *f = std::fopen(path.c_str(), "rb");
+		ASSERT_NE(nullptr, f);
+		std::fseek(f, 6, SEEK_SET);
+		ASSERT_TRUE(file.Open(f, false));
+		ASSERT_EQ(data.size(), file.Size());
+	}
+
+	std::vector<u8> data;
+	std::string path;
+};
+
+TEST_F(ZstdChunkTest, ReadWrite)
+{
+	write(ZstdChunkFile::Fast);
+	ZstdChunkFile file;
+	open(file);
+	std::vector<u8> read(data.size());
+	ASSERT_EQ(read.size(), file.Read(read.data(), read.size()));
+	ASSERT_EQ(data, read);
+	ASSERT_EQ(0u, file.Read(read.data(), 1));
+}
+
+TEST_F(ZstdChunkTest, RandomAccess)
+{
+	write(ZstdChunkFile::Fast);
+	ZstdChunkFile file;
+	open(file);
+	std::mt19937 rng(1);
+	for (int i = 0; i < 100; i++)
+	{
+		const size_t offset = rng() % data.size();
+		const size_t length = rng() % (3 * ZstdChunkFile::ChunkSize);
+		std::vector<u8> read(length);
+		file.Seek(offset);
+		const size_t size = file.Read(read.data(), length);
+		ASSERT_EQ(std::min(length, data.size() - offset), size) << "offset " << offset << " length " << length;
+		ASSERT_EQ(0, memcmp(read.data(), &data[offset], size)) << "offset " << offset << " length " << length;
+		// sequential read
+		if (offset + size < data.size())
+		{
+			u8 next;
+			ASSERT_EQ(1u, file.Read(&next, 1));
+			ASSERT_EQ(data[offset + size], next);
+		}
+	}
+}
+
+// A corrupted index is rejected before being allocated
+TEST_F(ZstdChunkTest, InvalidChunkCount)
+{
+	write(ZstdChunkFile::Fast);
+	FILE *f = std::fopen(path.c_str(), "r+b");
+	ASSERT_NE(nullptr, f);
+	// chunkCount in the header following the prefix
+	std::fseek(f, 6 + 32, SEEK_SET);
+	const u32 chunkCount = 0xffffffff;
+	ASSERT_EQ(1u, std::fwrite(&chunkCount, sizeof(chunkCount), 1, f));
+	std::fseek(f, 6, SEEK_SET);
+	ZstdChunkFile file;
+	ASSERT_FALSE(file.Open(f, false));
+	ASSERT_EQ(6, std::ftell(f));
+	std::fclose(f);
+}
+
+// Other files are left untouched
+TEST_F(ZstdChunkTest, NotZstd)
+{
+	RZipFile rzip;
+	ASSERT_TRUE(rzip.Open(path, true));
+	ASSERT_EQ(data.size(), rzip.Write(data.data(), data.size()));
+	rzip.Close();
+
+	FILE *f = std::fopen(path.c_str(), "rb");
+	ASSERT_NE(nullptr, f);
+	ZstdChunkFile file;
+	ASSERT_FALSE(file.Open(f, false));
+	ASSERT_EQ(0, std::ftell(f));
+	std::fclose(f);
+}
+
+TEST_F(ZstdChunkTest, DISABLED_Benchmark)
+{
+	using clock = std::chrono::steady_clock;
+	const double megabytes = data.size() / 1024.0 / 1024.0;
+	std::vector<u8> read(data.size());
+	printf("%-12s %10s %10s %10s\n", "Format", "Save MB/s", "Load MB/s", "Size MB");
+
+	auto start = clock::now();
+	RZipFile rzip;
+	ASSERT_TRUE(rzip.Open(path, true));
+	ASSERT_EQ(data.size(), rzip.Write(data.data(), data.size()));
+	rzip.Close();
+	double saveTime = std::chrono::duration<double>(clock::now() - start).count();
+	start = clock::now();
+	ASSERT_TRUE(rzip.Open(path, false));
+	ASSERT_EQ(data.size(), rzip.Read(read.data(), read.size()));
+	FILE *f = rzip.rawFile();
+	std::fseek(f, 0, SEEK_END);
+	const long rzipSize = std::ftell(f);
+	rzip.Close();
+	double loadTime = std::chrono::duration<double>(clock::now() - start).count();
+	printf("%-12s %10.0f %10.0f %10.1f\n", "rzip", megabytes / saveTime, megabytes / loadTime, rzipSize / 1024.0 / 1024.0);
+
+	for (int level : { ZstdChunkFile::Fast, ZstdChunkFile::Small })
+	{
+		start = clock::now();
+		write(level);
+		saveTime = std::chrono::duration<double>(clock::now() - start).count();
+		start = clock::now();
+		ZstdChunkFile file;
+		open(file);
+		ASSERT_EQ(data.size(), file.Read(read.data(), read.size()));
+		f = file.rawFile();
+		std::fseek(f, 0, SEEK_END);
+		const long size = std::ftell(f);
+		file.Close();
+		loadTime = std::chrono::duration<double>(clock::now() - start).count();
+		printf("%-12s %10.0f %10.0f %10.1f\n", level == ZstdChunkFile::Fast ? "zstd fast" : "zstd small",
+				megabytes / saveTime, megabytes / loadTime, size / 1024.0 / 1024.0);
+	}
+}
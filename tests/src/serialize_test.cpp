@@ -3,8 +3,13 @@
 #include "hw/mem/addrspace.h"
 #include "hw/maple/maple_cfg.h"
 #include "hw/maple/maple_devs.h"
+#include "hw/maple/maple_if.h"
+#include "hw/mem/mem_watch.h"
 #include "emulator.h"
 #include "cfg/option.h"
+#include "oslib/oslib.h"
+#include "stdclass.h"
+#include <nowide/cstdio.hpp>
 
 class SerializeTest : public ::testing::Test {
 protected:
@@ -35,5 +40,136 @@ TEST_F(SerializeTest, SizeTest)
 	ASSERT_EQ(28191434u, ser.size());
 }
 
+// Pages written since the last incremental savestate
+TEST_F(SerializeTest, DirtyPages)
+{
+	config::IncrementalSavestates = true;
+	os_InstallFaultHandler();
+	memwatch::reset();
+	memwatch::protect();
+	ASSERT_TRUE(memwatch::watching);
+
+	mem_b[PAGE_SIZE * 5 + 12] = 1;
+	mem_b[PAGE_SIZE * 2] = 1;
+	mem_b[PAGE_SIZE * 5 + 13] = 1;
+	vram[PAGE_SIZE * 3 + 1] = 1;
+	aica::aica_ram[PAGE_SIZE - 1] = 1;
+	// Written pages are protected again when saving
+	memwatch::protect();
+	std::vector<u32> pages;
+	memwatch::ramWatcher.getDirtyPages(pages);
+	ASSERT_EQ((std::vector<u32>{ PAGE_SIZE * 2, PAGE_SIZE * 5 }), pages);
+	memwatch::vramWatcher.getDirtyPages(pages);
+	ASSERT_EQ((std::vector<u32>{ PAGE_SIZE * 3 }), pages);
+	memwatch::aramWatcher.getDirtyPages(pages);
+	ASSERT_EQ((std::vector<u32>{ 0 }), pages);
+
+	mem_b[PAGE_SIZE * 5] = 3;
+	memwatch::ramWatcher.getDirtyPages(pages);
+	ASSERT_EQ((std::vector<u32>{ PAGE_SIZE * 5 }), pages);
+	ASSERT_EQ(3, mem_b[PAGE_SIZE * 5]);
+
+	// Pages written again before being protected are only reported once
+	memwatch::protect();
+	mem_b[PAGE_SIZE * 7] = 1;
+	memwatch::protect();
+	mem_b[PAGE_SIZE * 7] = 2;
+	memwatch::ramWatcher.getDirtyPages(pages);
+	ASSERT_EQ((std::vector<u32>{ PAGE_SIZE * 7 }), pages);
+
+	memwatch::unprotect();
+	memwatch::reset();
+	os_UninstallFaultHandler();
+	config::IncrementalSavestates = false;
+}
 
+// Rollback state unchanged since the snapshot isn't deserialized
+TEST_F(SerializeTest, SkipUnchanged)
+{
+	std::vector<u8> data(30_MB);
+	Serializer ser(data.data(), data.size(), true);
+	u32 a = 1;
+	u32 b = 2;
+	ser << a;
+	ser << b;
+	dc_serialize(ser);
+
+	b = 3;
+	Deserializer deser(data.data(), ser.size(), true);
+	ASSERT_FALSE(deser.deserializeChanged(a));
+	ASSERT_TRUE(deser.deserializeChanged(b));
+	ASSERT_EQ(2u, b);
+	dc_deserialize(deser);
+	ASSERT_EQ(ser.size(), deser.size());
+
+	Deserializer full(data.data(), ser.size());
+	ASSERT_TRUE(full.deserializeChanged(a));
+	ASSERT_EQ(1u, a);
+}
 
+// Incremental savestates are loaded on top of their base savestate
+TEST_F(SerializeTest, DeltaRoundTrip)
+{
+	config::IncrementalSavestates = true;
+	os_InstallFaultHandler();
+	settings.content.fileName = "serialize_test";
+	const std::string path = hostfs::getSavestatePath(0, true);
+	const std::string deltaPath = path + ".delta";
+	nowide::remove(path.c_str());
+	nowide::remove(deltaPath.c_str());
+
+	mem_b[PAGE_SIZE * 3] = 1;
+	vram[PAGE_SIZE] = 1;
+	dc_savestate(0);
+	mem_b[PAGE_SIZE * 3] = 2;
+	aica::aica_ram[PAGE_SIZE * 2] = 2;
+	dc_savestate(0);
+	ASSERT_TRUE(file_exists(deltaPath));
+	mem_b[PAGE_SIZE * 3] = 3;
+	aica::aica_ram[PAGE_SIZE * 2] = 3;
+	dc_savestate(0);
+
+	mem_b[PAGE_SIZE * 3] = 0;
+	vram[PAGE_SIZE] = 0;
+	aica::aica_ram[PAGE_SIZE * 2] = 0;
+	dc_loadstate(0);
+	ASSERT_EQ(3, mem_b[PAGE_SIZE * 3]);
+	ASSERT_EQ(1, vram[PAGE_SIZE]);
+	ASSERT_EQ(3, aica::aica_ram[PAGE_SIZE * 2]);
+
+	// Reconnecting the maple devices requires a new base savestate
+	mem_b[PAGE_SIZE * 3] = 4;
+	maple_ReconnectDevices();
+	dc_savestate(0);
+	mem_b[PAGE_SIZE * 3] = 0;
+	dc_loadstate(0);
+	ASSERT_FALSE(file_exists(deltaPath));
+	ASSERT_EQ(4, mem_b[PAGE_SIZE * 3]);
+
+	memwatch::unprotect();
+	memwatch::reset();
+	os_UninstallFaultHandler();
+	nowide::remove(path.c_str());
+	config::IncrementalSavestates = false;
+	settings.content.fileName.clear();
+}
+
+// Data past the limit isn't written
+TEST_F(SerializeTest, Overflow)
+{
+	std::vector<u8> data(64);
+	std::array<u8, 32> block;
+	block.fill(0xff);
+	Serializer ser(data.data(), 24);
+	const size_t headerSize = ser.size();
+	ser << block;
+	ASSERT_TRUE(ser.overflow());
+	ASSERT_EQ(headerSize + block.size(), ser.size());
+	for (size_t i = headerSize; i < data.size(); i++)
+		ASSERT_EQ(0, data[i]);
+
+	ser = Serializer(data.data(), headerSize + block.size());
+	ser << block;
+	ASSERT_FALSE(ser.overflow());
+	ASSERT_EQ(0xff, data[headerSize + block.size() - 1]);
+}